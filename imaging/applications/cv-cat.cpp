@@ -36,6 +36,7 @@
 #include <boost/program_options.hpp>
 #include <comma/application/signal_flag.h>
 #include <comma/name_value/parser.h>
+#include <snark/imaging/cv_mat/mmap_reader.h>
 #include <snark/imaging/cv_mat/pipeline.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/features2d/features2d.hpp>
@@ -86,6 +87,13 @@ static pair read( snark::cv_mat::serialization& input, rate_limit& rate )
     return input.read( std::cin );
 }
 
+static pair read_mapped( snark::cv_mat::mmap_reader& input, rate_limit& rate )
+{
+    if( is_shutdown ) { return pair(); }
+    rate.wait();
+    return input.read();
+}
+
 int main( int argc, char** argv )
 {
     try
@@ -96,6 +104,9 @@ int main( int argc, char** argv )
         #endif
 
         std::string name;
+        std::string mapped_name;
+        std::string from;
+        std::size_t skip;
         int device;
         unsigned int discard;
         double fps;
@@ -110,6 +121,9 @@ int main( int argc, char** argv )
             ( "discard,d", "discard frames, if cannot keep up; same as --buffer=1" )
             ( "camera", "use first available opencv-supported camera" )
             ( "file", boost::program_options::value< std::string >( &name ), "video file name" )
+            ( "mmap", boost::program_options::value< std::string >( &mapped_name ), "read images serialized as by --input from given file, memory-mapped instead of copied; faster than reading from stdin" )
+            ( "skip", boost::program_options::value< std::size_t >( &skip )->default_value( 0 ), "with --mmap, start from given frame number" )
+            ( "from", boost::program_options::value< std::string >( &from ), "with --mmap or --input=\"format=snark-log\", start from the first frame with timestamp not less than given time, e.g. 20150101T000000" )
             ( "id", boost::program_options::value< int >( &device ), "specify specific device by id ( OpenCV-supported camera )" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "fps", boost::program_options::value< double >( &fps )->default_value( 0 ), "specify max fps ( useful for files, may block if used with cameras ) " )
@@ -117,7 +131,9 @@ int main( int argc, char** argv )
             ( "output", boost::program_options::value< std::string >( &output_options_string ), "output options (see --help --verbose); default: same as --input" )
             ( "capacity", boost::program_options::value< unsigned int >( &capacity )->default_value( 16 ), "maximum input queue size before the reader thread blocks" )
             ( "threads", boost::program_options::value< unsigned int >( &number_of_threads )->default_value( 0 ), "number of threads; default: 0 (auto)" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "stay", "do not close at end of stream" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
         boost::program_options::variables_map vm;
         boost::program_options::store( boost::program_options::parse_command_line( argc, argv, description), vm );
         boost::program_options::parsed_options parsed = boost::program_options::command_line_parser(argc, argv).options( description ).allow_unregistered().run();
@@ -151,6 +167,15 @@ int main( int argc, char** argv )
             std::cerr << std::endl;
             std::cerr << "        cat gige-output.bin | csv-play --binary=t,3ui,729600ub | cv-cat view > /dev/null" << std::endl;
             std::cerr << std::endl;
+            std::cerr << "    play back gige-output.bin from the previous example memory-mapped, starting from frame 1000" << std::endl;
+            std::cerr << std::endl;
+            std::cerr << "        cv-cat --mmap gige-output.bin --skip 1000 view > /dev/null" << std::endl;
+            std::cerr << std::endl;
+            std::cerr << "    record compressed and indexed log, then play it back from given time" << std::endl;
+            std::cerr << std::endl;
+            std::cerr << "        gige-cat | cv-cat --output=\"format=snark-log\" > log.bin" << std::endl;
+            std::cerr << "        cv-cat --input=\"format=snark-log\" --output=\"fields=t,rows,cols,type\" --from 20150101T120000 view < log.bin > /dev/null" << std::endl;
+            std::cerr << std::endl;
             std::cerr << "    print image header (e.g. to figure out the image size or type)" << std::endl;
             std::cerr << std::endl;
             std::cerr << "        gige-cat --output=\"header-only;fields=rows,cols,size,type\" | csv-from-bin 4ui | head" << std::endl;
@@ -167,7 +192,7 @@ int main( int argc, char** argv )
             std::cerr << std::endl;
             return 0;
         }
-        if( vm.count( "file" ) + vm.count( "camera" ) + vm.count( "id" ) > 1 ) { std::cerr << "cv-cat: --file, --camera, and --id are mutually exclusive" << std::endl; return 1; }
+        if( vm.count( "file" ) + vm.count( "camera" ) + vm.count( "id" ) + vm.count( "mmap" ) > 1 ) { std::cerr << "cv-cat: --file, --camera, --id, and --mmap are mutually exclusive" << std::endl; return 1; }
         if( vm.count( "discard" ) ) { discard = 1; }
         snark::cv_mat::serialization::options input_options = comma::name_value::parser( ';', '=' ).get< snark::cv_mat::serialization::options >( input_options_string );
         snark::cv_mat::serialization::options output_options = output_options_string.empty()
@@ -186,8 +211,18 @@ int main( int argc, char** argv )
         cv::VideoCapture video_capture;
         snark::cv_mat::serialization input( input_options );
         snark::cv_mat::serialization output( output_options );
+        boost::scoped_ptr< snark::cv_mat::mmap_reader > mapped;
         boost::scoped_ptr< bursty_reader< pair > > reader;
-        if( vm.count( "file" ) )
+        if( vm.count( "mmap" ) )
+        {
+            unsigned int tokens = vm.count( "latency" ) ? 1 : number_of_threads == 0 ? ::tbb::task_scheduler_init::default_num_threads() : number_of_threads; // frames in flight in the pipeline, same as in bursty_pipeline
+            unsigned int release = capacity + tokens + 2; // frames older than that have left the pipeline: input queue holds at most capacity frames, plus the frame the reader thread holds while the queue is full, plus one spare
+            mapped.reset( new snark::cv_mat::mmap_reader( snark::cv_mat::mmap_reader::config( mapped_name, input_options, release ) ) );
+            if( !from.empty() && !mapped->seek( boost::posix_time::from_iso_string( from ) ) ) { std::cerr << "cv-cat: no frames from " << from << " in " << mapped_name << std::endl; return 1; }
+            if( from.empty() && skip > 0 && !mapped->seek( skip ) ) { std::cerr << "cv-cat: expected more than " << skip << " frames in " << mapped_name << ", got " << mapped->frame() << std::endl; return 1; }
+            reader.reset( new bursty_reader< pair >( boost::bind( &read_mapped, boost::ref( *mapped ), boost::ref( rate ) ), discard, capacity ) );
+        }
+        else if( vm.count( "file" ) )
         {
             video_capture.open( name );
             reader.reset( new bursty_reader< pair >( boost::bind( &capture, boost::ref( video_capture ), boost::ref( rate ) ), discard, capacity ) );
@@ -199,10 +234,12 @@ int main( int argc, char** argv )
         }
         else
         {
+            if( !from.empty() ) { input.seek( std::cin, boost::posix_time::from_iso_string( from ) ); }
             reader.reset( new bursty_reader< pair >( boost::bind( &read, boost::ref( input ), boost::ref( rate ) ), discard, capacity ) );
         }
         const unsigned int default_delay = vm.count( "file" ) == 0 ? 1 : 200; // HACK to make view work on single files
-        snark::imaging::applications::pipeline pipeline( output, snark::cv_mat::filters::make( filters, default_delay ), *reader, number_of_threads );
+        snark::imaging::applications::pipeline pipeline( output, snark::cv_mat::filters::make( filters, default_delay ), *reader, number_of_threads, vm.count( "latency" ) ? 1 : 0 );
+        pipeline.profile( vm );
         pipeline.run();
         if( vm.count( "stay" ) ) { while( !is_shutdown ) { boost::this_thread::sleep( boost::posix_time::seconds( 1 ) ); } }
         return 0;
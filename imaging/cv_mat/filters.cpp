@@ -27,15 +27,29 @@
 // OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cmath>
 #include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
 #include <queue>
 #include <sstream>
 #include <boost/array.hpp>
 #include <boost/bind.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/type_traits.hpp>
 #include <comma/base/exception.h>
 #include <comma/base/types.h>
@@ -46,6 +60,10 @@
 #include <comma/string/string.h>
 #include <comma/name_value/parser.h>
 #include <Eigen/Core>
+#include <tbb/atomic.h>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
 #include <opencv2/features2d/features2d.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/imgproc/imgproc_c.h>
@@ -54,6 +72,7 @@
 #include "../../timing/timestamped.h"
 #include "../../timing/traits.h"
 #include "filters.h"
+#include "pool.h"
 #include "serialization.h"
 #include "traits.h"
 #include "depth_traits.h"
@@ -164,17 +183,115 @@ static std::string type_as_string( int t ) // to avoid compilation warning
     return it == types_as_string.end() ? boost::lexical_cast< std::string >( t ) : it->second;
 }
 
+struct parallel_body_
+{
+    const boost::function< void( int, int ) >& f;
+    parallel_body_( const boost::function< void( int, int ) >& f ) : f( f ) {}
+    void operator()( const ::tbb::blocked_range< int >& r ) const { f( r.begin(), r.end() ); }
+};
+
+/// call f( begin, end ) for ranges of [0,size) in parallel, for data parallelism within a frame
+/// @note exceptions thrown by f are passed by tbb to the calling thread, possibly as tbb::captured_exception, i.e. without their type
+static void parallel_for_( int size, int grain, const boost::function< void( int, int ) >& f )
+{
+    ::tbb::parallel_for( ::tbb::blocked_range< int >( 0, size, std::max( 1, grain ) ), parallel_body_( f ) );
+}
+
+/// same as above for bands of rows, each band of at least about band_size bytes of given row size
+static void parallel_rows_( int rows, std::size_t row_size, const boost::function< void( int, int ) >& f, std::size_t band_size = 65536 )
+{
+    parallel_for_( rows, int( band_size / std::max< std::size_t >( row_size, 1 ) ), f );
+}
+
+/// bayer bands are demosaiced with a margin and copied into place, thus
+/// use large bands to keep margin and copy cheap compared to demosaicing
+static const std::size_t bayer_band_size = 1 << 21;
+
+/// convert a band of bayer image rows, using two extra rows above and below for interpolation
+/// @note the band is extended to start at an even row to keep the bayer pattern
+static void bayer_rows_( const cv::Mat& input, cv::Mat& output, int code, int begin, int end )
+{
+    if( begin == 0 && end == input.rows ) { cv::cvtColor( input, output, code ); return; } // single band: no margin, no copy
+    int b = std::max( 0, ( begin - 2 ) & ~1 );
+    int e = std::min( input.rows, end + 2 );
+    cv::Mat converted = pool::instance().make( e - b, input.cols, output.type() );
+    cv::cvtColor( input.rowRange( b, e ), converted, code );
+    cv::Mat band = output.rowRange( begin, end );
+    converted.rowRange( begin - b, end - b ).copyTo( band );
+}
+
 static filters::value_type cvt_color_impl_( filters::value_type m, unsigned int which )
 {
-    filters::value_type n;
-    n.first = m.first;
+    filters::value_type n( m.first, pool::instance().make() );
     if( m.second.channels() == 3 )
     {
-        cv::Mat grey;
+        cv::Mat grey = pool::instance().make();
         cv::cvtColor( m.second, grey, CV_RGB2GRAY );
         m.second = grey;
     }
-    cv::cvtColor( m.second, n.second, which + 45u ); // HACK, bayer as unsigned int, but I don't find enum { BG2RGB, GB2BGR ... } more usefull
+    if( which < 1 || which > 4 || m.second.channels() != 1 )
+    {
+        cv::cvtColor( m.second, n.second, which + 45u ); // HACK, bayer as unsigned int, but I don't find enum { BG2RGB, GB2BGR ... } more usefull
+        return n;
+    }
+    n.second = pool::instance().make( m.second.rows, m.second.cols, CV_MAKETYPE( m.second.depth(), 3 ) );
+    parallel_rows_( m.second.rows, n.second.cols * n.second.elemSize(), boost::bind( &bayer_rows_, boost::cref( m.second ), boost::ref( n.second ), which + 45, _1, _2 ), bayer_band_size );
+    return n;
+}
+
+/// demosaic a band of rows of the region of interest, using a margin of two pixels for interpolation
+/// @note the region is extended to start at an even row and column to keep the bayer pattern
+static void bayer_roi_rows_( const cv::Mat& input, cv::Mat& output, int code, cv::Rect roi, int begin, int end )
+{
+    int top = std::max( 0, ( roi.y + begin - 2 ) & ~1 );
+    int bottom = std::min( input.rows, roi.y + end + 2 );
+    int left = std::max( 0, ( roi.x - 2 ) & ~1 );
+    int right = std::min( input.cols, roi.x + roi.width + 2 );
+    cv::Mat converted = pool::instance().make( bottom - top, right - left, output.type() );
+    cv::cvtColor( input( cv::Rect( left, top, right - left, bottom - top ) ), converted, code );
+    cv::Mat band = output.rowRange( begin, end );
+    converted( cv::Rect( roi.x - left, roi.y + begin - top, roi.width, end - begin ) ).copyTo( band );
+}
+
+/// demosaic at half resolution: each 2x2 bayer cell of the region of interest gives one bgr pixel, green is the mean of both greens
+/// @param red_row, red_col position of red in the bayer cell
+template < typename T >
+static void bayer_half_rows_( const cv::Mat& input, cv::Mat& output, cv::Rect roi, int red_row, int red_col, int begin, int end )
+{
+    for( int i = begin; i < end; ++i )
+    {
+        const T* red = input.ptr< T >( roi.y + 2 * i + red_row ) + roi.x;
+        const T* blue = input.ptr< T >( roi.y + 2 * i + 1 - red_row ) + roi.x;
+        T* out = output.ptr< T >( i );
+        for( int j = 0; j < output.cols; ++j, red += 2, blue += 2, out += 3 )
+        {
+            out[0] = blue[ 1 - red_col ];
+            out[1] = ( int( red[ 1 - red_col ] ) + blue[ red_col ] + 1 ) / 2;
+            out[2] = red[ red_col ];
+        }
+    }
+}
+
+/// demosaic region of interest only, optionally at half resolution, without materialising the full-resolution colour image
+static filters::value_type bayer_roi_impl_( filters::value_type m, unsigned int which, cv::Rect roi, bool half )
+{
+    if( m.second.channels() != 1 ) { COMMA_THROW( comma::exception, "bayer-roi: expected single-channel image, got " << m.second.channels() << " channels" ); }
+    if( m.second.depth() != CV_8U && m.second.depth() != CV_16U ) { COMMA_THROW( comma::exception, "bayer-roi: expected 8- or 16-bit unsigned image, got type " << m.second.type() ); }
+    if( roi.width == 0 ) { roi = cv::Rect( 0, 0, m.second.cols, m.second.rows ); }
+    if( roi.x + roi.width > m.second.cols || roi.y + roi.height > m.second.rows ) { COMMA_THROW( comma::exception, "bayer-roi: region " << roi.x << "," << roi.y << "," << roi.width << "," << roi.height << " is outside of " << m.second.cols << "x" << m.second.rows << " image" ); }
+    if( !half )
+    {
+        filters::value_type n( m.first, pool::instance().make( roi.height, roi.width, CV_MAKETYPE( m.second.depth(), 3 ) ) );
+        parallel_rows_( n.second.rows, n.second.cols * n.second.elemSize(), boost::bind( &bayer_roi_rows_, boost::cref( m.second ), boost::ref( n.second ), which + 45, roi, _1, _2 ), bayer_band_size );
+        return n;
+    }
+    filters::value_type n( m.first, pool::instance().make( roi.height / 2, roi.width / 2, CV_MAKETYPE( m.second.depth(), 3 ) ) );
+    static const int red_row[] = { 0, 0, 1, 1 }; // for which = 1..4, i.e. bayer bg, gb, rg, gr in opencv terms
+    static const int red_col[] = { 0, 1, 1, 0 };
+    boost::function< void( int, int ) > f = m.second.depth() == CV_8U
+                                          ? boost::function< void( int, int ) >( boost::bind( &bayer_half_rows_< unsigned char >, boost::cref( m.second ), boost::ref( n.second ), roi, red_row[ which - 1 ], red_col[ which - 1 ], _1, _2 ) )
+                                          : boost::function< void( int, int ) >( boost::bind( &bayer_half_rows_< comma::uint16 >, boost::cref( m.second ), boost::ref( n.second ), roi, red_row[ which - 1 ], red_col[ which - 1 ], _1, _2 ) );
+    parallel_rows_( n.second.rows, n.second.cols * n.second.elemSize(), f );
     return n;
 }
 
@@ -186,29 +303,108 @@ static filters::value_type head_impl_( filters::value_type m, unsigned int numbe
 
 static filters::value_type crop_impl_( filters::value_type m, unsigned int x, unsigned int y, unsigned int w, unsigned int h )
 {
-    cv::Mat cropped;
+    cv::Mat cropped = pool::instance().make();
     m.second( cv::Rect( x, y, w, h ) ).copyTo( cropped );
     return filters::value_type( m.first, cropped );
 }
 
 typedef std::pair< unsigned int, unsigned int > tile_t;
 
-static filters::value_type crop_tile_impl_( filters::value_type input, unsigned int number_of_tile_cols, unsigned int number_of_tile_rows, const std::vector< tile_t >& tiles, bool vertical )
+static void copy_tiles_( const cv::Mat& input, cv::Mat& output, unsigned int w, unsigned int h, const std::vector< tile_t >& tiles, bool vertical, int begin, int end )
 {
-    unsigned int w = input.second.cols / number_of_tile_cols;
-    unsigned int h = input.second.rows / number_of_tile_rows;
-    unsigned int s = tiles.size();
-    filters::value_type output( input.first, cv::Mat( vertical ? h*s : h, vertical ? w : w*s, input.second.type() ) );
-    for( std::size_t i = 0; i < tiles.size(); ++i)
+    for( int i = begin; i < end; ++i )
     {
         unsigned int x = tiles[i].first * w;
         unsigned int y = tiles[i].second * h;
-        cv::Mat tile( output.second,  cv::Rect( vertical ? 0 : i*w, vertical ? i*h: 0, w, h ) );
-        cv::Mat( input.second, cv::Rect( x, y, w, h ) ).copyTo( tile );
+        cv::Mat tile( output, cv::Rect( vertical ? 0 : i*w, vertical ? i*h: 0, w, h ) );
+        cv::Mat( input, cv::Rect( x, y, w, h ) ).copyTo( tile );
     }
+}
+
+static filters::value_type crop_tile_impl_( filters::value_type input, unsigned int number_of_tile_cols, unsigned int number_of_tile_rows, const std::vector< tile_t >& tiles, bool vertical )
+{
+    unsigned int w = input.second.cols / number_of_tile_cols;
+    unsigned int h = input.second.rows / number_of_tile_rows;
+    unsigned int s = tiles.size();
+    filters::value_type output( input.first, pool::instance().make( vertical ? h*s : h, vertical ? w : w*s, input.second.type() ) );
+    parallel_for_( tiles.size(), 1, boost::bind( &copy_tiles_, boost::cref( input.second ), boost::ref( output.second ), w, h, boost::cref( tiles ), vertical, _1, _2 ) );
     return output;
 }
 
+/// apply filters to each tile of the image independently and in parallel, then put the resulting tiles together in the same order
+/// tiles are passed to the filters as views into the input image, i.e. without copying
+/// each tile has its own instance of the filters, thus stateful filters keep their state per tile
+/// @note stateful, has to run serially; the parallelism is across the tiles of a frame
+class tiles_impl_
+{
+    public:
+        tiles_impl_( unsigned int cols, unsigned int rows, const std::string& how ) : cols_( cols ), rows_( rows ), filters_( new std::vector< std::vector< filter > >( cols * rows ) )
+        {
+            for( std::size_t i = 0; i < filters_->size(); ++i )
+            {
+                ( *filters_ )[i] = filters::make( how );
+                for( std::size_t k = 0; k < ( *filters_ )[i].size(); ++k ) { if( !( *filters_ )[i][k].filter_function ) { COMMA_THROW( comma::exception, "tiles: filters without output (e.g. null or histogram) are not supported, got: \"" << how << "\"" ); } }
+            }
+        }
+
+        filters::value_type operator()( filters::value_type m )
+        {
+            if( m.second.cols % cols_ || m.second.rows % rows_ ) { COMMA_THROW( comma::exception, "tiles: expected image size divisible by " << cols_ << "x" << rows_ << " tiles, got " << m.second.cols << "x" << m.second.rows ); }
+            int w = m.second.cols / cols_;
+            int h = m.second.rows / rows_;
+            std::vector< filters::value_type > tiles( cols_ * rows_ );
+            for( std::size_t i = 0; i < tiles.size(); ++i ) { tiles[i] = filters::value_type( m.first, m.second( cv::Rect( ( i % cols_ ) * w, ( i / cols_ ) * h, w, h ) ) ); }
+            ::tbb::atomic< bool > failed;
+            failed = false;
+            error_t_ error;
+            parallel_for_( tiles.size(), 1, boost::bind( &tiles_impl_::apply_, this, boost::ref( tiles ), boost::ref( failed ), boost::ref( error ), _1, _2 ) );
+            if( !error.what.empty() ) { COMMA_THROW( comma::exception, error.what ); }
+            if( failed ) { return filters::value_type(); }
+            const cv::Mat& first = tiles[0].second;
+            for( std::size_t i = 1; i < tiles.size(); ++i )
+            {
+                if( tiles[i].second.size() != first.size() || tiles[i].second.type() != first.type() ) { COMMA_THROW( comma::exception, "tiles: expected all filtered tiles of the same size and type, got " << first.cols << "x" << first.rows << " of type " << first.type() << " and " << tiles[i].second.cols << "x" << tiles[i].second.rows << " of type " << tiles[i].second.type() ); }
+            }
+            filters::value_type n( m.first, pool::instance().make( first.rows * rows_, first.cols * cols_, first.type() ) );
+            parallel_for_( tiles.size(), 1, boost::bind( &tiles_impl_::mosaic_, boost::cref( tiles ), boost::ref( n.second ), cols_, _1, _2 ) );
+            return n;
+        }
+
+    private:
+        unsigned int cols_;
+        unsigned int rows_;
+        boost::shared_ptr< std::vector< std::vector< filter > > > filters_;
+
+        /// first error in tiles, to rethrow on the calling thread, since tbb may not keep exception type and message
+        struct error_t_
+        {
+            boost::mutex mutex;
+            std::string what;
+            void set( const std::string& s ) { boost::mutex::scoped_lock lock( mutex ); if( what.empty() ) { what = s; } }
+        };
+
+        void apply_( std::vector< filters::value_type >& tiles, ::tbb::atomic< bool >& failed, error_t_& error, int begin, int end ) const
+        {
+            for( int i = begin; i < end && !failed; ++i )
+            {
+                try { tiles[i] = filters::apply( ( *filters_ )[i], tiles[i] ); }
+                catch( std::exception& ex ) { error.set( "tiles: tile " + boost::lexical_cast< std::string >( i ) + ": " + ex.what() ); failed = true; }
+                catch( ... ) { error.set( "tiles: tile " + boost::lexical_cast< std::string >( i ) + ": unknown exception" ); failed = true; }
+                if( tiles[i].second.empty() ) { failed = true; } // e.g. missing map value: empty frame as without tiles
+            }
+        }
+
+        static void mosaic_( const std::vector< filters::value_type >& tiles, cv::Mat& output, unsigned int cols, int begin, int end )
+        {
+            for( int i = begin; i < end; ++i )
+            {
+                const cv::Mat& tile = tiles[i].second;
+                cv::Mat roi( output, cv::Rect( ( i % cols ) * tile.cols, ( i / cols ) * tile.rows, tile.cols, tile.rows ) );
+                tile.copyTo( roi );
+            }
+        }
+};
+
 class accumulate_impl_
 {
     public:
@@ -230,7 +426,7 @@ class accumulate_impl_
             if( input.second.cols != cols_ ) { COMMA_THROW( comma::exception, "accumulate: expected input image with " << cols_ << " columns, got " << input.second.cols << " columns"); }
             if( input.second.rows != h_ ) { COMMA_THROW( comma::exception, "accumulate: expected input image with " << h_ << " rows, got " << input.second.rows << " rows"); }
             if( input.second.type() != type_ ) { COMMA_THROW( comma::exception, "accumulate: expected input image of type " << type_ << ", got type " << input.second.type() << " rows"); }
-            filters::value_type output( input.first, cv::Mat( accumulated_image_.size(), accumulated_image_.type() ) );
+            filters::value_type output( input.first, pool::instance().make( accumulated_image_.rows, accumulated_image_.cols, accumulated_image_.type() ) );
             cv::Mat new_data( output.second, rect_for_new_data_ );
             input.second.copyTo( new_data );
             cv::Mat old_data( output.second, rect_for_old_data_ );
@@ -360,7 +556,7 @@ static filters::value_type split_impl_( filters::value_type m )
 {
     filters::value_type n;
     n.first = m.first;
-    n.second = cv::Mat( m.second.rows * m.second.channels(), m.second.cols, single_channel_type( m.second.type() ) ); // todo: check number of channels!
+    n.second = pool::instance().make( m.second.rows * m.second.channels(), m.second.cols, single_channel_type( m.second.type() ) ); // todo: check number of channels!
     std::vector< cv::Mat > channels;
     channels.reserve( m.second.channels() );
     for( unsigned int i = 0; i < static_cast< unsigned int >( m.second.channels() ); ++i )
@@ -378,6 +574,7 @@ static filters::value_type merge_impl_( filters::value_type m, unsigned int ncha
     if( m.second.rows % nchannels != 0 ) { COMMA_THROW( comma::exception, "merge: expected " << nchannels << " horizontal strips of equal height, got " << m.second.rows << " rows, which is not a multiple of " << nchannels ); }
     std::vector< cv::Mat > channels( nchannels );
     for( std::size_t i = 0; i < nchannels; ++i ) { channels[i] = cv::Mat( m.second, cv::Rect( 0, i * m.second.rows / nchannels, m.second.cols, m.second.rows / nchannels ) ); }
+    n.second = pool::instance().make();
     cv::merge( channels, n.second );
     return n;
 }
@@ -421,17 +618,44 @@ static filters::value_type cross_impl_( filters::value_type m, boost::optional<
     return m;
 }
 
-static filters::value_type encode_impl_( filters::value_type m, const std::string& type )
+/// encode image into a single-column CV_8UC1 image of encoded bytes
+/// frames are encoded concurrently by pipeline threads; encoding buffers are kept per thread and reused
+class encode_impl_
 {
-    std::vector< unsigned char > buffer;
-    std::string format = "." + type;
-    cv::imencode( format, m.second, buffer );
-    filters::value_type p;
-    p.first = m.first;
-    p.second = cv::Mat( buffer.size(), 1, CV_8UC1 );
-    ::memcpy( p.second.data, &buffer[0] , buffer.size() );
-    return p;
-}
+    public:
+        encode_impl_( const std::string& type, const std::string& quality ) : format_( "." + type ), buffers_( new buffers_t_ )
+        {
+            if( quality.empty() ) { return; }
+            if( type == "jpg" || type == "jpeg" ) { parameters_.push_back( CV_IMWRITE_JPEG_QUALITY ); parameters_.push_back( parameter_( quality, 75, 90, 100, 100 ) ); }
+            else if( type == "png" ) { parameters_.push_back( CV_IMWRITE_PNG_COMPRESSION ); parameters_.push_back( parameter_( quality, 1, 3, 9, 9 ) ); }
+            else { COMMA_THROW( comma::exception, "encode: quality is supported for jpg and png only, got: \"" << type << "\"" ); }
+        }
+
+        filters::value_type operator()( filters::value_type m ) const
+        {
+            std::vector< unsigned char >& buffer = buffers_->local();
+            cv::imencode( format_, m.second, buffer, parameters_ );
+            filters::value_type p( m.first, cv::Mat( buffer.size(), 1, CV_8UC1 ) );
+            ::memcpy( p.second.data, &buffer[0], buffer.size() );
+            return p;
+        }
+
+    private:
+        typedef ::tbb::enumerable_thread_specific< std::vector< unsigned char > > buffers_t_;
+        std::string format_;
+        std::vector< int > parameters_;
+        boost::shared_ptr< buffers_t_ > buffers_;
+
+        static int parameter_( const std::string& quality, int fast, int balanced, int best, int max )
+        {
+            if( quality == "fast" ) { return fast; }
+            if( quality == "balanced" ) { return balanced; }
+            if( quality == "best" ) { return best; }
+            int value = boost::lexical_cast< int >( quality );
+            if( value < 0 || value > max ) { COMMA_THROW( comma::exception, "encode: expected quality from 0 to " << max << ", got " << value ); }
+            return value;
+        }
+};
 
 static comma::csv::options make_header_csv()
 {
@@ -536,7 +760,12 @@ struct count_impl_
 static filters::value_type invert_impl_( filters::value_type m )
 {
     if( m.second.type() != CV_8UC1 && m.second.type() != CV_8UC2 && m.second.type() != CV_8UC3 && m.second.type() != CV_8UC4 ) { COMMA_THROW( comma::exception, "expected image type ub, 2ub, 3ub, 4ub; got: " << type_as_string( m.second.type() ) ); }
-    for( unsigned char* c = m.second.datastart; c < m.second.dataend; *c = 255 - *c, ++c );
+    unsigned int size = m.second.cols * m.second.channels();
+    for( int i = 0; i < m.second.rows; ++i ) // row by row, since the image may be a view, e.g. a tile
+    {
+        unsigned char* c = m.second.ptr< unsigned char >( i );
+        for( unsigned int j = 0; j < size; ++j ) { c[j] = 255 - c[j]; }
+    }
     return m;
 }
 
@@ -546,70 +775,171 @@ static filters::value_type text_impl_( filters::value_type m, const std::string&
     return m;
 }
 
+/// undistort maps in fixed-point format, i.e. CV_16SC2 integer coordinates and CV_16UC1 interpolation table indices, see cv::convertMaps()
+/// the map file is memory-mapped; it holds either fixed-point maps as written by image-undistort-map --fixed-point,
+/// or two float images, x and y, which are converted once
+/// maps are loaded once per image size and shared by all copies of the filter, i.e. across pipeline threads
+class undistort_maps_ : public boost::noncopyable
+{
+    public:
+        typedef std::pair< cv::Mat, cv::Mat > maps_t;
+
+        undistort_maps_( const std::string& filename ) : filename_( filename ) {}
+
+        ~undistort_maps_()
+        {
+            #ifndef WIN32
+            for( std::size_t i = 0; i < mappings_.size(); ++i ) { ::munmap( mappings_[i].first, mappings_[i].second ); }
+            #endif
+        }
+
+        maps_t get( int rows, int cols )
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            std::map< std::pair< int, int >, maps_t >::const_iterator it = maps_.find( std::make_pair( rows, cols ) );
+            if( it != maps_.end() ) { return it->second; }
+            return maps_[ std::make_pair( rows, cols ) ] = load_( rows, cols );
+        }
+
+    private:
+        std::string filename_;
+        boost::mutex mutex_;
+        std::map< std::pair< int, int >, maps_t > maps_;
+        std::vector< std::pair< char*, std::size_t > > mappings_;
+        std::list< std::vector< char > > buffers_;
+
+        /// map file into memory, where supported, otherwise read it
+        void map_file_()
+        {
+            #ifdef WIN32
+            std::ifstream ifs( filename_.c_str(), std::ios::binary );
+            if( !ifs ) { COMMA_THROW( comma::exception, "failed to open undistort map in \"" << filename_ << "\"" ); }
+            buffers_.push_back( std::vector< char >( ( std::istreambuf_iterator< char >( ifs ) ), std::istreambuf_iterator< char >() ) );
+            mappings_.push_back( std::make_pair( buffers_.back().empty() ? NULL : &buffers_.back()[0], buffers_.back().size() ) );
+            #else
+            int fd = ::open( filename_.c_str(), O_RDONLY );
+            if( fd < 0 ) { COMMA_THROW( comma::exception, "failed to open undistort map in \"" << filename_ << "\"" ); }
+            struct stat st;
+            if( ::fstat( fd, &st ) != 0 ) { ::close( fd ); COMMA_THROW( comma::exception, "failed to stat \"" << filename_ << "\"" ); }
+            void* p = st.st_size == 0 ? NULL : ::mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+            ::close( fd );
+            if( p == MAP_FAILED ) { COMMA_THROW( comma::exception, "failed to map \"" << filename_ << "\"" ); }
+            mappings_.push_back( std::make_pair( static_cast< char* >( p ), std::size_t( st.st_size ) ) );
+            #endif
+        }
+
+        void unmap_last_()
+        {
+            #ifdef WIN32
+            buffers_.pop_back();
+            #else
+            if( mappings_.back().first ) { ::munmap( mappings_.back().first, mappings_.back().second ); }
+            #endif
+            mappings_.pop_back();
+        }
+
+        maps_t load_( int rows, int cols )
+        {
+            map_file_();
+            char* p = mappings_.back().first;
+            std::size_t size = mappings_.back().second;
+            std::size_t pixels = std::size_t( rows ) * cols;
+            if( size != pixels * 6 && size != pixels * 8 ) { unmap_last_(); COMMA_THROW( comma::exception, "expected " << ( pixels * 6 ) << " (fixed-point) or " << ( pixels * 8 ) << " (float) bytes in \"" << filename_ << "\" for image of " << cols << "x" << rows << ", got " << size ); }
+            maps_t maps;
+            if( size == pixels * 6 )
+            {
+                maps.first = cv::Mat( rows, cols, CV_16SC2, p );
+                maps.second = cv::Mat( rows, cols, CV_16UC1, p + pixels * 4 );
+                return maps;
+            }
+            cv::convertMaps( cv::Mat( rows, cols, CV_32FC1, p ), cv::Mat( rows, cols, CV_32FC1, p + pixels * 4 ), maps.first, maps.second, CV_16SC2 );
+            unmap_last_();
+            return maps;
+        }
+};
+
 class undistort_impl_
 {
     public:
-        undistort_impl_( const std::string& filename ) : filename_( filename ) {}
+        undistort_impl_( const std::string& filename ) : maps_( new undistort_maps_( filename ) ) {}
 
         filters::value_type operator()( filters::value_type m )
         {
-            init_map_( m.second.rows, m.second.cols );
-            filters::value_type n( m.first, cv::Mat( m.second.size(), m.second.type(), cv::Scalar::all(0) ) );
-            cv::remap( m.second, n.second, x_, y_, cv::INTER_LINEAR, cv::BORDER_TRANSPARENT );
+            const undistort_maps_::maps_t& maps = maps_->get( m.second.rows, m.second.cols );
+            filters::value_type n( m.first, pool::instance().make( m.second.rows, m.second.cols, m.second.type() ) );
+            parallel_rows_( n.second.rows, n.second.cols * n.second.elemSize(), boost::bind( &undistort_impl_::remap_rows_, boost::cref( m.second ), boost::ref( n.second ), boost::cref( maps.first ), boost::cref( maps.second ), _1, _2 ) );
             return n;
         }
 
     private:
-        std::string filename_;
-        std::vector< char > xbuf_;
-        std::vector< char > ybuf_;
-        cv::Mat x_;
-        cv::Mat y_;
-        void init_map_( unsigned int rows, unsigned int cols )
+        boost::shared_ptr< undistort_maps_ > maps_;
+
+        static void remap_rows_( const cv::Mat& input, cv::Mat& output, const cv::Mat& map1, const cv::Mat& map2, int begin, int end )
         {
-            if( !x_.empty() ) { return; }
-            std::ifstream stream( filename_.c_str() );
-            if( !stream ) { COMMA_THROW( comma::exception, "failed to open undistort map in \"" << filename_ << "\"" ); }
-            std::size_t size = rows * cols * 4;
-            xbuf_.resize( size );
-            stream.read( &xbuf_[0], size );
-            if( stream.gcount() < 0 || std::size_t( stream.gcount() ) != size ) { COMMA_THROW( comma::exception, "failed to read \"" << filename_ << "\"" ); }
-            ybuf_.resize( size );
-            stream.read( &ybuf_[0], size );
-            if( stream.gcount() < 0 || std::size_t( stream.gcount() ) != size ) { COMMA_THROW( comma::exception, "failed to read \"" << filename_ << "\"" ); }
-            stream.peek(); // quick and dirty
-            if( !stream.eof() ) { COMMA_THROW( comma::exception, "expected " << ( size * 2 ) << " bytes in \"" << filename_ << "\", got more" ); }
-            x_ = cv::Mat( rows, cols, CV_32FC1, &xbuf_[0] );
-            y_ = cv::Mat( rows, cols, CV_32FC1, &ybuf_[0] );
+            cv::Mat band = output.rowRange( begin, end );
+            band.setTo( cv::Scalar::all( 0 ) );
+            cv::remap( input, band, map1.rowRange( begin, end ), map2.rowRange( begin, end ), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT );
         }
 };
 
-class max_impl_ // experimental, to debug
+/// per-pixel maximum, minimum, or mean over a sliding window of the last n frames, O(1) per pixel per frame for any n
+/// max and min: van Herk/Gil-Werman scheme, i.e. the window is split at block boundaries of n frames;
+/// running maximum over the current block (prefix) is combined with the maximum from the window start to the end
+/// of the previous block (suffix), suffixes are computed in place over the ring of frames once per n frames
+/// mean: running sum, updated with the new and the leaving frame
+/// @note stateful, has to run serially
+class sliding_window_impl_
 {
     public:
-        max_impl_( unsigned int size, bool is_max ) : size_( size ), is_max_( is_max ) {}
+        enum operation_t { maximum, minimum, mean };
+
+        sliding_window_impl_( unsigned int size, operation_t operation ) : size_( size ), operation_( operation ), count_( 0 ) {}
 
         filters::value_type operator()( filters::value_type m )
         {
-            if( deque_.size() == size_ ) { deque_.pop_front(); }
-            deque_.push_back( filters::value_type() );
-            m.second.copyTo( deque_.back().second );
-            filters::value_type s( m.first, cv::Mat( m.second.rows, m.second.cols, m.second.type() ) );
-            ::memset( m.second.datastart, 0, m.second.rows * m.second.cols * m.second.channels() );
-            static unsigned int count = 0;
-            for( unsigned int i = 0; i < deque_.size(); ++i )
+            if( ring_.empty() || m.second.size() != ring_[0].size() || m.second.type() != ring_[0].type() ) { reset_( m.second ); }
+            unsigned int j = count_ % size_;
+            filters::value_type n( m.first, pool::instance().make( m.second.rows, m.second.cols, m.second.type() ) );
+            if( operation_ == mean )
             {
-                unsigned char* p = deque_[i].second.datastart;
-                for( unsigned char* q = s.second.datastart; q < s.second.dataend; *q = is_max_ ? std::max( *p, *q ) : std::min( *p, *q ), ++p, ++q );
+                if( count_ >= size_ ) { cv::subtract( sum_, ring_[j], sum_, cv::noArray(), sum_.type() ); }
+                cv::add( sum_, m.second, sum_, cv::noArray(), sum_.type() );
+                m.second.copyTo( ring_[j] );
+                ++count_;
+                sum_.convertTo( n.second, n.second.type(), 1.0 / std::min( count_, size_ ) );
+                return n;
             }
-            ++count;
-            return s;
+            if( j == 0 ) { m.second.copyTo( prefix_ ); }
+            else { apply_( prefix_, m.second, prefix_ ); }
+            if( count_ < size_ || j + 1 == size_ ) { prefix_.copyTo( n.second ); } // window is within a single block
+            else { apply_( ring_[ j + 1 ], prefix_, n.second ); } // ring_[ j + 1 ] still holds suffix of previous block
+            m.second.copyTo( ring_[j] );
+            if( j + 1 == size_ ) { for( unsigned int i = size_ - 1; i > 0; --i ) { apply_( ring_[ i - 1 ], ring_[i], ring_[ i - 1 ] ); } }
+            ++count_;
+            return n;
         }
 
     private:
         unsigned int size_;
-        bool is_max_;
-        std::deque< filters::value_type > deque_; // use vector?
+        operation_t operation_;
+        unsigned int count_;
+        std::vector< cv::Mat > ring_;
+        cv::Mat prefix_;
+        cv::Mat sum_;
+
+        void reset_( const cv::Mat& m )
+        {
+            ring_.resize( size_ );
+            for( unsigned int i = 0; i < size_; ++i ) { ring_[i].create( m.rows, m.cols, m.type() ); }
+            prefix_.create( m.rows, m.cols, m.type() );
+            if( operation_ == mean ) { sum_ = cv::Mat::zeros( m.rows, m.cols, CV_MAKETYPE( CV_64F, m.channels() ) ); }
+            count_ = 0;
+        }
+
+        void apply_( const cv::Mat& a, const cv::Mat& b, cv::Mat& c ) const
+        {
+            if( operation_ == maximum ) { cv::max( a, b, c ); } else { cv::min( a, b, c ); }
+        }
 };
 
 class map_impl_
@@ -640,61 +970,133 @@ class map_impl_
                 key_type key = no_key_field ? counter : map_input->key;
                 map_.insert( std::pair< key_type, output_value_type >( key, map_input->value ) );
             }
+            make_table_();
         }
 
         filters::value_type operator()( filters::value_type m )
         {
             if( m.second.channels() != 1 ) { std::cerr << "map filter: expected single channel cv type, got " << m.second.channels() << " channels" << std::endl; return filters::value_type(); }
-            filters::value_type n( m.first, cv::Mat( m.second.size(), cv::DataType< output_value_type >::type ) );
-            try
+            filters::value_type n( m.first, pool::instance().make( m.second.rows, m.second.cols, cv::DataType< output_value_type >::type ) );
+            ::tbb::atomic< bool > failed;
+            failed = false;
+            parallel_rows_( m.second.rows, m.second.cols * sizeof( output_value_type ), boost::bind( &map_impl_::apply_rows_, this, boost::cref( m.second ), boost::ref( n.second ), boost::ref( failed ), _1, _2 ) );
+            return failed ? filters::value_type() : n;
+        }
+
+        /// map single-channel image into output of the same size and type CV_64FC1
+        /// @param row image row of the first input row, if input is a band of the image, for error messages
+        /// @return false, if input type is not supported
+        /// @throw std::out_of_range, if not permissive and a value is not in the map
+        bool apply( const cv::Mat& input, cv::Mat& output, int row = 0 ) const
+        {
+            switch( input.type() )
             {
-                switch( m.second.type() )
-                {
-                    case cv::DataType< unsigned char >::type : apply_map< unsigned char >( m.second, n.second ); break;
-                    case cv::DataType< comma::uint16 >::type : apply_map< comma::uint16 >( m.second, n.second ); break;
-                    case cv::DataType< char >::type : apply_map< char >( m.second, n.second ); break;
-                    case cv::DataType< comma::int16 >::type : apply_map< comma::int16 >( m.second, n.second ); break;
-                    case cv::DataType< comma::int32 >::type : apply_map< comma::int32 >( m.second, n.second ); break;
-                    default: std::cerr << "map filter: expected integer cv type, got " << m.second.type() << std::endl; return filters::value_type();
-                }
-            } catch ( std::out_of_range ) { return filters::value_type(); }
-            return n;
+                case cv::DataType< unsigned char >::type : apply_table_< unsigned char >( input, output, row ); return true;
+                case cv::DataType< comma::uint16 >::type : apply_table_< comma::uint16 >( input, output, row ); return true;
+                case cv::DataType< signed char >::type : apply_table_< signed char >( input, output, row ); return true; // signed char, since char may be unsigned
+                case cv::DataType< comma::int16 >::type : apply_table_< comma::int16 >( input, output, row ); return true;
+                case cv::DataType< comma::int32 >::type : apply_map< comma::int32 >( input, output, row ); return true;
+                default: std::cerr << "map filter: expected integer cv type, got " << input.type() << std::endl; return false;
+            }
         }
 
     private:
+        void apply_rows_( const cv::Mat& input, cv::Mat& output, ::tbb::atomic< bool >& failed, int begin, int end ) const // flag missing map value to return empty frame as unbanded map does, since tbb may not keep exception type
+        {
+            if( failed ) { return; }
+            cv::Mat band = output.rowRange( begin, end );
+            try { if( !apply( input.rowRange( begin, end ), band, begin ) ) { failed = true; } }
+            catch ( std::out_of_range ) { failed = true; }
+        }
+
         typedef boost::unordered_map< key_type, output_value_type > map_t_;
         map_t_ map_;
         bool permissive_;
+        enum { table_begin_ = -32768, table_end_ = 65536 }; // covers keys of all 8- and 16-bit types
+        std::vector< output_value_type > table_; // table_[ key - table_begin_ ]
+        std::vector< unsigned char > missing_; // 1, if key is not in the map and not permissive
+
+        /// precompute dense lookup table for 8- and 16-bit inputs, permissive handling included
+        void make_table_()
+        {
+            table_.resize( table_end_ - table_begin_ );
+            missing_.resize( table_end_ - table_begin_ );
+            for( key_type key = table_begin_; key < table_end_; ++key )
+            {
+                map_t_::const_iterator it = map_.find( key );
+                table_[ key - table_begin_ ] = it == map_.end() ? key : it->second;
+                missing_[ key - table_begin_ ] = it == map_.end() && !permissive_;
+            }
+        }
+
+        static void throw_missing_( int i, int j, key_type key )
+        {
+            std::cerr << "map filter: expected a pixel value from the map, got: pixel at " << i << "," << j << " with value " << key << std::endl;
+            throw std::out_of_range( "" );
+        }
+
+        template < typename input_value_type >
+        void apply_table_( const cv::Mat& input, cv::Mat& output, int row ) const
+        {
+            const output_value_type* table = &table_[ -table_begin_ ];
+            const unsigned char* missing = &missing_[ -table_begin_ ];
+            for( int i = 0; i < input.rows; ++i )
+            {
+                const input_value_type* in = input.ptr< input_value_type >( i );
+                output_value_type* out = output.ptr< output_value_type >( i );
+                unsigned char bad = 0;
+                for( int j = 0; j < input.cols; ++j ) { out[j] = table[ in[j] ]; bad |= missing[ in[j] ]; } // branch-free gather
+                if( !bad ) { continue; }
+                for( int j = 0; j < input.cols; ++j ) { if( missing[ in[j] ] ) { throw_missing_( row + i, j, in[j] ); } }
+            }
+        }
 
         template < typename input_value_type >
-        void apply_map( const cv::Mat& input, cv::Mat& output )
+        void apply_map( const cv::Mat& input, cv::Mat& output, int row ) const
         {
-            for( int i=0; i < input.rows; ++i )
+            for( int i = 0; i < input.rows; ++i )
             {
-                for( int j=0; j < input.cols; ++j )
+                const input_value_type* in = input.ptr< input_value_type >( i );
+                output_value_type* out = output.ptr< output_value_type >( i );
+                for( int j = 0; j < input.cols; ++j )
                 {
-                    key_type key = input.at< input_value_type >(i,j);
-                    map_t_::const_iterator it = map_.find( key );
-                    if( it != map_.end() ) { output.at< output_value_type >(i,j) = map_.at( key ); }
-                    else
-                    {
-                        if( permissive_ ) { output.at< output_value_type >(i,j) = key; }
-                        else { std::cerr << "map filter: expected a pixel value from the map, got: pixel at " << i << "," << j << " with value " << key << std::endl; throw std::out_of_range(""); }
-                    }
+                    map_t_::const_iterator it = map_.find( in[j] );
+                    if( it != map_.end() ) { out[j] = it->second; }
+                    else if( permissive_ ) { out[j] = in[j]; }
+                    else { throw_missing_( row + i, j, in[j] ); }
                 }
             }
         }
 };
 
+template < typename T >
+static void magnitude_rows_( const cv::Mat& input, cv::Mat& output, int begin, int end )
+{
+    for( int i = begin; i < end; ++i )
+    {
+        const T* in = input.ptr< T >( i );
+        T* out = output.ptr< T >( i );
+        for( int j = 0; j < input.cols; ++j, in += 2 ) { out[j] = std::sqrt( in[0] * in[0] + in[1] * in[1] ); }
+    }
+}
+
+/// magnitude of 2-channel floating point image in bands of rows in parallel
+static cv::Mat magnitude_( const cv::Mat& m )
+{
+    cv::Mat n = pool::instance().make( m.rows, m.cols, CV_MAKETYPE( m.depth(), 1 ) );
+    switch( m.depth() )
+    {
+        case CV_32F: parallel_rows_( m.rows, m.cols * m.elemSize(), boost::bind( &magnitude_rows_< float >, boost::cref( m ), boost::ref( n ), _1, _2 ) ); break;
+        case CV_64F: parallel_rows_( m.rows, m.cols * m.elemSize(), boost::bind( &magnitude_rows_< double >, boost::cref( m ), boost::ref( n ), _1, _2 ) ); break;
+        default: COMMA_THROW( comma::exception, "magnitude: expected floating point image, got: " << type_as_string( m.type() ) );
+    }
+    return n;
+}
+
 static filters::value_type magnitude_impl_( filters::value_type m )
 {
     if( m.second.channels() != 2 ) { std::cerr << "cv filters: magnitude: expected 2 channels, got " << m.second.channels() << std::endl; return filters::value_type(); }
-    boost::array< cv::Mat, 2 > planes;
-    filters::value_type n;
-    n.first = m.first;
-    cv::split( m.second, &planes[0] );
-    cv::magnitude( planes[0], planes[1], n.second );
-    return n;
+    return filters::value_type( m.first, magnitude_( m.second ) );
 }
 
 static filters::value_type convert( filters::value_type m, bool scale, bool complex, bool magnitude, bool log_scale, bool normalize )
@@ -703,9 +1105,13 @@ static filters::value_type convert( filters::value_type m, bool scale, bool comp
     n.first = m.first;
     cv::dft( m.second, n.second, ( scale ? cv::DFT_SCALE : cv::DFT_INVERSE ) | ( complex ? cv::DFT_COMPLEX_OUTPUT : cv::DFT_REAL_OUTPUT ) );
     if( !magnitude ) { return n; }
-    boost::array< cv::Mat, 2 > planes = {{ cv::Mat::zeros( m.second.size(), m.second.type() ), cv::Mat::zeros( m.second.size(), m.second.type() ) }};
-    cv::split( n.second, &planes[0] );
-    cv::magnitude( planes[0], planes[1], n.second ); // make separate filters: magnitude, log, scale, normalize?
+    if( n.second.channels() == 2 ) { n.second = magnitude_( n.second ); }
+    else
+    {
+        boost::array< cv::Mat, 2 > planes = {{ cv::Mat::zeros( m.second.size(), m.second.type() ), cv::Mat::zeros( m.second.size(), m.second.type() ) }};
+        cv::split( n.second, &planes[0] );
+        cv::magnitude( planes[0], planes[1], n.second ); // make separate filters: magnitude, log, scale, normalize?
+    }
     if( log_scale )
     {
         n.second += cv::Scalar::all( 1 );
@@ -787,13 +1193,12 @@ filters::value_type fft_impl_( filters::value_type m, bool direct, bool complex,
 }
 
 template< int Depth >
-static filters::value_type per_element_dot( const filters::value_type m, const std::vector< double >& coefficients )
+static void per_element_dot( const cv::Mat& input, cv::Mat& output, const std::vector< double >& coefficients )
 {
-    cv::Mat result( m.second.size(), single_channel_type( m.second.type() ) );
-    const unsigned int channels = m.second.channels();
-    unsigned int rows = m.second.rows;
-    unsigned int cols = m.second.cols * channels;
-    if( m.second.isContinuous() )
+    const unsigned int channels = input.channels();
+    unsigned int rows = input.rows;
+    unsigned int cols = input.cols * channels;
+    if( input.isContinuous() && output.isContinuous() )
     {
         cols *= rows;
         rows = 1;
@@ -801,8 +1206,8 @@ static filters::value_type per_element_dot( const filters::value_type m, const s
     typedef typename depth_traits< Depth >::value_t value_t;
     for( unsigned int i = 0; i < rows; ++i )
     {
-        const value_t* in = m.second.ptr< value_t >(i);
-        value_t* out = result.ptr< value_t >(i);
+        const value_t* in = input.ptr< value_t >(i);
+        value_t* out = output.ptr< value_t >(i);
         for( unsigned int j = 0; j < cols; j += channels )
         {
             double dot = 0;
@@ -811,24 +1216,283 @@ static filters::value_type per_element_dot( const filters::value_type m, const s
             *out++ = dot;
         }
     }
-    return filters::value_type( m.first, result );
+}
+
+static void per_element_dot( const cv::Mat& input, cv::Mat& output, const std::vector< double >& coefficients )
+{
+    switch( input.depth() )
+    {
+        case CV_8U : per_element_dot< CV_8U  >( input, output, coefficients ); return;
+        case CV_8S : per_element_dot< CV_8S  >( input, output, coefficients ); return;
+        case CV_16U: per_element_dot< CV_16U >( input, output, coefficients ); return;
+        case CV_16S: per_element_dot< CV_16S >( input, output, coefficients ); return;
+        case CV_32S: per_element_dot< CV_32S >( input, output, coefficients ); return;
+        case CV_32F: per_element_dot< CV_32F >( input, output, coefficients ); return;
+        case CV_64F: per_element_dot< CV_64F >( input, output, coefficients ); return;
+    }
+    COMMA_THROW( comma::exception, "linear-combination: unrecognised image type " << input.type() );
+}
+
+static void per_element_dot_rows_( const cv::Mat& input, cv::Mat& output, const std::vector< double >& coefficients, int begin, int end )
+{
+    cv::Mat band = output.rowRange( begin, end );
+    per_element_dot( input.rowRange( begin, end ), band, coefficients );
 }
 
 static filters::value_type linear_combination_impl_( const filters::value_type m, const std::vector< double >& coefficients )
 {
     if( m.second.channels() != static_cast< int >( coefficients.size() ) ) { COMMA_THROW( comma::exception, "linear-combination: the number of coefficients does not match the number of channels; channels = " << m.second.channels() << ", coefficients = " << coefficients.size() ); }
     if( m.second.channels() == 1 ) { return filters::value_type( m.first, m.second * coefficients[0] ); }
-    switch( m.second.depth() )
+    filters::value_type n( m.first, pool::instance().make( m.second.rows, m.second.cols, single_channel_type( m.second.type() ) ) );
+    parallel_rows_( m.second.rows, m.second.cols * m.second.elemSize(), boost::bind( &per_element_dot_rows_, boost::cref( m.second ), boost::ref( n.second ), boost::cref( coefficients ), _1, _2 ) );
+    return n;
+}
+
+/// per-pixel operation, which can be applied to any horizontal strip of an image independently
+struct pointwise_
+{
+    virtual ~pointwise_() {}
+
+    /// @return output type for given input type; -1, if the frame is to be dropped
+    virtual int output_type( int type ) const = 0;
+
+    /// apply to input writing to output, which has the same size and type as returned by output_type()
+    virtual void apply( const cv::Mat& input, cv::Mat& output ) const = 0;
+
+    /// same as above for input starting at given row of the image, e.g. for error messages
+    virtual void apply( const cv::Mat& input, cv::Mat& output, int ) const { apply( input, output ); }
+};
+
+struct convert_to_pointwise_ : public pointwise_
+{
+    int type;
+    double scale;
+    double offset;
+    convert_to_pointwise_( int type, double scale, double offset ) : type( type ), scale( scale ), offset( offset ) {}
+    int output_type( int t ) const { return CV_MAKETYPE( CV_MAT_DEPTH( type ), CV_MAT_CN( t ) ); }
+    void apply( const cv::Mat& input, cv::Mat& output ) const { input.convertTo( output, type, scale, offset ); }
+};
+
+struct brightness_pointwise_ : public pointwise_ // same as ( input * scale ) + offset, which opencv evaluates as convertTo()
+{
+    double scale;
+    double offset;
+    brightness_pointwise_( double scale, double offset ) : scale( scale ), offset( offset ) {}
+    int output_type( int t ) const { return t; }
+    void apply( const cv::Mat& input, cv::Mat& output ) const { input.convertTo( output, -1, scale, offset ); }
+};
+
+struct threshold_pointwise_ : public pointwise_
+{
+    double threshold;
+    double max_value;
+    threshold_t::types type;
+    threshold_pointwise_( double threshold, double max_value, threshold_t::types type ) : threshold( threshold ), max_value( max_value ), type( type ) {}
+    int output_type( int t ) const { return t; }
+    void apply( const cv::Mat& input, cv::Mat& output ) const { cv::threshold( input, output, threshold, max_value, type ); }
+};
+
+struct invert_pointwise_ : public pointwise_
+{
+    int output_type( int t ) const
     {
-        case CV_8U : return per_element_dot< CV_8U  >( m, coefficients );
-        case CV_8S : return per_element_dot< CV_8S  >( m, coefficients );
-        case CV_16U: return per_element_dot< CV_16U >( m, coefficients );
-        case CV_16S: return per_element_dot< CV_16S >( m, coefficients );
-        case CV_32S: return per_element_dot< CV_32S >( m, coefficients );
-        case CV_32F: return per_element_dot< CV_32F >( m, coefficients );
-        case CV_64F: return per_element_dot< CV_64F >( m, coefficients );
+        if( t != CV_8UC1 && t != CV_8UC2 && t != CV_8UC3 && t != CV_8UC4 ) { COMMA_THROW( comma::exception, "expected image type ub, 2ub, 3ub, 4ub; got: " << type_as_string( t ) ); }
+        return t;
     }
-    COMMA_THROW( comma::exception, "linear-combination: unrecognised image type " << m.second.type() );
+
+    void apply( const cv::Mat& input, cv::Mat& output ) const
+    {
+        unsigned int size = input.cols * input.channels();
+        for( int i = 0; i < input.rows; ++i )
+        {
+            const unsigned char* in = input.ptr< unsigned char >( i );
+            unsigned char* out = output.ptr< unsigned char >( i );
+            for( unsigned int j = 0; j < size; ++j ) { out[j] = 255 - in[j]; }
+        }
+    }
+};
+
+struct linear_combination_pointwise_ : public pointwise_
+{
+    std::vector< double > coefficients;
+    linear_combination_pointwise_( const std::vector< double >& coefficients ) : coefficients( coefficients ) {}
+
+    int output_type( int t ) const
+    {
+        if( CV_MAT_CN( t ) != static_cast< int >( coefficients.size() ) ) { COMMA_THROW( comma::exception, "linear-combination: the number of coefficients does not match the number of channels; channels = " << CV_MAT_CN( t ) << ", coefficients = " << coefficients.size() ); }
+        return coefficients.size() == 1 ? t : single_channel_type( t );
+    }
+
+    void apply( const cv::Mat& input, cv::Mat& output ) const
+    {
+        if( coefficients.size() == 1 ) { input.convertTo( output, -1, coefficients[0] ); }
+        else { per_element_dot( input, output, coefficients ); }
+    }
+};
+
+struct map_pointwise_ : public pointwise_
+{
+    boost::shared_ptr< map_impl_ > map;
+    map_pointwise_( const boost::shared_ptr< map_impl_ >& map ) : map( map ) {}
+
+    int output_type( int t ) const
+    {
+        if( CV_MAT_CN( t ) == 1 ) { return CV_64FC1; }
+        std::cerr << "map filter: expected single channel cv type, got " << CV_MAT_CN( t ) << " channels" << std::endl;
+        return -1;
+    }
+
+    void apply( const cv::Mat& input, cv::Mat& output ) const { apply( input, output, 0 ); }
+
+    void apply( const cv::Mat& input, cv::Mat& output, int row ) const { if( !map->apply( input, output, row ) ) { throw std::out_of_range( "" ); } }
+};
+
+struct magnitude_pointwise_ : public pointwise_
+{
+    int output_type( int t ) const
+    {
+        if( CV_MAT_CN( t ) != 2 ) { std::cerr << "cv filters: magnitude: expected 2 channels, got " << CV_MAT_CN( t ) << std::endl; return -1; }
+        if( CV_MAT_DEPTH( t ) != CV_32F && CV_MAT_DEPTH( t ) != CV_64F ) { COMMA_THROW( comma::exception, "magnitude: expected floating point image, got: " << type_as_string( t ) ); }
+        return CV_MAKETYPE( CV_MAT_DEPTH( t ), 1 );
+    }
+
+    void apply( const cv::Mat& input, cv::Mat& output ) const
+    {
+        if( input.depth() == CV_32F ) { magnitude_rows_< float >( input, output, 0, input.rows ); } else { magnitude_rows_< double >( input, output, 0, input.rows ); }
+    }
+};
+
+/// a run of per-pixel filters applied in a single pass over the image:
+/// the image is processed in horizontal strips small enough for intermediate results to stay in cache,
+/// thus input is read once and output is written once, no matter how many filters are in the run;
+/// bands of strips are processed in parallel
+class fused_impl_
+{
+    public:
+        typedef boost::shared_ptr< pointwise_ > pointwise_t;
+
+        fused_impl_( const std::vector< pointwise_t >& operations ) : operations_( operations ) {}
+
+        filters::value_type operator()( filters::value_type m ) const
+        {
+            if( m.second.empty() ) { return m; }
+            std::vector< int > types( operations_.size() + 1 );
+            types[0] = m.second.type();
+            std::size_t row_size = m.second.cols * m.second.elemSize();
+            for( std::size_t i = 0; i < operations_.size(); ++i )
+            {
+                types[ i + 1 ] = operations_[i]->output_type( types[i] );
+                if( types[ i + 1 ] < 0 ) { return filters::value_type(); }
+                row_size = std::max< std::size_t >( row_size, m.second.cols * CV_ELEM_SIZE( types[ i + 1 ] ) );
+            }
+            int strip_rows = std::max( 1, int( strip_size / row_size ) );
+            filters::value_type n( m.first, pool::instance().make( m.second.rows, m.second.cols, types.back() ) );
+            ::tbb::atomic< bool > failed;
+            failed = false;
+            parallel_for_( m.second.rows, strip_rows, boost::bind( &fused_impl_::apply_rows_, this, boost::cref( m.second ), boost::ref( n.second ), boost::cref( types ), strip_rows, boost::ref( failed ), _1, _2 ) );
+            return failed ? filters::value_type() : n;
+        }
+
+    private:
+        enum { strip_size = 65536 }; // bytes per strip of the widest intermediate image
+        std::vector< pointwise_t > operations_;
+
+        void apply_rows_( const cv::Mat& image, cv::Mat& result, const std::vector< int >& types, int strip_rows, ::tbb::atomic< bool >& failed, int begin, int end ) const
+        {
+            std::vector< cv::Mat > buffers( operations_.size() - 1 );
+            for( std::size_t i = 0; i < buffers.size(); ++i ) { buffers[i].create( std::min( strip_rows, end - begin ), image.cols, types[ i + 1 ] ); }
+            try
+            {
+                for( int row = begin; row < end && !failed; row += strip_rows )
+                {
+                    int rows = std::min( strip_rows, end - row );
+                    cv::Mat input = image.rowRange( row, row + rows );
+                    for( std::size_t i = 0; i < operations_.size(); ++i )
+                    {
+                        cv::Mat output = i + 1 == operations_.size() ? result.rowRange( row, row + rows ) : buffers[i].rowRange( 0, rows );
+                        const uchar* data = output.data;
+                        operations_[i]->apply( input, output, row );
+                        if( output.data != data ) { COMMA_THROW( comma::exception, "fused filters: expected output of type " << type_as_string( types[ i + 1 ] ) << ", got " << type_as_string( output.type() ) ); }
+                        input = output;
+                    }
+                }
+            }
+            catch( std::out_of_range ) { failed = true; } // missing map value: empty frame as for map filter, since tbb may not keep exception type
+        }
+};
+
+/// return per-pixel filter given by name-value string and its operation, if fusable with neighbour filters
+static boost::optional< std::pair< filter, fused_impl_::pointwise_t > > make_pointwise_( const std::vector< std::string >& e, const std::string& s )
+{
+    typedef std::pair< filter, fused_impl_::pointwise_t > pair_t;
+    if( e[0] == "convert-to" || e[0] == "convert_to" )
+    {
+        if( e.size() <= 1 ) { COMMA_THROW( comma::exception, "convert-to: expected options, got none" ); }
+        const std::vector< std::string >& w = comma::split( e[1], ',' );
+        boost::unordered_map< std::string, int >::const_iterator it = types_.find( w[0] );
+        if( it == types_.end() ) { COMMA_THROW( comma::exception, "convert-to: expected target type, got \"" << w[0] << "\"" ); }
+        double scale = w.size() > 1 ? boost::lexical_cast< double >( w[1] ) : 1.0;
+        double offset = w.size() > 2 ? boost::lexical_cast< double >( w[2] ) : 0.0;
+        return pair_t( filter( boost::bind( &convert_to_impl_, _1, it->second, scale, offset ) ), fused_impl_::pointwise_t( new convert_to_pointwise_( it->second, scale, offset ) ) );
+    }
+    if( e[0] == "brightness" )
+    {
+        const std::vector< std::string >& w = comma::split( e[1], ',' );
+        double scale = boost::lexical_cast< double >( w[0] );
+        double offset = w.size() == 1 ? 0.0 : boost::lexical_cast< double >( w[1] );
+        return pair_t( filter( boost::bind( &brightness_impl_, _1, scale, offset ) ), fused_impl_::pointwise_t( new brightness_pointwise_( scale, offset ) ) );
+    }
+    if( e[0] == "threshold" )
+    {
+        const std::vector< std::string >& w = comma::split( e[1], ',' );
+        if( w[0].empty() ) { COMMA_THROW( comma::exception, "threshold: expected <threshold>[,<max_value>[,<type>]] got: \"" << s << "\"" ); }
+        double threshold = boost::lexical_cast< double >( w[0] );
+        double maxval = w.size() < 2 ? 255 : boost::lexical_cast< double >( w[1] );
+        threshold_t::types type = threshold_t::from_string( w.size() < 3 ? "" : w[2] );
+        return pair_t( filter( boost::bind( &threshold_impl_, _1, threshold, maxval, type ) ), fused_impl_::pointwise_t( new threshold_pointwise_( threshold, maxval, type ) ) );
+    }
+    if( e[0] == "invert" )
+    {
+        return pair_t( filter( &invert_impl_ ), fused_impl_::pointwise_t( new invert_pointwise_ ) );
+    }
+    if( e[0] == "linear-combination" )
+    {
+        const std::vector< std::string >& w = comma::split( e[1], ',' );
+        if( w[0].empty() ) { COMMA_THROW( comma::exception, "linear-combination: expected coefficients got: \"" << s << "\"" ); }
+        std::vector< double > coefficients( w.size() );
+        for( unsigned int j = 0; j < w.size(); ++j ) { coefficients[j] = boost::lexical_cast< double >( w[j] ); }
+        return pair_t( filter( boost::bind( &linear_combination_impl_, _1, coefficients ) ), fused_impl_::pointwise_t( new linear_combination_pointwise_( coefficients ) ) );
+    }
+    if( e[0] == "map" )
+    {
+        if( e.size() < 2 ) { COMMA_THROW( comma::exception, "expected file name with the map, e.g. map=f.csv" ); }
+        std::stringstream ss; ss << e[1]; for( std::size_t i = 2; i < e.size(); ++i ) { ss << "=" << e[i]; }
+        std::string map_filter_options = ss.str();
+        std::vector< std::string > items = comma::split( map_filter_options, '&' );
+        bool permissive = std::find( items.begin()+1, items.end(), "permissive" ) != items.end();
+        boost::shared_ptr< map_impl_ > map( new map_impl_( map_filter_options, permissive ) );
+        return pair_t( filter( boost::bind( &map_impl_::operator(), map, _1 ) ), fused_impl_::pointwise_t( new map_pointwise_( map ) ) );
+    }
+    if( e[0] == "magnitude" )
+    {
+        return pair_t( filter( boost::bind( &magnitude_impl_, _1 ) ), fused_impl_::pointwise_t( new magnitude_pointwise_ ) );
+    }
+    return boost::none;
+}
+
+/// append run of per-pixel filters, fused, if more than one
+static void flush_pointwise_( std::vector< filter >& f, std::vector< std::pair< filter, fused_impl_::pointwise_t > >& run )
+{
+    if( run.size() == 1 ) { f.push_back( run[0].first ); }
+    else if( run.size() > 1 )
+    {
+        std::vector< fused_impl_::pointwise_t > operations( run.size() );
+        std::string name;
+        for( std::size_t i = 0; i < run.size(); ++i ) { operations[i] = run[i].second; name += ( i > 0 ? "+" : "" ) + run[i].first.name; }
+        f.push_back( filter( fused_impl_( operations ) ) );
+        f.back().name = name;
+    }
+    run.clear();
 }
 
 std::vector< filter > filters::make( const std::string& how, unsigned int default_delay )
@@ -838,15 +1502,45 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
     if( how == "" ) { return f; }
     std::string name;
     bool modified = false;
+    std::vector< std::pair< filter, fused_impl_::pointwise_t > > pointwise;
     for( std::size_t i = 0; i < v.size(); name += ( i > 0 ? ";" : "" ) + v[i], ++i )
     {
         std::vector< std::string > e = comma::split( v[i], '=' );
+        const boost::optional< std::pair< filter, fused_impl_::pointwise_t > >& p = make_pointwise_( e, v[i] );
+        if( p ) { pointwise.push_back( *p ); pointwise.back().first.name = e[0]; modified = true; continue; }
+        flush_pointwise_( f, pointwise );
+        std::size_t size = f.size();
         if( e[0] == "bayer" )
         {
             if( modified ) { COMMA_THROW( comma::exception, "cannot covert from bayer after transforms: " << name ); }
             unsigned int which = boost::lexical_cast< unsigned int >( e[1] );
             f.push_back( filter( boost::bind( &cvt_color_impl_, _1, which ) ) );
         }
+        else if( e[0] == "tiles" )
+        {
+            std::vector< std::string > s = comma::split( v[i].substr( v[i].find( '=' ) + 1 ), '|' );
+            std::vector< std::string > grid = comma::split( s[0], ',' );
+            if( e.size() < 2 || grid.size() != 2 || s.size() < 2 ) { COMMA_THROW( comma::exception, "expected tiles=<ncols>,<nrows>|<filter>|<filter>..., got: \"" << v[i] << "\"" ); }
+            unsigned int cols = boost::lexical_cast< unsigned int >( grid[0] );
+            unsigned int rows = boost::lexical_cast< unsigned int >( grid[1] );
+            if( cols == 0 || rows == 0 ) { COMMA_THROW( comma::exception, "tiles: expected positive number of tiles, got: \"" << v[i] << "\"" ); }
+            f.push_back( filter( tiles_impl_( cols, rows, comma::join( std::vector< std::string >( s.begin() + 1, s.end() ), ';' ) ), false ) );
+        }
+        else if( e[0] == "bayer-roi" )
+        {
+            if( modified ) { COMMA_THROW( comma::exception, "cannot covert from bayer after transforms: " << name ); }
+            if( e.size() < 2 ) { COMMA_THROW( comma::exception, "expected bayer-roi=<mode>[,<x>,<y>,<width>,<height>][,half], got: \"" << v[i] << "\"" ); }
+            std::vector< std::string > s = comma::split( e[1], ',' );
+            bool half = s.back() == "half";
+            if( half ) { s.pop_back(); }
+            if( s.size() != 1 && s.size() != 5 ) { COMMA_THROW( comma::exception, "expected bayer-roi=<mode>[,<x>,<y>,<width>,<height>][,half], got: \"" << v[i] << "\"" ); }
+            unsigned int which = boost::lexical_cast< unsigned int >( s[0] );
+            if( which < 1 || which > 4 ) { COMMA_THROW( comma::exception, "bayer-roi: expected mode 1-4, got " << which ); }
+            cv::Rect roi;
+            if( s.size() == 5 ) { roi = cv::Rect( boost::lexical_cast< unsigned int >( s[1] ), boost::lexical_cast< unsigned int >( s[2] ), boost::lexical_cast< unsigned int >( s[3] ), boost::lexical_cast< unsigned int >( s[4] ) ); }
+            if( half && ( roi.x % 2 || roi.y % 2 ) ) { COMMA_THROW( comma::exception, "bayer-roi: half: expected region at even column and row to keep bayer pattern, got " << roi.x << "," << roi.y ); }
+            f.push_back( filter( boost::bind( &bayer_roi_impl_, _1, which, roi, half ) ) );
+        }
         else if( e[0] == "count" )
         {
             count_impl_ c;
@@ -956,10 +1650,6 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
         {
             f.push_back( filter( boost::bind( &flip_impl_, _1, 1 ) ) );
         }
-        else if( e[0] == "magnitude" )
-        {
-            f.push_back( filter( boost::bind( &magnitude_impl_, _1 ) ) );
-        }
         else if( e[0] == "text" )
         {
             if( e.size() <= 1 ) { COMMA_THROW( comma::exception, "expected text value" ); }
@@ -979,16 +1669,6 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
             }
             f.push_back( filter( boost::bind( &text_impl_, _1, w[0], p, s ) ) );
         }
-        else if( e[0] == "convert-to" || e[0] == "convert_to" )
-        {
-            if( e.size() <= 1 ) { COMMA_THROW( comma::exception, "convert-to: expected options, got none" ); }
-            const std::vector< std::string >& w = comma::split( e[1], ',' );
-            boost::unordered_map< std::string, int >::const_iterator it = types_.find( w[0] );
-            if( it == types_.end() ) { COMMA_THROW( comma::exception, "convert-to: expected target type, got \"" << w[0] << "\"" ); }
-            double scale = w.size() > 1 ? boost::lexical_cast< double >( w[1] ) : 1.0;
-            double offset = w.size() > 2 ? boost::lexical_cast< double >( w[2] ) : 0.0;
-            f.push_back( filter( boost::bind( &convert_to_impl_, _1, it->second, scale, offset ) ) );
-        }
         else if( e[0] == "resize" )
         {
             unsigned int width = 0;
@@ -1012,13 +1692,13 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
             }
             f.push_back( filter( boost::bind( &resize_impl_, _1, width, height, w, h ) ) );
         }
-        else if( e[0] == "max" ) // todo: remove this filter; not thread-safe, should be run with --threads=1
-        {
-            f.push_back( filter( max_impl_( boost::lexical_cast< unsigned int >( e[1] ), true ), false ) );
-        }
-        else if( e[0] == "min" ) // todo: remove this filter; not thread-safe, should be run with --threads=1
+        else if( e[0] == "max" || e[0] == "min" || e[0] == "mean" )
         {
-            f.push_back( filter( max_impl_( boost::lexical_cast< unsigned int >( e[1] ), false ), false ) );
+            if( e.size() < 2 ) { COMMA_THROW( comma::exception, "expected number of frames, e.g. " << e[0] << "=10" ); }
+            unsigned int size = boost::lexical_cast< unsigned int >( e[1] );
+            if( size == 0 ) { COMMA_THROW( comma::exception, "expected positive number of frames in " << e[0] << " filter, got " << size ); }
+            sliding_window_impl_::operation_t operation = e[0] == "max" ? sliding_window_impl_::maximum : e[0] == "min" ? sliding_window_impl_::minimum : sliding_window_impl_::mean;
+            f.push_back( filter( sliding_window_impl_( size, operation ), false ) );
         }
         else if( e[0] == "timestamp" )
         {
@@ -1043,10 +1723,6 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
         {
             f.push_back( filter( undistort_impl_( e[1] ) ) );
         }
-        else if( e[0] == "invert" )
-        {
-            f.push_back( filter( &invert_impl_ ) );
-        }
         else if( e[0] == "view" )
         {
             unsigned int delay = e.size() == 1 ? default_delay : boost::lexical_cast< unsigned int >( e[1] );
@@ -1072,8 +1748,8 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
                 if( next_filter != "head" ) COMMA_THROW( comma::exception, "cannot have a filter after encode unless next filter is head" );
             }
             if( e.size() < 2 ) { COMMA_THROW( comma::exception, "expected encoding type like jpg, ppm, etc" ); }
-            std::string s = e[1];
-            f.push_back( filter( boost::bind( &encode_impl_, _1, s ) ) );
+            std::vector< std::string > s = comma::split( e[1], ',' );
+            f.push_back( filter( encode_impl_( s[0], s.size() > 1 ? s[1] : "" ) ) );
         }
         else if( e[0] == "grab" )
         {
@@ -1129,22 +1805,6 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
             if( i == 0 ) { COMMA_THROW( comma::exception, "'null' as the only filter is not supported; use cv-cat > /dev/null, if you need" ); }
             f.push_back( filter( NULL ) );
         }
-        else if( e[0] == "brightness" )
-        {
-            const std::vector< std::string >& s = comma::split( e[1], ',' );
-            double scale = boost::lexical_cast< double >( s[0] );
-            double offset = s.size() == 1 ? 0.0 : boost::lexical_cast< double >( s[1] );
-            f.push_back( filter( boost::bind( &brightness_impl_, _1, scale, offset ) ) );
-        }
-        else if( e[0] == "map" )
-        {
-            if( e.size() < 2 ) { COMMA_THROW( comma::exception, "expected file name with the map, e.g. map=f.csv" ); }
-            std::stringstream s; s << e[1]; for( std::size_t i = 2; i < e.size(); ++i ) { s << "=" << e[i]; }
-            std::string map_filter_options = s.str();
-            std::vector< std::string > items = comma::split( map_filter_options, '&' );
-            bool permissive = std::find( items.begin()+1, items.end(), "permissive" ) != items.end();
-            f.push_back( filter( map_impl_( map_filter_options, permissive ) ) );
-        }
         else if ( e[0] == "head" )
         {
             if( i < v.size()-1 )
@@ -1156,31 +1816,16 @@ std::vector< filter > filters::make( const std::string& how, unsigned int defaul
             unsigned int n = boost::lexical_cast< unsigned int >( e[1] );
             f.push_back( filter( boost::bind( &head_impl_, _1, n ) ) );
         }
-        else if( e[0] == "threshold" )
-        {
-            const std::vector< std::string >& s = comma::split( e[1], ',' );
-            if( s[0].empty() ) { COMMA_THROW( comma::exception, "threshold: expected <threshold>[,<max_value>[,<type>]] got: \"" << v[i] << "\"" ); }
-            double threshold = boost::lexical_cast< double >( s[0] );
-            double maxval = s.size() < 2 ? 255 : boost::lexical_cast< double >( s[1] );
-            threshold_t::types type = threshold_t::from_string( s.size() < 3 ? "" : s[2] );
-            f.push_back( filter( boost::bind( &threshold_impl_, _1, threshold, maxval, type ) ) );
-        }
-        else if( e[0] == "linear-combination" )
-        {
-            const std::vector< std::string >& s = comma::split( e[1], ',' );
-            if( s[0].empty() ) { COMMA_THROW( comma::exception, "linear-combination: expected coefficients got: \"" << v[i] << "\"" ); }
-            std::vector< double > coefficients( s.size() );
-            for( unsigned int j = 0; j < s.size(); ++j ) { coefficients[j] = boost::lexical_cast< double >( s[j] ); }
-            f.push_back( filter( boost::bind( &linear_combination_impl_, _1, coefficients ) ) );
-        }
         else
         {
             const boost::optional< filter >& vf = imaging::vegetation::filters::make( v[i] );
             if( !vf ) { COMMA_THROW( comma::exception, "expected filter, got \"" << v[i] << "\"" ); }
             f.push_back( *vf );
         }
+        for( std::size_t k = size; k < f.size(); ++k ) { f[k].name = e[0]; }
         modified = ( v[i] != "view" && v[i] != "thumb" && v[i] != "split" );
     }
+    flush_pointwise_( f, pointwise );
     return f;
 }
 
@@ -1197,6 +1842,9 @@ static std::string usage_impl_()
     oss << "        accumulate=<n>: accumulate the last n images and concatenate them vertically (useful for slit-scan and spectral cameras like pika2)" << std::endl;
     oss << "            example: cat slit-scan.bin | cv-cat \"accumulate=400;view;null\"" << std::endl;
     oss << "        bayer=<mode>: convert from bayer, <mode>=1-4" << std::endl;
+    oss << "        bayer-roi=<mode>[,<x>,<y>,<width>,<height>][,half]: convert from bayer only the given region, same as bayer=<mode>;crop=..., but faster" << std::endl;
+    oss << "            half: convert at half resolution, one colour pixel per 2x2 bayer cell, i.e. instead of bayer=<mode>;crop=...;resize=0.5;" << std::endl;
+    oss << "                  <x> and <y> have to be even to keep bayer pattern" << std::endl;
     oss << "        brightness=<scale>[,<offset>]: output=(scale*input)+offset; default offset=0" << std::endl;
     oss << "        convert-to,convert_to=<type>[,<scale>[,<offset>]]: convert to given type; should be the same number of channels; see opencv convertTo for details" << std::endl;
     oss << "        count: write frame number on images" << std::endl;
@@ -1206,7 +1854,9 @@ static std::string usage_impl_()
     oss << "            example: \"crop-tile=2,5,1,0,1,4&horizontal\"" << std::endl;
     oss << "            deprecated: old syntax <i>,<j>,<ncols>,<nrows> is used for one tile if i < ncols and j < ncols" << std::endl;
     oss << "        cross[=<x>,<y>]: draw cross-hair at x,y; default: at image center" << std::endl;
-    oss << "        encode=<format>: encode images to the specified format. <format>: jpg|ppm|png|tiff..., make sure to use --no-header" << std::endl;
+    oss << "        encode=<format>[,<quality>]: encode images to the specified format. <format>: jpg|ppm|png|tiff..., make sure to use --no-header" << std::endl;
+    oss << "            <quality>: jpg and png only; fast|balanced|best or jpg quality 0-100, png compression level 0-9" << std::endl;
+    oss << "                fast: jpg quality 75, png compression 1; balanced: 90, 3; best: 100, 9; default: opencv defaults" << std::endl;
     oss << "        equalize-histogram: todo: equalize each channel by its histogram" << std::endl;
     oss << "        fft[=<options>]: do fft on a floating point image" << std::endl;
     oss << "            options: inverse: do inverse fft" << std::endl;
@@ -1230,7 +1880,10 @@ static std::string usage_impl_()
     oss << "             <permissive>: if present, integer values in the input are simply copied to the output unless they are in the map" << std::endl;
     oss << "                  default: filter fails with an error message if it encounters an integer value which is not in the map" << std::endl;
     oss << "             example: \"map=map.bin&fields=,key,value&binary=2ui,d\"" << std::endl;
+    oss << "        max=<n>: per-pixel maximum over the last n frames (sliding window)" << std::endl;
+    oss << "        mean=<n>: per-pixel mean over the last n frames (sliding window)" << std::endl;
     oss << "        merge=<n>: split an image into n horizontal bands of equal height and merge them into an n-channel image (the number of rows must be a multiple of n)" << std::endl;
+    oss << "        min=<n>: per-pixel minimum over the last n frames (sliding window)" << std::endl;
     oss << "        normalize=<how>: todo: normalize image" << std::endl;
     oss << "            normalize=max: normalize each pixel channel by its max value" << std::endl;
     oss << "            normalize=sum: normalize each pixel channel by the sum of all channels" << std::endl;
@@ -1249,12 +1902,19 @@ static std::string usage_impl_()
     oss << "        thumb[=<cols>[,<wait-interval>]]: view resized image; a convenience for debugging and filter pipeline monitoring" << std::endl;
     oss << "                                          <cols>: image width in pixels; default: 100" << std::endl;
     oss << "                                          <wait-interval>: a hack for now; milliseconds to wait for image display and key press; default: 1" << std::endl;
+    oss << "        tiles=<ncols>,<nrows>|<filter>|<filter>...: divide the image into a grid of tiles (ncols-by-nrows), apply '|'-separated filters" << std::endl;
+    oss << "            to each tile in parallel without copying the tiles, and put the filtered tiles back together in the same order" << std::endl;
+    oss << "            example: \"tiles=4,4|threshold=128|resize=0.5\"" << std::endl;
     oss << "        timestamp: write timestamp on images" << std::endl;
     oss << "        transpose: transpose the image (swap rows and columns)" << std::endl;
     oss << "        undistort=<undistort map file>: undistort" << std::endl;
+    oss << "            <undistort map file>: fixed-point maps as output by image-undistort-map --fixed-point (faster), or float x and y maps" << std::endl;
     oss << "        view[=<wait-interval>]: view image; press <space> to save image (timestamp or system time as filename); <esc>: to close" << std::endl;
     oss << "                                <wait-interval>: a hack for now; milliseconds to wait for image display and key press; default 1" << std::endl;
     oss << std::endl;
+    oss << "        consecutive per-pixel filters (brightness, convert-to, invert, linear-combination, magnitude, map, threshold)" << std::endl;
+    oss << "        are fused and applied in a single pass over the image, e.g. \"convert-to=f,0.0039;brightness=2,10;threshold=0.5\"" << std::endl;
+    oss << std::endl;
     oss << "    cv::Mat image operations:" << std::endl;
     oss << "        simple-blob[=<parameters>]: wraps cv::SimpleBlobDetector, outputs as csv key points timestamped by image timestamp" << std::endl;
     oss << "            <parameters>" << std::endl;
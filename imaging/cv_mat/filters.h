@@ -31,6 +31,7 @@
 #ifndef SNARK_IMAGING_CVMAT_FILTERS_H_
 #define SNARK_IMAGING_CVMAT_FILTERS_H_
 
+#include <string>
 #include <vector>
 #include <boost/function.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -48,6 +49,8 @@ struct operation
     operation( boost::function< output_type( value_type ) > f, bool p = true ): filter_function( f ), parallel( p ) {}
     boost::function< output_type( value_type ) > filter_function;
     bool parallel;
+    /// filter name as in the filter string, e.g. for profiling
+    std::string name;
 };
 
 typedef operation<> filter;
@@ -0,0 +1,474 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <boost/bind.hpp>
+#include <comma/base/exception.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include "image_log.h"
+#include "pool.h"
+
+namespace snark{ namespace cv_mat {
+
+static const char* magic_ = "snarklog";
+static const char* index_magic_ = "snarkidx";
+static const comma::uint32 version_ = 1;
+static const std::size_t band_size_ = 262144; // bytes; small enough for a few bands per frame to share the work between threads
+static const std::size_t frame_header_size_ = 1 + sizeof( comma::int64 ) + 5 * sizeof( comma::uint32 );
+static const std::size_t band_header_size_ = 1 + sizeof( comma::uint32 );
+static const std::size_t trailer_size_ = sizeof( comma::uint64 ) + 8;
+static const unsigned int escape_ = 24; // maximum unary code length, after which a residual is stored verbatim
+
+static const boost::posix_time::ptime& epoch_() { static const boost::posix_time::ptime epoch( boost::gregorian::date( 1970, 1, 1 ) ); return epoch; }
+
+static comma::int64 to_microseconds_( const boost::posix_time::ptime& t ) { return t.is_special() ? std::numeric_limits< comma::int64 >::min() : ( t - epoch_() ).total_microseconds(); }
+
+static boost::posix_time::ptime from_microseconds_( comma::int64 t ) { return t == std::numeric_limits< comma::int64 >::min() ? boost::posix_time::ptime() : epoch_() + boost::posix_time::microseconds( t ); }
+
+template < typename T > static void put_( std::vector< char >& buffer, const T& t )
+{
+    const char* p = reinterpret_cast< const char* >( &t );
+    buffer.insert( buffer.end(), p, p + sizeof( T ) );
+}
+
+template < typename T > static T get_( const char*& p )
+{
+    T t;
+    ::memcpy( &t, p, sizeof( T ) );
+    p += sizeof( T );
+    return t;
+}
+
+/// bits are written least significant first
+class bit_writer_
+{
+    public:
+        bit_writer_( std::vector< unsigned char >& buffer ) : buffer_( buffer ), bits_( 0 ), count_( 0 ) {}
+
+        void put( comma::uint32 value, unsigned int n )
+        {
+            bits_ |= comma::uint64( value ) << count_;
+            count_ += n;
+            for( ; count_ >= 8; bits_ >>= 8, count_ -= 8 ) { buffer_.push_back( bits_ & 0xff ); }
+        }
+
+        void flush() { if( count_ > 0 ) { buffer_.push_back( bits_ & 0xff ); } bits_ = 0; count_ = 0; }
+
+    private:
+        std::vector< unsigned char >& buffer_;
+        comma::uint64 bits_;
+        unsigned int count_;
+};
+
+/// reads zeros past the end of data, see overrun()
+class bit_reader_
+{
+    public:
+        bit_reader_( const unsigned char* begin, const unsigned char* end ) : p_( begin ), end_( end ), bits_( 0 ), count_( 0 ), past_( 0 ) {}
+
+        comma::uint32 get( unsigned int n )
+        {
+            for( ; count_ < n; count_ += 8 )
+            {
+                if( p_ < end_ ) { bits_ |= comma::uint64( *p_++ ) << count_; } else { ++past_; }
+            }
+            comma::uint32 value = bits_ & ( ( comma::uint64( 1 ) << n ) - 1 );
+            bits_ >>= n;
+            count_ -= n;
+            return value;
+        }
+
+        /// @return true, if more bits were read than there are in data
+        bool overrun() const { return past_ * 8 > count_; }
+
+    private:
+        const unsigned char* p_;
+        const unsigned char* end_;
+        comma::uint64 bits_;
+        unsigned int count_;
+        std::size_t past_;
+};
+
+/// adaptive rice parameter from running mean of coded values, as in LOCO-I
+class rice_parameter_
+{
+    public:
+        rice_parameter_() : a_( 4 ), n_( 1 ) {}
+
+        unsigned int k() const { unsigned int k = 0; while( ( n_ << k ) < a_ ) { ++k; } return k; }
+
+        void update( comma::uint32 u ) { a_ += u; if( ++n_ == 64 ) { a_ >>= 1; n_ >>= 1; } }
+
+    private:
+        comma::uint32 a_;
+        comma::uint32 n_;
+};
+
+/// median edge detector prediction from left, above, and above-left neighbours of the same colour
+template < typename T >
+static int predict_( const T* row, const T* above, int j, int dh )
+{
+    if( !above ) { return j < dh ? 0 : row[ j - dh ]; }
+    if( j < dh ) { return above[j]; }
+    int a = row[ j - dh ];
+    int b = above[j];
+    int c = above[ j - dh ];
+    if( c >= std::max( a, b ) ) { return std::min( a, b ); }
+    if( c <= std::min( a, b ) ) { return std::max( a, b ); }
+    return a + b - c;
+}
+
+/// neighbours of the same colour: for single-channel, e.g. bayer, images, every other row and column; otherwise the same channel
+static int horizontal_distance_( const cv::Mat& m ) { return m.channels() == 1 ? 2 : m.channels(); }
+static int vertical_distance_( const cv::Mat& m ) { return m.channels() == 1 ? 2 : 1; }
+
+template < typename T >
+static void compress_( const cv::Mat& m, int begin, int end, std::vector< unsigned char >& buffer )
+{
+    const unsigned int bits = sizeof( T ) * 8;
+    const comma::uint32 mask = ( comma::uint32( 1 ) << bits ) - 1;
+    const int dh = horizontal_distance_( m );
+    const int dv = vertical_distance_( m );
+    const int n = m.cols * m.channels();
+    bit_writer_ writer( buffer );
+    rice_parameter_ parameter;
+    for( int i = begin; i < end; ++i )
+    {
+        const T* row = m.ptr< T >( i );
+        const T* above = i - dv >= begin ? m.ptr< T >( i - dv ) : NULL;
+        for( int j = 0; j < n; ++j )
+        {
+            comma::uint32 e = comma::uint32( row[j] - predict_( row, above, j, dh ) ) & mask;
+            comma::uint32 u = e > ( mask >> 1 ) ? ( ( mask - e ) << 1 ) + 1 : e << 1; // residual modulo 2^bits, zigzag-coded
+            unsigned int k = parameter.k();
+            comma::uint32 q = u >> k;
+            if( q < escape_ ) { writer.put( ( comma::uint32( 1 ) << q ) - 1, q + 1 ); writer.put( u & ( ( comma::uint32( 1 ) << k ) - 1 ), k ); }
+            else { writer.put( ( comma::uint32( 1 ) << escape_ ) - 1, escape_ ); writer.put( u, bits ); }
+            parameter.update( u );
+        }
+    }
+    writer.flush();
+}
+
+template < typename T >
+static void decompress_( const unsigned char* data, std::size_t size, cv::Mat& m, int begin, int end )
+{
+    const unsigned int bits = sizeof( T ) * 8;
+    const comma::uint32 mask = ( comma::uint32( 1 ) << bits ) - 1;
+    const int dh = horizontal_distance_( m );
+    const int dv = vertical_distance_( m );
+    const int n = m.cols * m.channels();
+    bit_reader_ reader( data, data + size );
+    rice_parameter_ parameter;
+    for( int i = begin; i < end; ++i )
+    {
+        T* row = m.ptr< T >( i );
+        const T* above = i - dv >= begin ? m.ptr< T >( i - dv ) : NULL;
+        for( int j = 0; j < n; ++j )
+        {
+            unsigned int k = parameter.k();
+            comma::uint32 q = 0;
+            while( q < escape_ && reader.get( 1 ) ) { ++q; }
+            comma::uint32 u = q < escape_ ? ( q << k ) | reader.get( k ) : reader.get( bits );
+            comma::uint32 e = u & 1 ? mask - ( u >> 1 ) : u >> 1;
+            row[j] = T( ( predict_( row, above, j, dh ) + e ) & mask );
+            parameter.update( u );
+        }
+        if( reader.overrun() ) { COMMA_THROW( comma::exception, "snark-log: compressed band of rows " << begin << " to " << end << " is shorter than its image data; corrupted log?" ); }
+    }
+}
+
+static bool compressible_( const cv::Mat& m ) { return m.depth() == CV_8U || m.depth() == CV_8S || m.depth() == CV_16U || m.depth() == CV_16S; }
+
+static int band_rows_( const cv::Mat& m )
+{
+    std::size_t row_size = m.cols * m.elemSize();
+    int rows = row_size == 0 ? 2 : int( band_size_ / row_size ) & ~1; // even number of rows, for bayer
+    return std::max( 2, rows );
+}
+
+struct compress_body_
+{
+    const cv::Mat& m;
+    int band_rows;
+    bool compress;
+    std::vector< std::vector< unsigned char > >& bands;
+    std::vector< unsigned char >& codecs;
+
+    compress_body_( const cv::Mat& m, int band_rows, bool compress, std::vector< std::vector< unsigned char > >& bands, std::vector< unsigned char >& codecs )
+        : m( m ), band_rows( band_rows ), compress( compress ), bands( bands ), codecs( codecs ) {}
+
+    void operator()( const ::tbb::blocked_range< int >& r ) const
+    {
+        for( int b = r.begin(); b < r.end(); ++b )
+        {
+            int begin = b * band_rows;
+            int end = std::min( m.rows, begin + band_rows );
+            std::size_t row_size = m.cols * m.elemSize();
+            std::vector< unsigned char >& buffer = bands[b];
+            buffer.clear();
+            if( compress )
+            {
+                if( m.elemSize1() == 1 ) { compress_< unsigned char >( m, begin, end, buffer ); }
+                else { compress_< comma::uint16 >( m, begin, end, buffer ); }
+                if( buffer.size() < row_size * ( end - begin ) ) { codecs[b] = image_log::rice; continue; }
+                buffer.clear();
+            }
+            codecs[b] = image_log::raw;
+            for( int i = begin; i < end; ++i ) { buffer.insert( buffer.end(), m.ptr( i ), m.ptr( i ) + row_size ); }
+        }
+    }
+};
+
+struct decompress_body_
+{
+    const std::vector< const char* >& data;
+    const std::vector< std::pair< unsigned char, comma::uint32 > >& bands;
+    int band_rows;
+    cv::Mat& m;
+
+    decompress_body_( const std::vector< const char* >& data, const std::vector< std::pair< unsigned char, comma::uint32 > >& bands, int band_rows, cv::Mat& m )
+        : data( data ), bands( bands ), band_rows( band_rows ), m( m ) {}
+
+    void operator()( const ::tbb::blocked_range< int >& r ) const
+    {
+        for( int b = r.begin(); b < r.end(); ++b )
+        {
+            int begin = b * band_rows;
+            int end = std::min( m.rows, begin + band_rows );
+            const unsigned char* p = reinterpret_cast< const unsigned char* >( data[b] );
+            if( bands[b].first == image_log::raw ) { ::memcpy( m.ptr( begin ), p, bands[b].second ); continue; } // m is continuous
+            if( m.elemSize1() == 1 ) { decompress_< unsigned char >( p, bands[b].second, m, begin, end ); }
+            else { decompress_< comma::uint16 >( p, bands[b].second, m, begin, end ); }
+        }
+    }
+};
+
+image_log::writer::writer( bool compress ) : compress_( compress ), started_( false ), closed_( false ), offset_( 0 ) {}
+
+void image_log::writer::write( std::ostream& os, const std::pair< boost::posix_time::ptime, cv::Mat >& m )
+{
+    if( closed_ ) { COMMA_THROW( comma::exception, "snark-log: cannot write after the log is closed" ); }
+    std::vector< char > header;
+    if( !started_ )
+    {
+        header.insert( header.end(), magic_, magic_ + 8 );
+        put_( header, version_ );
+        started_ = true;
+    }
+    const cv::Mat& image = m.second;
+    int band_rows = band_rows_( image );
+    int number_of_bands = ( image.rows + band_rows - 1 ) / band_rows;
+    if( bands_.size() < std::size_t( number_of_bands ) ) { bands_.resize( number_of_bands ); }
+    codecs_.resize( number_of_bands );
+    ::tbb::parallel_for( ::tbb::blocked_range< int >( 0, number_of_bands ), compress_body_( image, band_rows, compress_ && compressible_( image ), bands_, codecs_ ) );
+    index_.push_back( std::make_pair( to_microseconds_( m.first ), offset_ + header.size() ) );
+    header.push_back( 'f' );
+    put_( header, to_microseconds_( m.first ) );
+    put_( header, comma::uint32( image.rows ) );
+    put_( header, comma::uint32( image.cols ) );
+    put_( header, comma::uint32( image.type() ) );
+    put_( header, comma::uint32( band_rows ) );
+    put_( header, comma::uint32( number_of_bands ) );
+    for( int b = 0; b < number_of_bands; ++b ) { header.push_back( codecs_[b] ); put_( header, comma::uint32( bands_[b].size() ) ); }
+    os.write( &header[0], header.size() );
+    offset_ += header.size();
+    for( int b = 0; b < number_of_bands; ++b )
+    {
+        if( bands_[b].empty() ) { continue; }
+        os.write( reinterpret_cast< const char* >( &bands_[b][0] ), bands_[b].size() );
+        offset_ += bands_[b].size();
+    }
+    os.flush();
+}
+
+void image_log::writer::close( std::ostream& os )
+{
+    if( closed_ ) { return; }
+    std::vector< char > buffer;
+    if( !started_ ) { buffer.insert( buffer.end(), magic_, magic_ + 8 ); put_( buffer, version_ ); started_ = true; }
+    comma::uint64 offset = offset_ + buffer.size();
+    buffer.push_back( 'i' );
+    put_( buffer, comma::uint64( index_.size() ) );
+    for( std::size_t i = 0; i < index_.size(); ++i ) { put_( buffer, index_[i].first ); put_( buffer, index_[i].second ); }
+    put_( buffer, offset );
+    buffer.insert( buffer.end(), index_magic_, index_magic_ + 8 );
+    os.write( &buffer[0], buffer.size() );
+    os.flush();
+    closed_ = true;
+}
+
+struct image_log::reader::record
+{
+    boost::posix_time::ptime t;
+    comma::uint32 rows;
+    comma::uint32 cols;
+    comma::uint32 type;
+    comma::uint32 band_rows;
+    std::vector< std::pair< unsigned char, comma::uint32 > > bands;
+    std::size_t size;
+};
+
+image_log::reader::reader() : started_( false ), done_( false ) {}
+
+bool image_log::reader::start_( std::istream& is )
+{
+    if( started_ ) { return !done_; }
+    started_ = true;
+    char header[12];
+    is.read( header, 12 );
+    if( is.gcount() == 0 ) { done_ = true; return false; }
+    if( is.gcount() < 12 || ::memcmp( header, magic_, 8 ) != 0 ) { COMMA_THROW( comma::exception, "snark-log: expected file header, got something else" ); }
+    const char* p = header + 8;
+    comma::uint32 version = get_< comma::uint32 >( p );
+    if( version != version_ ) { COMMA_THROW( comma::exception, "snark-log: expected version " << version_ << ", got " << version ); }
+    return true;
+}
+
+/// read frame record header; stop at the index or at the end of a truncated log
+bool image_log::reader::read_record_( std::istream& is, record& r )
+{
+    char header[ frame_header_size_ ];
+    is.read( header, frame_header_size_ );
+    if( is.gcount() == 0 || header[0] == 'i' ) { done_ = true; return false; }
+    if( header[0] != 'f' ) { COMMA_THROW( comma::exception, "snark-log: expected frame record, got record of type '" << header[0] << "'" ); }
+    if( is.gcount() < int( frame_header_size_ ) ) { done_ = true; return false; }
+    const char* p = header + 1;
+    r.t = from_microseconds_( get_< comma::int64 >( p ) );
+    r.rows = get_< comma::uint32 >( p );
+    r.cols = get_< comma::uint32 >( p );
+    r.type = get_< comma::uint32 >( p );
+    r.band_rows = get_< comma::uint32 >( p );
+    comma::uint32 number_of_bands = get_< comma::uint32 >( p );
+    if( r.rows > comma::uint32( std::numeric_limits< int >::max() ) || r.cols > comma::uint32( std::numeric_limits< int >::max() ) ) { COMMA_THROW( comma::exception, "snark-log: expected image size that fits int, got " << r.rows << "x" << r.cols << "; corrupted log?" ); }
+    if( r.type != comma::uint32( CV_MAT_TYPE( r.type ) ) ) { COMMA_THROW( comma::exception, "snark-log: expected image type, got " << r.type << "; corrupted log?" ); }
+    if( r.band_rows == 0 ) { COMMA_THROW( comma::exception, "snark-log: expected positive number of rows per band, got 0; corrupted log?" ); }
+    if( number_of_bands != ( comma::uint64( r.rows ) + r.band_rows - 1 ) / r.band_rows ) { COMMA_THROW( comma::exception, "snark-log: expected " << ( comma::uint64( r.rows ) + r.band_rows - 1 ) / r.band_rows << " band(s) for " << r.rows << " rows of " << r.band_rows << " rows per band, got " << number_of_bands << "; corrupted log?" ); }
+    buffer_.resize( number_of_bands * band_header_size_ );
+    if( number_of_bands > 0 ) { is.read( &buffer_[0], buffer_.size() ); }
+    if( is.gcount() < int( buffer_.size() ) ) { done_ = true; return false; }
+    r.bands.resize( number_of_bands );
+    r.size = 0;
+    p = buffer_.empty() ? NULL : &buffer_[0];
+    comma::uint64 row_size = comma::uint64( r.cols ) * CV_ELEM_SIZE( r.type );
+    for( comma::uint32 b = 0; b < number_of_bands; ++b )
+    {
+        r.bands[b].first = get_< unsigned char >( p );
+        r.bands[b].second = get_< comma::uint32 >( p );
+        r.size += r.bands[b].second;
+        comma::uint64 rows = std::min( comma::uint64( r.band_rows ), r.rows - comma::uint64( b ) * r.band_rows );
+        switch( r.bands[b].first )
+        {
+            case image_log::raw:
+                if( r.bands[b].second != rows * row_size ) { COMMA_THROW( comma::exception, "snark-log: expected raw band " << b << " of " << rows * row_size << " bytes, got " << r.bands[b].second << " bytes; corrupted log?" ); }
+                break;
+            case image_log::rice:
+                if( CV_ELEM_SIZE1( r.type ) > 2 ) { COMMA_THROW( comma::exception, "snark-log: expected compressed band " << b << " of 8- or 16-bit image, got image type " << r.type << "; corrupted log?" ); }
+                break;
+            default:
+                COMMA_THROW( comma::exception, "snark-log: expected band codec " << image_log::raw << " or " << image_log::rice << ", got " << int( r.bands[b].first ) << "; corrupted log?" );
+        }
+    }
+    return true;
+}
+
+std::pair< boost::posix_time::ptime, cv::Mat > image_log::reader::decode_( std::istream& is, const record& r )
+{
+    buffer_.resize( r.size );
+    if( r.size > 0 ) { is.read( &buffer_[0], r.size ); }
+    if( is.gcount() < std::streamsize( r.size ) ) { done_ = true; return std::pair< boost::posix_time::ptime, cv::Mat >(); }
+    std::pair< boost::posix_time::ptime, cv::Mat > frame( r.t, pool::instance().make( r.rows, r.cols, r.type ) );
+    std::vector< const char* > data( r.bands.size() );
+    for( std::size_t b = 0, offset = 0; b < r.bands.size(); offset += r.bands[b].second, ++b ) { data[b] = &buffer_[0] + offset; }
+    ::tbb::parallel_for( ::tbb::blocked_range< int >( 0, r.bands.size() ), decompress_body_( data, r.bands, r.band_rows, frame.second ) );
+    return frame;
+}
+
+std::pair< boost::posix_time::ptime, cv::Mat > image_log::reader::read( std::istream& is )
+{
+    if( !pending_.second.empty() ) { std::pair< boost::posix_time::ptime, cv::Mat > p = pending_; pending_ = std::pair< boost::posix_time::ptime, cv::Mat >(); return p; }
+    record r;
+    if( !start_( is ) || done_ || !read_record_( is, r ) ) { return std::pair< boost::posix_time::ptime, cv::Mat >(); }
+    return decode_( is, r );
+}
+
+void image_log::reader::seek( std::istream& is, const boost::posix_time::ptime& t )
+{
+    if( !start_( is ) ) { return; }
+    comma::int64 microseconds = to_microseconds_( t );
+    std::istream::pos_type position = is.tellg();
+    if( position != std::istream::pos_type( -1 ) && is.seekg( -std::streamoff( trailer_size_ ), std::ios::end ) )
+    {
+        char trailer[ trailer_size_ ];
+        is.read( trailer, trailer_size_ );
+        if( is.gcount() == int( trailer_size_ ) && ::memcmp( trailer + sizeof( comma::uint64 ), index_magic_, 8 ) == 0 )
+        {
+            const char* p = trailer;
+            comma::uint64 index_offset = get_< comma::uint64 >( p );
+            comma::uint64 index_end = comma::uint64( is.tellg() ) - trailer_size_;
+            const comma::uint64 entry_size = sizeof( comma::int64 ) + sizeof( comma::uint64 );
+            if( index_offset > index_end || index_end - index_offset < 1 + sizeof( comma::uint64 ) ) { COMMA_THROW( comma::exception, "snark-log: expected index offset before " << ( index_end - 1 - sizeof( comma::uint64 ) ) << ", got " << index_offset << "; corrupted log?" ); }
+            is.seekg( index_offset + 1 );
+            char count_buffer[ sizeof( comma::uint64 ) ];
+            is.read( count_buffer, sizeof( comma::uint64 ) );
+            p = count_buffer;
+            comma::uint64 count = get_< comma::uint64 >( p );
+            if( count > ( index_end - index_offset - 1 - sizeof( comma::uint64 ) ) / entry_size ) { COMMA_THROW( comma::exception, "snark-log: expected index of " << ( index_end - index_offset - 1 - sizeof( comma::uint64 ) ) / entry_size << " entries at most, got " << count << " entries; corrupted log?" ); }
+            std::vector< std::pair< comma::int64, comma::uint64 > > index( count );
+            for( comma::uint64 i = 0; i < count; ++i )
+            {
+                char entry[ sizeof( comma::int64 ) + sizeof( comma::uint64 ) ];
+                is.read( entry, sizeof( entry ) );
+                p = entry;
+                index[i].first = get_< comma::int64 >( p );
+                index[i].second = get_< comma::uint64 >( p );
+            }
+            if( !is ) { COMMA_THROW( comma::exception, "snark-log: failed to read index" ); }
+            std::vector< std::pair< comma::int64, comma::uint64 > >::const_iterator it = std::lower_bound( index.begin(), index.end(), std::make_pair( microseconds, comma::uint64( 0 ) ) );
+            is.seekg( it == index.end() ? index_offset : it->second );
+            pending_ = std::pair< boost::posix_time::ptime, cv::Mat >();
+            return;
+        }
+        is.clear();
+        is.seekg( position );
+    }
+    is.clear();
+    record r;
+    while( pending_.second.empty() && !done_ && read_record_( is, r ) )
+    {
+        if( to_microseconds_( r.t ) >= microseconds ) { pending_ = decode_( is, r ); }
+        else { is.ignore( r.size ); }
+    }
+}
+
+} } // namespace snark{ namespace cv_mat {
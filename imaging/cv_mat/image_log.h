@@ -0,0 +1,109 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_IMAGING_CVMAT_IMAGE_LOG_H_
+#define SNARK_IMAGING_CVMAT_IMAGE_LOG_H_
+
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
+#include <opencv2/core/core.hpp>
+
+namespace snark{ namespace cv_mat {
+
+/// snark-log: image log container with lossless compression and an index for seeking by time
+///
+/// layout (host byte order, same as cv_mat::serialization)
+///     file header: "snarklog", uint32 version
+///     frame record: uint8 'f', int64 timestamp (microseconds since epoch), uint32 rows, cols, type, band rows, number of bands,
+///                   then for each band: uint8 codec, uint32 size; then the data of all bands
+///     index record: uint8 'i', uint64 number of frames, then for each frame: int64 timestamp, uint64 offset of the frame record
+///     trailer: uint64 offset of the index record, "snarkidx"
+///
+/// frames are split into bands of rows, each compressed independently, so that bands are compressed and decompressed in parallel
+/// codec: 8- and 16-bit images are compressed with prediction from neighbours of the same colour (every other row and column
+/// for single-channel, e.g. bayer, images) and adaptive rice coding of residuals; other types and incompressible bands are stored raw
+struct image_log
+{
+    enum codec { raw = 0, rice = 1 };
+
+    class writer
+    {
+        public:
+            /// constructor
+            /// @param compress if false, store frames raw, e.g. to index uncompressed logs
+            writer( bool compress = true );
+
+            /// write frame; the file header is written before the first frame
+            void write( std::ostream& os, const std::pair< boost::posix_time::ptime, cv::Mat >& m );
+
+            /// write index and trailer; call once after the last frame
+            void close( std::ostream& os );
+
+        private:
+            bool compress_;
+            bool started_;
+            bool closed_;
+            comma::uint64 offset_;
+            std::vector< std::pair< comma::int64, comma::uint64 > > index_;
+            std::vector< std::vector< unsigned char > > bands_;
+            std::vector< unsigned char > codecs_;
+    };
+
+    class reader
+    {
+        public:
+            reader();
+
+            /// read next frame
+            /// @return empty matrix at the end of frames
+            std::pair< boost::posix_time::ptime, cv::Mat > read( std::istream& is );
+
+            /// position stream at the first frame with timestamp not less than given time
+            /// uses the index, if the stream is seekable; otherwise skips frames without decompressing them
+            void seek( std::istream& is, const boost::posix_time::ptime& t );
+
+            struct record;
+
+        private:
+            bool started_;
+            bool done_;
+            std::pair< boost::posix_time::ptime, cv::Mat > pending_;
+            std::vector< char > buffer_;
+            bool start_( std::istream& is );
+            bool read_record_( std::istream& is, record& r );
+            std::pair< boost::posix_time::ptime, cv::Mat > decode_( std::istream& is, const record& r );
+    };
+};
+
+} } // namespace snark{ namespace cv_mat {
+
+#endif // SNARK_IMAGING_CVMAT_IMAGE_LOG_H_
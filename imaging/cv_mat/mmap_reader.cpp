@@ -0,0 +1,142 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <comma/base/exception.h>
+#include "mmap_reader.h"
+
+namespace snark{ namespace cv_mat {
+
+mmap_reader::mmap_reader( const config& c )
+    : m_config( c )
+    , m_serialization( c.options )
+    , m_fd( -1 )
+    , m_begin( NULL )
+    , m_file_size( 0 )
+    , m_page_size( 4096 )
+    , m_end( 0 )
+    , m_frame( 0 )
+{
+    if( !c.options.format.empty() ) { COMMA_THROW( comma::exception, "memory-mapped image reader: expected raw images, got format: " << c.options.format ); }
+    #ifdef WIN32
+    COMMA_THROW( comma::exception, "memory-mapped image reader: not implemented on windows" );
+    #else
+    m_fd = ::open( c.filename.c_str(), O_RDONLY );
+    if( m_fd < 0 ) { COMMA_THROW( comma::exception, "failed to open image file " << c.filename ); }
+    struct stat s;
+    if( ::fstat( m_fd, &s ) != 0 ) { ::close( m_fd ); COMMA_THROW( comma::exception, "failed to get size of image file " << c.filename ); }
+    m_file_size = s.st_size;
+    if( m_file_size == 0 ) { return; }
+    void* p = ::mmap( NULL, m_file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, 0 ); // private writable mapping: copy on write
+    if( p == MAP_FAILED ) { ::close( m_fd ); COMMA_THROW( comma::exception, "failed to map image file " << c.filename ); }
+    m_begin = static_cast< const char* >( p );
+    ::madvise( p, m_file_size, MADV_SEQUENTIAL );
+    m_page_size = ::sysconf( _SC_PAGESIZE );
+    #endif
+}
+
+mmap_reader::~mmap_reader() { close(); }
+
+void mmap_reader::close()
+{
+    #ifndef WIN32
+    if( m_begin ) { ::munmap( const_cast< char* >( m_begin ), m_file_size ); m_begin = NULL; }
+    if( m_fd >= 0 ) { ::close( m_fd ); m_fd = -1; }
+    #endif
+}
+
+/// index the frame following the last indexed one
+/// @return false, if end of file or the frame is truncated
+bool mmap_reader::index_next()
+{
+    if( m_begin == NULL ) { return false; }
+    std::size_t header_size = m_serialization.header_size();
+    if( m_end == m_file_size || m_file_size - m_end < header_size ) { return false; }
+    serialization::header h = m_serialization.get_header( m_begin + m_end );
+    comma::uint64 size = comma::uint64( h.rows ) * h.cols * CV_ELEM_SIZE( h.type );
+    if( header_size + size == 0 ) { COMMA_THROW( comma::exception, "expected image size, got empty image in " << m_config.filename ); }
+    if( m_file_size - m_end - header_size < size ) { return false; }
+    m_offsets.push_back( m_end );
+    m_timestamps.push_back( h.timestamp );
+    m_end += header_size + size;
+    return true;
+}
+
+std::pair< boost::posix_time::ptime, cv::Mat > mmap_reader::read()
+{
+    if( m_frame == m_offsets.size() && !index_next() ) { return std::pair< boost::posix_time::ptime, cv::Mat >(); }
+    const char* p = m_begin + m_offsets[ m_frame ];
+    serialization::header h = m_serialization.get_header( p );
+    std::pair< boost::posix_time::ptime, cv::Mat > pair( h.timestamp, cv::Mat( h.rows, h.cols, h.type, const_cast< char* >( p + m_serialization.header_size() ) ) );
+    if( m_config.release > 0 && m_frame >= m_config.release ) { release( m_frame - m_config.release ); }
+    ++m_frame;
+    return pair;
+}
+
+/// drop pages lying entirely within given frame, reverting modified pages to the file contents
+void mmap_reader::release( std::size_t frame )
+{
+    #ifndef WIN32
+    std::size_t begin = ( ( m_offsets[ frame ] + m_page_size - 1 ) / m_page_size ) * m_page_size; // pages shared with neighbour frames are kept
+    std::size_t end = ( ( frame + 1 < m_offsets.size() ? m_offsets[ frame + 1 ] : m_end ) / m_page_size ) * m_page_size;
+    if( begin < end ) { ::madvise( const_cast< char* >( m_begin ) + begin, end - begin, MADV_DONTNEED ); }
+    #endif
+}
+
+bool mmap_reader::seek( std::size_t frame )
+{
+    while( m_offsets.size() <= frame ) { if( !index_next() ) { m_frame = m_offsets.size(); return false; } }
+    m_frame = frame;
+    return true;
+}
+
+bool mmap_reader::seek( const boost::posix_time::ptime& t )
+{
+    if( m_timestamps.empty() || m_timestamps.back() < t )
+    {
+        while( true )
+        {
+            if( !index_next() ) { m_frame = m_offsets.size(); return false; }
+            if( !( m_timestamps.back() < t ) ) { m_frame = m_offsets.size() - 1; return true; }
+        }
+    }
+    m_frame = std::lower_bound( m_timestamps.begin(), m_timestamps.end(), t ) - m_timestamps.begin();
+    return true;
+}
+
+bool mmap_reader::eof() { return m_frame == m_offsets.size() && !index_next(); }
+
+} }  // namespace snark{ namespace cv_mat {
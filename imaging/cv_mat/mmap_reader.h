@@ -0,0 +1,115 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_IMAGING_CVMAT_MMAP_READER_H_
+#define SNARK_IMAGING_CVMAT_MMAP_READER_H_
+
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <comma/base/types.h>
+#include <opencv2/core/core.hpp>
+#include "serialization.h"
+
+namespace snark{ namespace cv_mat {
+
+/// reader of serialized images, e.g. as output by cv-cat, that memory-maps the file
+/// and returns images pointing straight into the mapping
+/// the mapping is private: filters modifying images in place get their own copy of the touched pages,
+/// the file itself is never modified
+/// frames are indexed as they are read or seeked to, thus large files can be played back from the start
+/// without building the index up front
+class mmap_reader : public boost::noncopyable
+{
+    public:
+        struct config
+        {
+            /// file name
+            std::string filename;
+
+            /// image serialization options, same as for reading from stream
+            serialization::options options;
+
+            /// number of frames read after which the memory of a frame is released;
+            /// frames still in use at that point would be reverted to the file contents
+            /// 0: never release, memory of frames modified in place grows as the file is read
+            unsigned int release;
+
+            config( const std::string& filename = "", const serialization::options& options = serialization::options(), unsigned int release = 0 ) : filename( filename ), options( options ), release( release ) {}
+        };
+
+        /// constructor, map a file
+        mmap_reader( const config& c );
+
+        /// destructor, unmap file
+        /// @note images returned by read() must not be used after the reader is destroyed
+        ~mmap_reader();
+
+        /// return next image pointing into the mapping; empty image, if end of file
+        std::pair< boost::posix_time::ptime, cv::Mat > read();
+
+        /// return number of the frame read() will return next
+        std::size_t frame() const { return m_frame; }
+
+        /// position reader at given frame number
+        /// @return false, if the file has less frames
+        bool seek( std::size_t frame );
+
+        /// position reader at the first frame with timestamp not less than given time
+        /// @note expects frames with non-decreasing timestamps
+        /// @return false, if there is no such frame
+        bool seek( const boost::posix_time::ptime& t );
+
+        /// return true, if end of file
+        bool eof();
+
+        /// close
+        void close();
+
+    private:
+        config m_config;
+        serialization m_serialization;
+        int m_fd;
+        const char* m_begin;
+        std::size_t m_file_size;
+        std::size_t m_page_size;
+        std::vector< comma::uint64 > m_offsets;
+        std::vector< boost::posix_time::ptime > m_timestamps;
+        comma::uint64 m_end;
+        std::size_t m_frame;
+
+        bool index_next();
+        void release( std::size_t frame );
+};
+
+} }  // namespace snark{ namespace cv_mat {
+
+#endif // SNARK_IMAGING_CVMAT_MMAP_READER_H_
@@ -28,9 +28,11 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <sstream>
 #include <snark/imaging/cv_mat/pipeline.h>
 #include <tbb/tbb_thread.h>
 #include <boost/bind.hpp>
+#include <boost/program_options/value_semantic.hpp>
 
 namespace snark{ namespace imaging { namespace applications {
 
@@ -40,14 +42,17 @@ namespace snark{ namespace imaging { namespace applications {
 /// @param filters string describing the filters
 /// @param size max buffer size
 /// @param mode output mode
+/// @param number_of_tokens maximum number of frames in flight, 0: same as number of threads;
+///        1: process one frame at a time using all threads within the frame, for lowest latency
 pipeline::pipeline( cv_mat::serialization& output
                   , const std::string& filters
                   , tbb::bursty_reader< pair >& reader
-                  , unsigned int number_of_threads )
+                  , unsigned int number_of_threads
+                  , unsigned int number_of_tokens )
     : m_output( output )
     , m_filters( snark::cv_mat::filters::make( filters ) )
     , m_reader( reader )
-    , m_pipeline( number_of_threads )
+    , m_pipeline( number_of_threads, number_of_tokens )
 {
     setup_pipeline_();
 }
@@ -55,11 +60,12 @@ pipeline::pipeline( cv_mat::serialization& output
 pipeline::pipeline( cv_mat::serialization& output
                   , const std::vector< cv_mat::filter >& filters
                   , tbb::bursty_reader< pair >& reader
-                  , unsigned int number_of_threads )
+                  , unsigned int number_of_threads
+                  , unsigned int number_of_tokens )
     : m_output( output )
     , m_filters( filters )
     , m_reader( reader )
-    , m_pipeline( number_of_threads )
+    , m_pipeline( number_of_threads, number_of_tokens )
 {
     setup_pipeline_();
 }
@@ -77,6 +83,7 @@ void pipeline::write_( pair p )
         m_reader.stop();
     }
     m_output.write( std::cout, p );
+    publish_profile_();
 }
 
 void pipeline::null_( pair p )
@@ -85,6 +92,7 @@ void pipeline::null_( pair p )
     {
         m_reader.stop();
     }
+    publish_profile_();
 }
 
 /// setup the pipeline
@@ -97,17 +105,18 @@ void pipeline::setup_pipeline_()
     }
     else
     {
+        const std::vector< cv_mat::filter >& filters = m_profile ? m_profile->wrap( m_filters ) : m_filters;
         ::tbb::filter_t< pair, pair > all_filters;
         bool has_null = false;
-        for( std::size_t i = 0; i < m_filters.size(); ++i )
+        for( std::size_t i = 0; i < filters.size(); ++i )
         {
             ::tbb::filter::mode mode = ::tbb::filter::serial_in_order;
-            if( m_filters[i].parallel )
+            if( filters[i].parallel )
             {
                 mode = ::tbb::filter::parallel;
             }
-            if( !m_filters[i].filter_function ) { has_null = true; break; }
-            ::tbb::filter_t< pair, pair > filter( mode, boost::bind( m_filters[i].filter_function, _1 ) );
+            if( !filters[i].filter_function ) { has_null = true; break; }
+            ::tbb::filter_t< pair, pair > filter( mode, boost::bind( filters[i].filter_function, _1 ) );
             all_filters = i == 0 ? filter : ( all_filters & filter );
         }
         m_filter = all_filters & ::tbb::filter_t< pair, void >( ::tbb::filter::serial_in_order, boost::bind( has_null ? &pipeline::null_ : &pipeline::write_, this, _1 ) );
@@ -115,7 +124,47 @@ void pipeline::setup_pipeline_()
 }
 
 /// run the pipeline
-void pipeline::run() { m_pipeline.run( m_reader, m_filter ); }
+void pipeline::run()
+{
+    m_pipeline.run( m_reader, m_filter );
+    m_output.close( std::cout );
+    if( m_profile ) { m_profile->write_summary( std::cerr, m_reader.statistics() ); }
+}
+
+void pipeline::profile( const std::string& stream, double period )
+{
+    m_profile.reset( new cv_mat::profile );
+    if( !stream.empty() ) { m_profile_publisher.reset( new comma::io::publisher( stream, comma::io::mode::ascii ) ); }
+    m_profile_period = boost::posix_time::microseconds( period * 1000000 );
+    m_profile_published = boost::posix_time::microsec_clock::universal_time();
+    setup_pipeline_();
+}
+
+void pipeline::profile( const boost::program_options::variables_map& vm )
+{
+    if( vm.count( "profile" ) || vm.count( "profile-stream" ) ) { profile( vm.count( "profile-stream" ) ? vm[ "profile-stream" ].as< std::string >() : std::string(), vm[ "profile-period" ].as< double >() ); }
+}
+
+void pipeline::add_profile_options( boost::program_options::options_description& description )
+{
+    description.add_options()
+        ( "profile", "output per-filter timing summary to stderr on exit" )
+        ( "profile-stream", boost::program_options::value< std::string >(), "periodically publish per-filter timing as csv to given address, e.g. tcp:12345; fields: t,index,name,count,wall,cpu,bytes/in,bytes/out,new_buffers,queue/popped,queue/discarded,queue/wait,queue/size; times in microseconds" )
+        ( "profile-period", boost::program_options::value< double >()->default_value( 1 ), "period of --profile-stream in seconds" );
+}
+
+/// publish profiling statistics, if due; called from the serial output stage
+void pipeline::publish_profile_()
+{
+    if( !m_profile_publisher ) { return; }
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    if( now < m_profile_published + m_profile_period ) { return; }
+    m_profile_published = now;
+    std::ostringstream oss;
+    m_profile->write_csv( oss, m_reader.statistics() );
+    const std::string& s = oss.str();
+    m_profile_publisher->write( &s[0], s.size() );
+}
 
 } } }
 
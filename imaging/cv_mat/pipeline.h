@@ -37,9 +37,14 @@
 
 //#include <comma/application/signal_flag.h>
 #include <snark/tbb/bursty_reader.h>
-#include <snark/imaging/cv_mat/bursty_pipeline.h>
+#include <snark/tbb/bursty_pipeline.h>
 #include <snark/imaging/cv_mat/serialization.h>
 #include <snark/imaging/cv_mat/filters.h>
+#include <snark/imaging/cv_mat/profile.h>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <comma/io/publisher.h>
 
 namespace snark {
 
@@ -64,25 +69,43 @@ class pipeline
         pipeline( cv_mat::serialization& output
                 , const std::string& filters
                 , tbb::bursty_reader< pair >& reader
-                , unsigned int number_of_threads = 0 );
+                , unsigned int number_of_threads = 0
+                , unsigned int number_of_tokens = 0 );
         
         pipeline( cv_mat::serialization& output
                 , const std::vector< cv_mat::filter >& filters
                 , tbb::bursty_reader< pair >& reader
-                , unsigned int number_of_threads = 0 );
+                , unsigned int number_of_threads = 0
+                , unsigned int number_of_tokens = 0 );
 
         void run();
 
+        /// profile filters, write summary to stderr, when the pipeline finishes
+        /// @param stream if not empty, address to periodically publish profiling statistics to as csv, e.g. tcp:12345
+        /// @param period publishing period in seconds
+        void profile( const std::string& stream = "", double period = 1 );
+
+        /// profile filters as given by the options added by add_profile_options(), if any of them is present
+        void profile( const boost::program_options::variables_map& vm );
+
+        /// add --profile, --profile-stream, and --profile-period to application options
+        static void add_profile_options( boost::program_options::options_description& description );
+
     protected:
         void write_( pair p );
         void null_( pair p );
         void setup_pipeline_();
+        void publish_profile_();
 
         cv_mat::serialization& m_output;
         ::tbb::filter_t< pair, void > m_filter;
         std::vector< cv_mat::filter > m_filters;
         tbb::bursty_reader< pair >& m_reader;
         tbb::bursty_pipeline< pair > m_pipeline;
+        boost::scoped_ptr< cv_mat::profile > m_profile;
+        boost::scoped_ptr< comma::io::publisher > m_profile_publisher;
+        boost::posix_time::time_duration m_profile_period;
+        boost::posix_time::ptime m_profile_published;
         //comma::signal_flag is_shutdown_; // todo: tear it down, if cv-cat, gige-cat, and fire-cat work
     };
 
@@ -0,0 +1,127 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <list>
+#include <boost/static_assert.hpp>
+#include <boost/thread/mutex.hpp>
+#include "pool.h"
+
+namespace snark{ namespace cv_mat {
+
+// buffer layout: size header, data, reference counter, as in opencv own allocation
+class pool::impl : public cv::MatAllocator
+{
+    public:
+        impl( std::size_t capacity ) : capacity_( capacity ) {}
+
+        ~impl() { for( buffers_t::iterator it = buffers_.begin(); it != buffers_.end(); ++it ) { cv::fastFree( it->second ); } }
+
+        void allocate( int dims, const int* sizes, int type, int*& refcount, uchar*& datastart, uchar*& data, size_t* step )
+        {
+            std::size_t size = CV_ELEM_SIZE( type );
+            for( int i = dims - 1; i >= 0; --i ) { step[i] = size; size *= sizes[i]; }
+            size = cv::alignSize( size, sizeof( int ) );
+            uchar* buffer = take_( size );
+            if( !buffer )
+            {
+                buffer = static_cast< uchar* >( cv::fastMalloc( header_size + size + sizeof( int ) ) );
+                *reinterpret_cast< std::size_t* >( buffer ) = size;
+            }
+            datastart = data = buffer + header_size;
+            refcount = reinterpret_cast< int* >( data + size );
+            *refcount = 1;
+        }
+
+        void deallocate( int*, uchar* datastart, uchar* )
+        {
+            if( !datastart ) { return; }
+            uchar* buffer = datastart - header_size;
+            std::size_t size = *reinterpret_cast< const std::size_t* >( buffer );
+            uchar* evicted = NULL;
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                if( capacity_ == 0 ) { evicted = buffer; }
+                else
+                {
+                    if( buffers_.size() == capacity_ ) { evicted = buffers_.front().second; buffers_.pop_front(); } // e.g. buffers of the size before a resolution change
+                    buffers_.push_back( std::make_pair( size, buffer ) );
+                }
+            }
+            if( evicted ) { cv::fastFree( evicted ); }
+        }
+
+        cv::Mat make() { cv::Mat m; m.allocator = this; return m; }
+
+        std::size_t size() const { boost::mutex::scoped_lock lock( mutex_ ); return buffers_.size(); }
+
+    private:
+        enum { header_size = 16 }; // keep data aligned as by cv::fastMalloc
+        BOOST_STATIC_ASSERT( sizeof( std::size_t ) <= header_size );
+        typedef std::list< std::pair< std::size_t, uchar* > > buffers_t; // in order of release, oldest first
+        std::size_t capacity_;
+        buffers_t buffers_;
+        mutable boost::mutex mutex_;
+
+        uchar* take_( std::size_t size )
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            for( buffers_t::reverse_iterator it = buffers_.rbegin(); it != buffers_.rend(); ++it ) // latest first, since likely still in cache
+            {
+                if( it->first != size ) { continue; }
+                uchar* buffer = it->second;
+                buffers_.erase( --it.base() );
+                return buffer;
+            }
+            return NULL;
+        }
+};
+
+pool::pool( std::size_t capacity ) : pimpl_( new impl( capacity ) ) {}
+
+pool::~pool() {}
+
+cv::Mat pool::make( int rows, int cols, int type )
+{
+    cv::Mat m = pimpl_->make();
+    m.create( rows, cols, type );
+    return m;
+}
+
+cv::Mat pool::make() { return pimpl_->make(); }
+
+std::size_t pool::size() const { return pimpl_->size(); }
+
+pool& pool::instance()
+{
+    static pool* p = new pool;
+    return *p;
+}
+
+} } // namespace snark{ namespace cv_mat {
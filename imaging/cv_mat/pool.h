@@ -0,0 +1,75 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_IMAGING_CVMAT_POOL_H_
+#define SNARK_IMAGING_CVMAT_POOL_H_
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <opencv2/core/core.hpp>
+
+namespace snark{ namespace cv_mat {
+
+/// recycling buffer pool for cv::Mat data
+/// a matrix made by the pool gives its buffer back to the pool when its last reference is released,
+/// the buffer then is reused for the next matrix of the same data size,
+/// e.g. for frames of the same rows, cols, and type; when the pool is full, the oldest released buffer is freed,
+/// e.g. after a change of image size
+/// @note implemented as cv::MatAllocator of opencv 2.x
+class pool : public boost::noncopyable
+{
+    public:
+        /// constructor
+        /// @param capacity maximum number of released buffers kept for reuse
+        pool( std::size_t capacity = 16 );
+
+        /// destructor, matrices made by the pool must not outlive it
+        ~pool();
+
+        /// @return matrix with data from the pool
+        cv::Mat make( int rows, int cols, int type );
+
+        /// @return empty matrix, which takes data from the pool once created, e.g. as output of opencv functions or copyTo()
+        cv::Mat make();
+
+        /// @return number of buffers ready for reuse
+        std::size_t size() const;
+
+        /// @return process-wide pool, never destroyed, since frames may be released at any time
+        static pool& instance();
+
+    private:
+        class impl;
+        boost::scoped_ptr< impl > pimpl_;
+};
+
+} } // namespace snark{ namespace cv_mat {
+
+#endif // SNARK_IMAGING_CVMAT_POOL_H_
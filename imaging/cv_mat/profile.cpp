@@ -0,0 +1,162 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef WIN32
+#include <time.h>
+#endif
+#include <iomanip>
+#include <boost/thread/mutex.hpp>
+#include "profile.h"
+
+namespace snark{ namespace cv_mat {
+
+class profile::entry
+{
+    public:
+        entry( const std::string& name ) : statistics_( name ) {}
+
+        void add( comma::uint64 wall, comma::uint64 cpu, comma::uint64 bytes_in, comma::uint64 bytes_out, bool new_buffer )
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            ++statistics_.count;
+            statistics_.wall += wall;
+            statistics_.cpu += cpu;
+            statistics_.bytes_in += bytes_in;
+            statistics_.bytes_out += bytes_out;
+            if( new_buffer ) { ++statistics_.new_buffers; }
+        }
+
+        profile::statistics get() const
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            return statistics_;
+        }
+
+    private:
+        mutable boost::mutex mutex_;
+        profile::statistics statistics_;
+};
+
+/// @return cpu time of the calling thread in microseconds, 0 if not supported
+static comma::uint64 thread_cpu_time_()
+{
+#ifdef WIN32
+    return 0;
+#else
+    ::timespec t;
+    if( ::clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t ) != 0 ) { return 0; }
+    return comma::uint64( t.tv_sec ) * 1000000 + t.tv_nsec / 1000;
+#endif
+}
+
+static comma::uint64 bytes_( const cv::Mat& m ) { return m.empty() ? 0 : m.total() * m.elemSize(); }
+
+struct profiled_
+{
+    boost::function< filter::output_type( filter::value_type ) > function;
+    boost::shared_ptr< profile::entry > entry;
+
+    profiled_( const boost::function< filter::output_type( filter::value_type ) >& function, const boost::shared_ptr< profile::entry >& entry ) : function( function ), entry( entry ) {}
+
+    filter::output_type operator()( filter::value_type m ) const
+    {
+        const uchar* data = m.second.datastart;
+        comma::uint64 bytes_in = bytes_( m.second );
+        comma::uint64 cpu = thread_cpu_time_();
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+        filter::output_type r = function( m );
+        comma::uint64 wall = ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds();
+        cpu = thread_cpu_time_() - cpu;
+        entry->add( wall, cpu, bytes_in, bytes_( r.second ), !r.second.empty() && r.second.datastart != data );
+        return r;
+    }
+};
+
+std::vector< filter > profile::wrap( const std::vector< filter >& filters )
+{
+    std::vector< filter > wrapped = filters;
+    entries_.clear();
+    for( std::size_t i = 0; i < filters.size(); ++i )
+    {
+        if( !filters[i].filter_function ) { continue; }
+        entries_.push_back( boost::shared_ptr< entry >( new entry( filters[i].name.empty() ? "unknown" : filters[i].name ) ) );
+        wrapped[i].filter_function = profiled_( filters[i].filter_function, entries_.back() );
+    }
+    return wrapped;
+}
+
+std::vector< profile::statistics > profile::snapshot() const
+{
+    std::vector< statistics > s( entries_.size() );
+    for( std::size_t i = 0; i < entries_.size(); ++i ) { s[i] = entries_[i]->get(); }
+    return s;
+}
+
+static double per_frame_( comma::uint64 value, comma::uint64 count ) { return count == 0 ? 0 : double( value ) / count; }
+
+void profile::write_summary( std::ostream& os, const tbb::bursty_reader_statistics& queue ) const
+{
+    const std::vector< statistics >& s = snapshot();
+    comma::uint64 wall = 0;
+    for( std::size_t i = 0; i < s.size(); ++i ) { wall += s[i].wall; }
+    std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision( 1 );
+    os << "profile: " << std::setw( 3 ) << "#" << " " << std::left << std::setw( 24 ) << "filter" << std::right
+       << std::setw( 10 ) << "frames" << std::setw( 14 ) << "wall/frame,us" << std::setw( 14 ) << "cpu/frame,us" << std::setw( 8 ) << "wall,%"
+       << std::setw( 14 ) << "in/frame,kb" << std::setw( 14 ) << "out/frame,kb" << std::setw( 12 ) << "new buffers" << std::endl;
+    for( std::size_t i = 0; i < s.size(); ++i )
+    {
+        os << "profile: " << std::setw( 3 ) << i << " " << std::left << std::setw( 24 ) << s[i].name << std::right
+           << std::setw( 10 ) << s[i].count
+           << std::setw( 14 ) << per_frame_( s[i].wall, s[i].count )
+           << std::setw( 14 ) << per_frame_( s[i].cpu, s[i].count )
+           << std::setw( 8 ) << ( wall == 0 ? 0 : 100.0 * s[i].wall / wall )
+           << std::setw( 14 ) << per_frame_( s[i].bytes_in, s[i].count ) / 1024
+           << std::setw( 14 ) << per_frame_( s[i].bytes_out, s[i].count ) / 1024
+           << std::setw( 12 ) << s[i].new_buffers << std::endl;
+    }
+    os << "profile: input queue: " << queue.popped << " frame(s) read, " << queue.discarded << " discarded, "
+       << "waited " << double( queue.wait ) / 1000000 << "s for input, " << queue.size << " frame(s) pending" << std::endl;
+    os.flags( flags );
+}
+
+void profile::write_csv( std::ostream& os, const tbb::bursty_reader_statistics& queue ) const
+{
+    const std::vector< statistics >& s = snapshot();
+    const std::string& t = boost::posix_time::to_iso_string( boost::posix_time::microsec_clock::universal_time() );
+    for( std::size_t i = 0; i < s.size(); ++i )
+    {
+        os << t << ',' << i << ',' << s[i].name << ',' << s[i].count << ',' << s[i].wall << ',' << s[i].cpu
+           << ',' << s[i].bytes_in << ',' << s[i].bytes_out << ',' << s[i].new_buffers
+           << ',' << queue.popped << ',' << queue.discarded << ',' << queue.wait << ',' << queue.size << std::endl;
+    }
+}
+
+} } // namespace snark{ namespace cv_mat {
@@ -0,0 +1,86 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_IMAGING_CVMAT_PROFILE_H_
+#define SNARK_IMAGING_CVMAT_PROFILE_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <comma/base/types.h>
+#include <snark/tbb/bursty_reader.h>
+#include "filters.h"
+
+namespace snark{ namespace cv_mat {
+
+/// per-filter profiling: wraps filters into timing instrumentation and accumulates statistics
+class profile : public boost::noncopyable
+{
+    public:
+        /// statistics of a single filter; times in microseconds
+        struct statistics
+        {
+            std::string name;
+            comma::uint64 count;
+            comma::uint64 wall;
+            /// cpu time of the thread calling the filter; time of worker threads within the frame is not included
+            comma::uint64 cpu;
+            comma::uint64 bytes_in;
+            comma::uint64 bytes_out;
+            /// number of output frames with data outside of the input frame's buffer, e.g. taken from the pool
+            /// or newly allocated; not a count of allocations: a reused pool buffer counts, a view into the input does not
+            comma::uint64 new_buffers;
+
+            statistics( const std::string& name = "" ) : name( name ), count( 0 ), wall( 0 ), cpu( 0 ), bytes_in( 0 ), bytes_out( 0 ), new_buffers( 0 ) {}
+        };
+
+        /// @return filters wrapped into instrumentation, null filters are left as they are
+        std::vector< filter > wrap( const std::vector< filter >& filters );
+
+        /// @return snapshot of statistics for each wrapped filter
+        std::vector< statistics > snapshot() const;
+
+        /// write human-readable summary
+        void write_summary( std::ostream& os, const tbb::bursty_reader_statistics& queue ) const;
+
+        /// write csv line per filter: t,index,name,count,wall,cpu,bytes/in,bytes/out,new_buffers,queue/popped,queue/discarded,queue/wait,queue/size
+        void write_csv( std::ostream& os, const tbb::bursty_reader_statistics& queue ) const;
+
+        class entry;
+
+    private:
+        std::vector< boost::shared_ptr< entry > > entries_;
+};
+
+} } // namespace snark{ namespace cv_mat {
+
+#endif // SNARK_IMAGING_CVMAT_PROFILE_H_
@@ -32,6 +32,7 @@
 #include <comma/base/exception.h>
 #include <comma/csv/binary.h>
 #include <comma/string/string.h>
+#include "pool.h"
 #include "serialization.h"
 
 namespace snark{ namespace cv_mat {
@@ -79,6 +80,12 @@ serialization::serialization( const std::string& fields, const comma::csv::forma
 serialization::serialization( const serialization::options& options )
 {
     if( options.no_header && options.header_only ) { COMMA_THROW( comma::exception, "cannot have no-header and header-only at the same time" ); }
+    if( options.format == "snark-log" )
+    {
+        m_log_writer.reset( new image_log::writer );
+        m_log_reader.reset( new image_log::reader );
+    }
+    else if( !options.format.empty() ) { COMMA_THROW( comma::exception, "expected format: snark-log, got: \"" << options.format << "\"" ); }
     std::string fields = options.fields.empty() ? std::string( "t,rows,cols,type" ) : options.fields;
     std::vector< std::string > v = comma::split( fields, "," );
     comma::csv::format format;
@@ -139,14 +146,11 @@ serialization::header serialization::get_header( const char* buf ) const
     }
 }
 
+std::size_t serialization::header_size() const { return m_binary ? m_binary->format().size() : 0; }
+
 std::size_t serialization::size( const cv::Mat& m ) const
 {
-    unsigned int headerSize = 0;
-    if( m_binary )
-    {
-        headerSize = m_binary->format().size();
-    }
-    return headerSize + ( m.dataend - m.datastart );
+    return header_size() + ( m.dataend - m.datastart );
 }
 
 std::size_t serialization::size( const std::pair< boost::posix_time::ptime, cv::Mat >& m ) const
@@ -156,6 +160,7 @@ std::size_t serialization::size( const std::pair< boost::posix_time::ptime, cv::
 
 std::pair< boost::posix_time::ptime, cv::Mat > serialization::read( std::istream& is )
 {
+    if( m_log_reader ) { return m_log_reader->read( is ); }
     header h;
     std::pair< boost::posix_time::ptime, cv::Mat > p;
     if( m_binary )
@@ -171,7 +176,7 @@ std::pair< boost::posix_time::ptime, cv::Mat > serialization::read( std::istream
         h = m_header;
     }
     p.first = h.timestamp;
-    p.second = cv::Mat( h.rows, h.cols, h.type );
+    p.second = pool::instance().make( h.rows, h.cols, h.type );
     std::size_t size = p.second.dataend - p.second.datastart;
     is.read( reinterpret_cast< char* >( p.second.datastart ), size );
     int count = is.gcount();
@@ -184,6 +189,7 @@ std::pair< boost::posix_time::ptime, cv::Mat > serialization::read( std::istream
 
 void serialization::write( std::ostream& os, const std::pair< boost::posix_time::ptime, cv::Mat >& m )
 {
+    if( m_log_writer ) { m_log_writer->write( os, m ); return; }
     if( m_binary )
     {
         header h( m );
@@ -197,6 +203,14 @@ void serialization::write( std::ostream& os, const std::pair< boost::posix_time:
     os.flush();
 }
 
+void serialization::close( std::ostream& os ) { if( m_log_writer ) { m_log_writer->close( os ); } }
+
+void serialization::seek( std::istream& is, const boost::posix_time::ptime& t )
+{
+    if( !m_log_reader ) { COMMA_THROW( comma::exception, "seek: supported for snark-log format only" ); }
+    m_log_reader->seek( is, t );
+}
+
 unsigned int type_from_string_( const std::string& t )
 {
     if( t == "CV_8UC1" || t == "ub" ) { return CV_8UC1; }
@@ -250,6 +264,9 @@ std::string serialization::options::usage()
     stream << "    rows=<rows>: default number of rows (input only)" << std::endl;
     stream << "    cols=<cols>: default number of columns (input only)" << std::endl;
     stream << "    type=<type>: default image type (input only)" << std::endl;
+    stream << "    format=<format>: container format; default: header and raw image data" << std::endl;
+    stream << "        snark-log: frames compressed losslessly (8- and 16-bit images) in bands of rows in parallel," << std::endl;
+    stream << "                   followed by an index of timestamps for seeking by time; other options are ignored" << std::endl;
     stream << type_usage();
     return stream.str();
 }
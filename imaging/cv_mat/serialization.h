@@ -34,10 +34,12 @@
 #include <iostream>
 #include <string>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <opencv2/core/core.hpp>
 #include <comma/base/types.h>
 #include <comma/csv/binary.h>
 #include <comma/csv/traits.h>
+#include "image_log.h"
 
 namespace snark{ namespace cv_mat {
 
@@ -67,6 +69,7 @@ class serialization
             std::string type;
             bool no_header;
             bool header_only;
+            std::string format; /// empty: header and raw image data; snark-log: see image_log
             
             options() : no_header( false ), header_only( false ) {}
             header get_header() const; /// make header (to be used as default)
@@ -105,17 +108,28 @@ class serialization
         /// same as above
         std::size_t size( const std::pair< boost::posix_time::ptime, cv::Mat >& m ) const;
 
+        /// return header size in bytes, 0 if no header
+        std::size_t header_size() const;
+
         /// read from stream, if eof, return empty cv::Mat
         std::pair< boost::posix_time::ptime, cv::Mat > read( std::istream& is );
 
         /// write to stream
         void write( std::ostream& os, const std::pair< boost::posix_time::ptime, cv::Mat >& m );
 
+        /// finish writing, e.g. write index for snark-log format
+        void close( std::ostream& os );
+
+        /// snark-log format only: position stream at the first frame with timestamp not less than given time
+        void seek( std::istream& is, const boost::posix_time::ptime& t );
+
     private:
         boost::scoped_ptr< comma::csv::binary< header > > m_binary;
         std::vector< char > m_buffer;
         bool m_headerOnly;
         header m_header; /// default header
+        boost::scoped_ptr< image_log::writer > m_log_writer;
+        boost::scoped_ptr< image_log::reader > m_log_reader;
 };
 
 } }  // namespace snark{ namespace cv_mat {
@@ -156,6 +170,7 @@ template <> struct traits< snark::cv_mat::serialization::options >
         v.apply( "type", h.type );
         v.apply( "no-header", h.no_header );
         v.apply( "header-only", h.header_only );
+        v.apply( "format", h.format );
     }
 
     template < typename K, typename V >
@@ -167,6 +182,7 @@ template <> struct traits< snark::cv_mat::serialization::options >
         v.apply( "type", h.type );
         v.apply( "no-header", h.no_header );
         v.apply( "header-only", h.header_only );
+        v.apply( "format", h.format );
     }
 };
     
@@ -0,0 +1,329 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <boost/lexical_cast.hpp>
+#include <comma/base/exception.h>
+#include <comma/base/types.h>
+#include <comma/string/string.h>
+#include <snark/imaging/cv_mat/filters.h>
+
+namespace snark { namespace cv_mat {
+
+static filters::value_type make_image( int rows, int cols, int type )
+{
+    filters::value_type m( boost::posix_time::from_iso_string( "20150101T000000" ), cv::Mat( rows, cols, type ) );
+    int n = cols * m.second.channels();
+    for( int i = 0; i < rows; ++i )
+    {
+        unsigned char* p = m.second.ptr< unsigned char >( i );
+        for( int j = 0; j < n; ++j ) { p[j] = ( i * 7 + j * 3 ) % 256; }
+    }
+    return m;
+}
+
+static filters::value_type make_random( int rows, int cols, int type, double low, double high )
+{
+    filters::value_type m( boost::posix_time::from_iso_string( "20150101T000000" ), cv::Mat( rows, cols, type ) );
+    cv::RNG rng( 1234 );
+    rng.fill( m.second, cv::RNG::UNIFORM, cv::Scalar::all( low ), cv::Scalar::all( high ) );
+    return m;
+}
+
+static filters::value_type filtered( const std::string& how, const filters::value_type& m )
+{
+    std::vector< filter > f = filters::make( how );
+    return filters::apply( f, filters::value_type( m.first, m.second.clone() ) ); // filters may modify input in place
+}
+
+/// apply filters one by one, i.e. unfused, stopping at empty frame as cv-cat would
+static filters::value_type filtered_one_by_one( const std::string& how, const filters::value_type& m )
+{
+    const std::vector< std::string >& v = comma::split( how, ';' );
+    filters::value_type n = m;
+    for( std::size_t i = 0; i < v.size() && !n.second.empty(); ++i ) { n = filtered( v[i], n ); }
+    return n;
+}
+
+/// map file in the current directory, removed on destruction
+struct map_file
+{
+    std::string name;
+    map_file( const std::string& name, const std::string& content ) : name( name ) { std::ofstream ofs( name.c_str() ); ofs << content; }
+    ~map_file() { std::remove( name.c_str() ); }
+};
+
+static void expect_equal( const cv::Mat& expected, const cv::Mat& actual )
+{
+    ASSERT_EQ( expected.rows, actual.rows );
+    ASSERT_EQ( expected.cols, actual.cols );
+    ASSERT_EQ( expected.type(), actual.type() );
+    std::size_t row_size = expected.cols * expected.elemSize();
+    for( int i = 0; i < expected.rows; ++i ) { ASSERT_EQ( 0, std::memcmp( expected.ptr( i ), actual.ptr( i ), row_size ) ) << "row " << i; }
+}
+
+TEST( filters, tiles )
+{
+    const char* chains[] = { "invert", "threshold=100", "invert|threshold=100", "brightness=2,10|invert" };
+    for( unsigned int k = 0; k < sizeof( chains ) / sizeof( chains[0] ); ++k )
+    {
+        std::string how = chains[k];
+        filters::value_type m = make_image( 60, 80, CV_8UC3 );
+        filters::value_type expected = filtered( comma::join( comma::split( how, '|' ), ';' ), m );
+        expect_equal( expected.second, filtered( "tiles=1,1|" + how, m ).second );
+        expect_equal( expected.second, filtered( "tiles=2,2|" + how, m ).second );
+        expect_equal( expected.second, filtered( "tiles=4,3|" + how, m ).second );
+    }
+}
+
+TEST( filters, tiles_error )
+{
+    filters::value_type m = make_image( 60, 80, CV_8UC3 );
+    EXPECT_THROW( filtered( "tiles=2,2|convert-to=f|invert", m ), comma::exception ); // invert expects 8-bit images
+}
+
+static void expect_fused_as_unfused( const std::string& how, const filters::value_type& m )
+{
+    SCOPED_TRACE( how );
+    ASSERT_EQ( 1u, filters::make( how ).size() ); // all filters in a single fused filter
+    filters::value_type expected = filtered_one_by_one( how, m );
+    ASSERT_FALSE( expected.second.empty() );
+    expect_equal( expected.second, filtered( how, m ).second );
+}
+
+TEST( filters, fused )
+{
+    // widths are not multiples of strip size; 20003 floats per row are wider than a strip
+    const char* ub[] = { "brightness=2,10;invert", "invert;threshold=100", "convert-to=f,0.5;brightness=1.5,3;threshold=40,1", "brightness=0.7,5;convert-to=w,100,-20" };
+    for( unsigned int k = 0; k < sizeof( ub ) / sizeof( ub[0] ); ++k ) { expect_fused_as_unfused( ub[k], make_random( 130, 1001, CV_8UC1, 0, 256 ) ); }
+    const char* ub3[] = { "invert;brightness=1.2", "brightness=2,10;invert;linear-combination=0.2,0.3,0.5", "convert-to=3f,0.0039;linear-combination=0.2,0.3,0.5;threshold=0.5,1" };
+    for( unsigned int k = 0; k < sizeof( ub3 ) / sizeof( ub3[0] ); ++k ) { expect_fused_as_unfused( ub3[k], make_random( 130, 1001, CV_8UC3, 0, 256 ) ); }
+    const char* f[] = { "brightness=0.5,3;threshold=10,1,trunc", "threshold=0,0,tozero;convert-to=ub,2", "linear-combination=0.3;brightness=1,1" };
+    for( unsigned int k = 0; k < sizeof( f ) / sizeof( f[0] ); ++k )
+    {
+        expect_fused_as_unfused( f[k], make_random( 130, 1001, CV_32FC1, -100, 100 ) );
+        expect_fused_as_unfused( f[k], make_random( 7, 20003, CV_32FC1, -100, 100 ) );
+    }
+    const char* f2[] = { "brightness=2;magnitude", "magnitude;threshold=50,1", "convert-to=2d,0.5;magnitude;brightness=2,1" };
+    for( unsigned int k = 0; k < sizeof( f2 ) / sizeof( f2[0] ); ++k ) { expect_fused_as_unfused( f2[k], make_random( 130, 1001, CV_32FC2, -100, 100 ) ); }
+    expect_fused_as_unfused( "brightness=0.5,1;linear-combination=1,2,3", make_random( 5, 20003, CV_32FC3, -100, 100 ) );
+}
+
+TEST( filters, fused_map )
+{
+    std::ostringstream oss;
+    for( unsigned int i = 0; i < 100; ++i ) { oss << ( i * 0.5 + 1 ) << std::endl; } // keys 0 to 99 by line number
+    map_file file( "filters_test.map.csv", oss.str() );
+    expect_fused_as_unfused( "map=" + file.name + "&permissive;brightness=0.5,1", make_random( 130, 1001, CV_8UC1, 0, 256 ) );
+    expect_fused_as_unfused( "invert;map=" + file.name + "&permissive;threshold=50,1", make_random( 130, 1001, CV_8UC1, 0, 256 ) );
+    expect_fused_as_unfused( "map=" + file.name + ";brightness=0.5,1", make_random( 130, 1001, CV_8UC1, 0, 100 ) );
+    filters::value_type m = make_random( 130, 1001, CV_8UC1, 0, 256 );
+    testing::internal::CaptureStderr();
+    EXPECT_TRUE( filtered_one_by_one( "map=" + file.name + ";brightness=0.5,1", m ).second.empty() );
+    EXPECT_TRUE( filtered( "map=" + file.name + ";brightness=0.5,1", m ).second.empty() );
+    EXPECT_NE( std::string::npos, testing::internal::GetCapturedStderr().find( "map filter: expected a pixel value from the map" ) );
+}
+
+template < typename T >
+static cv::Mat make_mat( int rows, int cols, int type, const T* values )
+{
+    cv::Mat m( rows, cols, type );
+    for( int i = 0; i < rows; ++i ) { for( int j = 0; j < cols; ++j ) { m.at< T >( i, j ) = values[ i * cols + j ]; } }
+    return m;
+}
+
+static void expect_mapped( const std::string& how, const cv::Mat& input, const double* expected )
+{
+    SCOPED_TRACE( how );
+    filters::value_type n = filtered( how, filters::value_type( boost::posix_time::from_iso_string( "20150101T000000" ), input ) );
+    ASSERT_EQ( input.rows, n.second.rows );
+    ASSERT_EQ( input.cols, n.second.cols );
+    ASSERT_EQ( CV_64FC1, n.second.type() );
+    for( int i = 0; i < input.rows; ++i ) { for( int j = 0; j < input.cols; ++j ) { EXPECT_EQ( expected[ i * input.cols + j ], n.second.at< double >( i, j ) ) << "pixel at " << i << "," << j; } }
+}
+
+TEST( filters, map_negative_keys )
+{
+    map_file file( "filters_test.map.csv", "-32768,1\n-300,2\n-128,3\n-1,4\n0,5\n127,6\n300,7\n32767,8\n" );
+    const signed char b[] = { -128, -1, 0, 127, -1, -128 };
+    const double b_expected[] = { 3, 4, 5, 6, 4, 3 };
+    expect_mapped( "map=" + file.name + "&fields=key,value", make_mat( 2, 3, CV_8SC1, b ), b_expected );
+    const comma::int16 w[] = { -32768, -300, -128, -1, 0, 127, 300, 32767 };
+    const double w_expected[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    expect_mapped( "map=" + file.name + "&fields=key,value", make_mat( 2, 4, CV_16SC1, w ), w_expected );
+}
+
+TEST( filters, map_permissive )
+{
+    map_file file( "filters_test.map.csv", "0.5\n1.5\n2.5\n" ); // keys 0 to 2 by line number
+    const unsigned char ub[] = { 0, 1, 2, 3, 255, 2 };
+    const double ub_expected[] = { 0.5, 1.5, 2.5, 3, 255, 2.5 };
+    expect_mapped( "map=" + file.name + "&permissive", make_mat( 2, 3, CV_8UC1, ub ), ub_expected );
+    const comma::uint16 uw[] = { 65535, 2, 1000, 0 };
+    const double uw_expected[] = { 65535, 2.5, 1000, 0.5 };
+    expect_mapped( "map=" + file.name + "&permissive", make_mat( 2, 2, CV_16UC1, uw ), uw_expected );
+}
+
+TEST( filters, map_missing )
+{
+    map_file file( "filters_test.map.csv", "0.5\n1.5\n" );
+    filters::value_type m( boost::posix_time::from_iso_string( "20150101T000000" ), cv::Mat( 300, 100, CV_8UC1, cv::Scalar( 1 ) ) ); // several bands of rows
+    m.second.at< unsigned char >( 200, 7 ) = 5;
+    testing::internal::CaptureStderr();
+    EXPECT_TRUE( filtered( "map=" + file.name, m ).second.empty() );
+    EXPECT_NE( std::string::npos, testing::internal::GetCapturedStderr().find( "pixel at 200,7 with value 5" ) );
+    filters::value_type n = filtered( "map=" + file.name + "&permissive", m );
+    ASSERT_FALSE( n.second.empty() );
+    EXPECT_EQ( 1.5, n.second.at< double >( 199, 7 ) );
+    EXPECT_EQ( 5, n.second.at< double >( 200, 7 ) );
+}
+
+TEST( filters, map_int32 )
+{
+    map_file file( "filters_test.map.csv", "-100000,1\n5,2\n100000,3\n" );
+    const comma::int32 i[] = { 100000, -100000, 5, 123456789 };
+    const double permissive_expected[] = { 3, 1, 2, 123456789 };
+    expect_mapped( "map=" + file.name + "&fields=key,value&permissive", make_mat( 2, 2, CV_32SC1, i ), permissive_expected );
+    const double expected[] = { 3, 1, 2 };
+    expect_mapped( "map=" + file.name + "&fields=key,value", make_mat( 1, 3, CV_32SC1, i ), expected ); // keys out of 16-bit range looked up in the map
+    testing::internal::CaptureStderr();
+    EXPECT_TRUE( filtered( "map=" + file.name + "&fields=key,value", filters::value_type( boost::posix_time::from_iso_string( "20150101T000000" ), make_mat( 2, 2, CV_32SC1, i ) ) ).second.empty() );
+    EXPECT_NE( std::string::npos, testing::internal::GetCapturedStderr().find( "pixel at 1,1 with value 123456789" ) );
+}
+
+/// random frame; floating point values are multiples of 0.125, so that sums over a window are exact
+static cv::Mat make_frame( int rows, int cols, int type, int seed )
+{
+    cv::Mat m( rows, cols, CV_32SC( CV_MAT_CN( type ) ) );
+    cv::RNG rng( seed );
+    rng.fill( m, cv::RNG::UNIFORM, cv::Scalar::all( 0 ), cv::Scalar::all( CV_MAT_DEPTH( type ) == CV_8U ? 256 : 65536 ) );
+    cv::Mat n;
+    if( CV_MAT_DEPTH( type ) == CV_32F ) { m.convertTo( n, type, 0.125, -4096 ); } else { m.convertTo( n, type ); }
+    return n;
+}
+
+/// brute force maximum, minimum, or mean over all frames of the window
+static cv::Mat sliding_window_expected( const std::vector< cv::Mat >& window, const std::string& operation )
+{
+    if( operation == "mean" )
+    {
+        cv::Mat sum = cv::Mat::zeros( window[0].rows, window[0].cols, CV_MAKETYPE( CV_64F, window[0].channels() ) );
+        for( std::size_t i = 0; i < window.size(); ++i ) { cv::add( sum, window[i], sum, cv::noArray(), sum.type() ); }
+        cv::Mat mean;
+        sum.convertTo( mean, window[0].type(), 1.0 / window.size() );
+        return mean;
+    }
+    cv::Mat r = window[0].clone();
+    for( std::size_t i = 1; i < window.size(); ++i ) { if( operation == "max" ) { cv::max( r, window[i], r ); } else { cv::min( r, window[i], r ); } }
+    return r;
+}
+
+TEST( filters, sliding_window )
+{
+    const char* operations[] = { "max", "min", "mean" };
+    const unsigned int sizes[] = { 1, 3, 5 };
+    const int types[] = { CV_8UC1, CV_16UC1, CV_32FC1, CV_8UC3 };
+    for( unsigned int o = 0; o < sizeof( operations ) / sizeof( operations[0] ); ++o )
+    {
+        for( unsigned int s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); ++s )
+        {
+            for( unsigned int t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+            {
+                std::string how = std::string( operations[o] ) + "=" + boost::lexical_cast< std::string >( sizes[s] );
+                SCOPED_TRACE( how + " on " + boost::lexical_cast< std::string >( types[t] ) );
+                std::vector< filter > f = filters::make( how );
+                std::vector< cv::Mat > window;
+                for( int k = 0; k < 21; ++k ) // 11 frames, then 6 frames of another size, then 4 frames of another type; none a multiple of window size
+                {
+                    SCOPED_TRACE( "frame " + boost::lexical_cast< std::string >( k ) );
+                    int type = k < 17 ? types[t] : CV_MAT_DEPTH( types[t] ) == CV_8U ? CV_16UC1 : CV_8UC1;
+                    cv::Mat frame = make_frame( k < 11 ? 20 : 10, 30, type, k );
+                    if( !window.empty() && ( window[0].size() != frame.size() || window[0].type() != frame.type() ) ) { window.clear(); } // window restarts
+                    window.push_back( frame );
+                    if( window.size() > sizes[s] ) { window.erase( window.begin() ); }
+                    filters::value_type n = filters::apply( f, filters::value_type( boost::posix_time::from_iso_string( "20150101T000000" ), frame.clone() ) );
+                    expect_equal( sliding_window_expected( window, operations[o] ), n.second );
+                }
+            }
+        }
+    }
+}
+
+TEST( filters, bayer_roi )
+{
+    const char* rois[] = { "5,7,990,990", "1,1,30,20", "3,2,17,9", "0,996,1000,5", "999,0,1,1001", "0,0,2,2" }; // odd offsets, image edges, more than one band
+    const int types[] = { CV_8UC1, CV_16UC1 };
+    for( unsigned int t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+    {
+        filters::value_type m = make_random( 1001, 1000, types[t], 0, types[t] == CV_8UC1 ? 256 : 65536 );
+        for( unsigned int k = 1; k <= 4; ++k )
+        {
+            std::string mode = boost::lexical_cast< std::string >( k );
+            SCOPED_TRACE( "bayer=" + mode + " on " + boost::lexical_cast< std::string >( types[t] ) );
+            expect_equal( filtered( "bayer=" + mode, m ).second, filtered( "bayer-roi=" + mode, m ).second );
+            for( unsigned int r = 0; r < sizeof( rois ) / sizeof( rois[0] ); ++r )
+            {
+                SCOPED_TRACE( rois[r] );
+                expect_equal( filtered( "bayer=" + mode + ";crop=" + rois[r], m ).second, filtered( "bayer-roi=" + mode + "," + rois[r], m ).second );
+            }
+        }
+    }
+}
+
+TEST( filters, bayer_roi_half )
+{
+    static const int red_row[] = { 0, 0, 1, 1 }; // for modes 1..4, i.e. opencv bayer bg, gb, rg, gr
+    static const int red_col[] = { 0, 1, 1, 0 };
+    const int types[] = { CV_8UC1, CV_16UC1 };
+    for( unsigned int t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+    {
+        double scale = types[t] == CV_8UC1 ? 1 : 100;
+        cv::Scalar bgr( 50 * scale, 100 * scale, 200 * scale );
+        int type = CV_MAKETYPE( CV_MAT_DEPTH( types[t] ), 3 );
+        for( unsigned int k = 1; k <= 4; ++k )
+        {
+            std::string mode = boost::lexical_cast< std::string >( k );
+            SCOPED_TRACE( "bayer=" + mode + " on " + boost::lexical_cast< std::string >( types[t] ) );
+            filters::value_type m( boost::posix_time::from_iso_string( "20150101T000000" ), cv::Mat( 40, 60, types[t], cv::Scalar( 100 * scale ) ) ); // uniform colour
+            for( int i = red_row[ k - 1 ]; i < m.second.rows; i += 2 ) { for( int j = red_col[ k - 1 ]; j < m.second.cols; j += 2 ) { m.second( cv::Rect( j, i, 1, 1 ) ).setTo( cv::Scalar( 200 * scale ) ); } }
+            for( int i = 1 - red_row[ k - 1 ]; i < m.second.rows; i += 2 ) { for( int j = 1 - red_col[ k - 1 ]; j < m.second.cols; j += 2 ) { m.second( cv::Rect( j, i, 1, 1 ) ).setTo( cv::Scalar( 50 * scale ) ); } }
+            filters::value_type full = filtered( "bayer=" + mode, m );
+            expect_equal( cv::Mat( 36, 56, type, bgr ), full.second( cv::Rect( 2, 2, 56, 36 ) ) ); // same colour as opencv gives away from the border
+            expect_equal( cv::Mat( 20, 30, type, bgr ), filtered( "bayer-roi=" + mode + ",half", m ).second );
+            expect_equal( cv::Mat( 5, 10, type, bgr ), filtered( "bayer-roi=" + mode + ",2,4,20,10,half", m ).second );
+            EXPECT_THROW( filters::make( "bayer-roi=" + mode + ",1,4,20,10,half" ), comma::exception );
+            EXPECT_THROW( filters::make( "bayer-roi=" + mode + ",2,3,20,10,half" ), comma::exception );
+        }
+    }
+}
+
+} } // namespace snark { namespace cv_mat {
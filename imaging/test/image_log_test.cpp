@@ -0,0 +1,225 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <comma/base/exception.h>
+#include <snark/imaging/cv_mat/image_log.h>
+
+namespace snark { namespace cv_mat {
+
+typedef std::pair< boost::posix_time::ptime, cv::Mat > frame_type;
+
+static frame_type make_frame( int k, int rows, int cols, int type, bool noise = false )
+{
+    frame_type f( boost::posix_time::from_iso_string( "20150101T000000" ) + boost::posix_time::seconds( k ), cv::Mat( rows, cols, type ) );
+    int n = cols * f.second.channels();
+    for( int i = 0; i < rows; ++i )
+    {
+        for( int j = 0; j < n; ++j )
+        {
+            double v = noise ? std::rand() % 256 : 100 + 60 * std::sin( i * 0.02 + j * 0.013 + k ) + ( f.second.channels() == 1 && ( ( i & 1 ) ^ ( j & 1 ) ) ? 40 : 0 ) + std::rand() % 4;
+            switch( f.second.depth() )
+            {
+                case CV_8U: f.second.ptr< unsigned char >( i )[j] = v; break;
+                case CV_16U: f.second.ptr< comma::uint16 >( i )[j] = noise ? std::rand() % 65536 : v * 16; break;
+                default: f.second.ptr< float >( i )[j] = v; break;
+            }
+        }
+    }
+    return f;
+}
+
+static void expect_equal( const frame_type& expected, const frame_type& actual )
+{
+    EXPECT_EQ( expected.first, actual.first );
+    ASSERT_EQ( expected.second.rows, actual.second.rows );
+    ASSERT_EQ( expected.second.cols, actual.second.cols );
+    ASSERT_EQ( expected.second.type(), actual.second.type() );
+    std::size_t row_size = expected.second.cols * expected.second.elemSize();
+    for( int i = 0; i < expected.second.rows; ++i ) { ASSERT_EQ( 0, std::memcmp( expected.second.ptr( i ), actual.second.ptr( i ), row_size ) ) << "row " << i; }
+}
+
+static std::string write_log( const std::vector< frame_type >& frames, bool compress = true )
+{
+    std::ostringstream oss;
+    image_log::writer writer( compress );
+    for( std::size_t i = 0; i < frames.size(); ++i ) { writer.write( oss, frames[i] ); }
+    writer.close( oss );
+    return oss.str();
+}
+
+static void expect_round_trip( const std::vector< frame_type >& frames, bool compress = true )
+{
+    std::istringstream iss( write_log( frames, compress ) );
+    image_log::reader reader;
+    for( std::size_t i = 0; i < frames.size(); ++i ) { expect_equal( frames[i], reader.read( iss ) ); }
+    EXPECT_TRUE( reader.read( iss ).second.empty() );
+}
+
+TEST( image_log, round_trip )
+{
+    int types[] = { CV_8UC1, CV_16UC1, CV_8UC3, CV_16UC3 };
+    for( unsigned int t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+    {
+        std::vector< frame_type > frames;
+        for( int k = 0; k < 3; ++k ) { frames.push_back( make_frame( k, 601, 803, types[t] ) ); }
+        std::size_t size = 3 * frames[0].second.rows * frames[0].second.cols * frames[0].second.elemSize();
+        EXPECT_GT( size, write_log( frames ).size() ) << "type " << types[t];
+        expect_round_trip( frames );
+    }
+}
+
+TEST( image_log, round_trip_small )
+{
+    std::vector< frame_type > frames;
+    frames.push_back( make_frame( 0, 1, 1, CV_8UC1 ) );
+    frames.push_back( make_frame( 1, 3, 5, CV_16UC1 ) );
+    frames.push_back( make_frame( 2, 1, 7, CV_8UC3 ) );
+    expect_round_trip( frames );
+}
+
+TEST( image_log, raw )
+{
+    std::vector< frame_type > frames;
+    frames.push_back( make_frame( 0, 601, 803, CV_8UC1, true ) );
+    frames.push_back( make_frame( 1, 601, 803, CV_16UC1, true ) );
+    frames.push_back( make_frame( 2, 101, 203, CV_32FC1 ) );
+    expect_round_trip( frames );
+    frames.push_back( make_frame( 3, 601, 803, CV_8UC1 ) );
+    expect_round_trip( frames, false );
+}
+
+TEST( image_log, seek )
+{
+    std::vector< frame_type > frames;
+    for( int k = 0; k < 5; ++k ) { frames.push_back( make_frame( k, 301, 401, CV_8UC1 ) ); }
+    std::string log = write_log( frames );
+    {
+        std::istringstream iss( log );
+        image_log::reader reader;
+        reader.seek( iss, frames[2].first + boost::posix_time::milliseconds( 1 ) );
+        expect_equal( frames[3], reader.read( iss ) );
+        expect_equal( frames[4], reader.read( iss ) );
+        EXPECT_TRUE( reader.read( iss ).second.empty() );
+    }
+    {
+        std::istringstream iss( log );
+        image_log::reader reader;
+        reader.seek( iss, frames[0].first - boost::posix_time::seconds( 1 ) );
+        expect_equal( frames[0], reader.read( iss ) );
+    }
+    {
+        std::istringstream iss( log );
+        image_log::reader reader;
+        reader.seek( iss, frames[4].first + boost::posix_time::seconds( 1 ) );
+        EXPECT_TRUE( reader.read( iss ).second.empty() );
+    }
+    {
+        std::istringstream iss( log.substr( 0, log.size() - 3 ) ); // no trailer: seek without index
+        image_log::reader reader;
+        reader.seek( iss, frames[1].first );
+        expect_equal( frames[1], reader.read( iss ) );
+        expect_equal( frames[2], reader.read( iss ) );
+    }
+}
+
+TEST( image_log, empty )
+{
+    std::istringstream none;
+    EXPECT_TRUE( image_log::reader().read( none ).second.empty() );
+    std::istringstream iss( write_log( std::vector< frame_type >() ) );
+    EXPECT_TRUE( image_log::reader().read( iss ).second.empty() );
+}
+
+// offsets of frame header fields of the first frame in the log
+static const std::size_t band_rows_offset = 12 + 1 + 8 + 3 * 4;
+static const std::size_t number_of_bands_offset = band_rows_offset + 4;
+static const std::size_t band_size_offset = number_of_bands_offset + 4 + 1;
+
+static std::string corrupted( const std::string& log, std::size_t offset, comma::uint32 value )
+{
+    std::string s = log;
+    std::memcpy( &s[offset], &value, sizeof( comma::uint32 ) );
+    return s;
+}
+
+static frame_type read_first( const std::string& log )
+{
+    std::istringstream iss( log );
+    return image_log::reader().read( iss );
+}
+
+TEST( image_log, corrupted )
+{
+    std::vector< frame_type > frames( 1, make_frame( 0, 101, 103, CV_8UC1 ) );
+    std::string compressed = write_log( frames );
+    std::string raw = write_log( frames, false );
+    comma::uint32 size;
+    std::memcpy( &size, &compressed[band_size_offset], sizeof( comma::uint32 ) );
+    expect_equal( frames[0], read_first( compressed ) );
+    EXPECT_THROW( read_first( corrupted( compressed, band_rows_offset, 0 ) ), comma::exception );
+    EXPECT_THROW( read_first( corrupted( compressed, number_of_bands_offset, 2 ) ), comma::exception );
+    EXPECT_THROW( read_first( corrupted( raw, band_size_offset, 101 * 103 + 1 ) ), comma::exception );
+    EXPECT_THROW( read_first( corrupted( raw, band_size_offset, 101 * 103 - 1 ) ), comma::exception );
+    EXPECT_ANY_THROW( read_first( corrupted( compressed, band_size_offset, size / 2 ) ) ); // decoder would read past its band; thrown from tbb
+}
+
+static std::string corrupted_index( const std::string& log, std::size_t offset, comma::uint64 value )
+{
+    std::string s = log;
+    std::memcpy( &s[offset], &value, sizeof( comma::uint64 ) );
+    return s;
+}
+
+static void seek_first( const std::string& log, const boost::posix_time::ptime& t )
+{
+    std::istringstream iss( log );
+    image_log::reader().seek( iss, t );
+}
+
+TEST( image_log, corrupted_index )
+{
+    std::vector< frame_type > frames;
+    for( int k = 0; k < 3; ++k ) { frames.push_back( make_frame( k, 31, 41, CV_8UC1 ) ); }
+    std::string log = write_log( frames );
+    std::size_t trailer = log.size() - 16;
+    comma::uint64 index_offset;
+    std::memcpy( &index_offset, &log[trailer], sizeof( comma::uint64 ) );
+    std::size_t count_offset = index_offset + 1;
+    seek_first( log, frames[1].first );
+    EXPECT_THROW( seek_first( corrupted_index( log, count_offset, comma::uint64( 1 ) << 60 ), frames[1].first ), comma::exception ); // would allocate by unchecked count
+    EXPECT_THROW( seek_first( corrupted_index( log, count_offset, 4 ), frames[1].first ), comma::exception );
+    EXPECT_THROW( seek_first( corrupted_index( log, trailer, log.size() ), frames[1].first ), comma::exception );
+    EXPECT_THROW( seek_first( corrupted_index( log, trailer, comma::uint64( -1 ) ), frames[1].first ), comma::exception );
+}
+
+} } // namespace snark { namespace cv_mat {
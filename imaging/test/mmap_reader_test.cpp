@@ -0,0 +1,144 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <snark/imaging/cv_mat/mmap_reader.h>
+
+namespace snark { namespace cv_mat {
+
+static const char* filename = "mmap_reader_test.bin";
+static const boost::posix_time::ptime start = boost::posix_time::from_iso_string( "20150101T000000" );
+
+static std::pair< boost::posix_time::ptime, cv::Mat > make_frame( unsigned int k ) { return std::make_pair( start + boost::posix_time::seconds( k ), cv::Mat( 100, 100, CV_8UC3, cv::Scalar::all( k ) ) ); } // a few pages per frame
+
+/// write given number of frames, the last one truncated by given number of bytes
+static void write_frames( unsigned int size, std::size_t truncated = 0 )
+{
+    std::ostringstream oss;
+    serialization::options options; // same header as mmap_reader expects by default
+    serialization s( options );
+    for( unsigned int k = 0; k < size; ++k ) { s.write( oss, make_frame( k ) ); }
+    std::ofstream ofs( filename, std::ios::binary );
+    ofs.write( oss.str().data(), oss.str().size() - truncated );
+}
+
+static unsigned int value( const cv::Mat& m ) { return m.at< cv::Vec3b >( m.rows / 2, m.cols / 2 )[0]; }
+
+class mmap_reader_test : public ::testing::Test
+{
+    protected:
+        void TearDown() { std::remove( filename ); }
+};
+
+TEST_F( mmap_reader_test, read )
+{
+    write_frames( 5 );
+    mmap_reader reader( mmap_reader::config( filename ) );
+    for( unsigned int k = 0; k < 5; ++k )
+    {
+        EXPECT_FALSE( reader.eof() );
+        std::pair< boost::posix_time::ptime, cv::Mat > p = reader.read();
+        EXPECT_EQ( start + boost::posix_time::seconds( k ), p.first );
+        ASSERT_EQ( 100, p.second.rows );
+        ASSERT_EQ( 100, p.second.cols );
+        ASSERT_EQ( CV_8UC3, p.second.type() );
+        EXPECT_EQ( k, value( p.second ) );
+    }
+    EXPECT_TRUE( reader.eof() );
+    EXPECT_TRUE( reader.read().second.empty() );
+}
+
+TEST_F( mmap_reader_test, seek_frame )
+{
+    write_frames( 5 );
+    mmap_reader reader( mmap_reader::config( filename ) );
+    EXPECT_TRUE( reader.seek( 3 ) );
+    EXPECT_EQ( 3u, value( reader.read().second ) );
+    EXPECT_TRUE( reader.seek( 1 ) );
+    EXPECT_EQ( 1u, reader.frame() );
+    EXPECT_EQ( 1u, value( reader.read().second ) );
+    EXPECT_TRUE( reader.seek( 4 ) );
+    EXPECT_EQ( 4u, value( reader.read().second ) );
+    EXPECT_FALSE( reader.seek( 5 ) );
+    EXPECT_EQ( 5u, reader.frame() );
+    EXPECT_TRUE( reader.read().second.empty() );
+    EXPECT_FALSE( reader.seek( 100 ) );
+}
+
+TEST_F( mmap_reader_test, seek_time )
+{
+    write_frames( 5 );
+    mmap_reader reader( mmap_reader::config( filename ) );
+    EXPECT_TRUE( reader.seek( start + boost::posix_time::seconds( 2 ) ) );
+    EXPECT_EQ( 2u, value( reader.read().second ) );
+    EXPECT_TRUE( reader.seek( start - boost::posix_time::seconds( 1 ) ) ); // back to the start, from the index
+    EXPECT_EQ( 0u, value( reader.read().second ) );
+    EXPECT_TRUE( reader.seek( start + boost::posix_time::milliseconds( 3500 ) ) );
+    EXPECT_EQ( 4u, value( reader.read().second ) );
+    EXPECT_FALSE( reader.seek( start + boost::posix_time::seconds( 5 ) ) );
+    EXPECT_TRUE( reader.read().second.empty() );
+}
+
+TEST_F( mmap_reader_test, truncated )
+{
+    write_frames( 3, 10 );
+    mmap_reader reader( mmap_reader::config( filename ) );
+    EXPECT_EQ( 0u, value( reader.read().second ) );
+    EXPECT_EQ( 1u, value( reader.read().second ) );
+    EXPECT_TRUE( reader.read().second.empty() );
+    EXPECT_TRUE( reader.eof() );
+    EXPECT_FALSE( reader.seek( 2 ) );
+    EXPECT_FALSE( reader.seek( start + boost::posix_time::seconds( 2 ) ) );
+}
+
+TEST_F( mmap_reader_test, release )
+{
+    const unsigned int release = 3;
+    write_frames( 10 );
+    mmap_reader reader( mmap_reader::config( filename, serialization::options(), release ) );
+    std::deque< std::pair< unsigned int, cv::Mat > > frames; // frames within release lag
+    for( unsigned int k = 0; k < 10; ++k )
+    {
+        cv::Mat m = reader.read().second;
+        ASSERT_EQ( k, value( m ) );
+        m.setTo( cv::Scalar::all( 200 + k ) ); // modify in place, e.g. as a filter would
+        frames.push_back( std::make_pair( k, m ) );
+        if( frames.size() > release )
+        {
+            EXPECT_EQ( frames.front().first, value( frames.front().second ) ); // released: reverted to file contents
+            frames.pop_front();
+        }
+        for( std::size_t i = 0; i < frames.size(); ++i ) { EXPECT_EQ( 200 + frames[i].first, value( frames[i].second ) ) << "frame " << frames[i].first << " after reading frame " << k; }
+    }
+}
+
+} } // namespace snark { namespace cv_mat {
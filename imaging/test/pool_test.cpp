@@ -0,0 +1,90 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <gtest/gtest.h>
+#include <snark/imaging/cv_mat/pool.h>
+
+namespace snark { namespace cv_mat {
+
+TEST( pool, reuse )
+{
+    pool p( 4 );
+    const uchar* data;
+    {
+        cv::Mat m = p.make( 11, 13, CV_8UC3 );
+        data = m.data;
+        EXPECT_EQ( 0u, p.size() );
+    }
+    EXPECT_EQ( 1u, p.size() );
+    cv::Mat m = p.make( 11, 13, CV_8UC3 );
+    EXPECT_EQ( data, m.data );
+    EXPECT_EQ( 0u, p.size() );
+    cv::Mat n = p.make( 13, 11, CV_8UC1 ); // different size: new buffer
+    EXPECT_NE( data, n.data );
+}
+
+TEST( pool, reference_count )
+{
+    pool p( 4 );
+    cv::Mat m = p.make( 5, 7, CV_8UC1 );
+    const uchar* data = m.data;
+    cv::Mat copy = m;
+    m.release();
+    EXPECT_EQ( 0u, p.size() ); // still referenced by copy
+    cv::Mat n = p.make( 5, 7, CV_8UC1 );
+    EXPECT_NE( data, n.data );
+    copy.release();
+    EXPECT_EQ( 1u, p.size() );
+    n.release();
+    EXPECT_EQ( 2u, p.size() );
+}
+
+TEST( pool, eviction )
+{
+    pool p( 2 );
+    {
+        cv::Mat a = p.make( 10, 10, CV_8UC1 );
+        cv::Mat b = p.make( 10, 10, CV_8UC1 );
+    }
+    EXPECT_EQ( 2u, p.size() );
+    const uchar* data[2];
+    {
+        cv::Mat a = p.make( 20, 20, CV_8UC1 ); // e.g. after resolution change
+        cv::Mat b = p.make( 20, 20, CV_8UC1 );
+        data[0] = a.data;
+        data[1] = b.data;
+    }
+    EXPECT_EQ( 2u, p.size() ); // old buffers evicted to make room for new ones
+    cv::Mat a = p.make( 20, 20, CV_8UC1 );
+    cv::Mat b = p.make( 20, 20, CV_8UC1 );
+    EXPECT_TRUE( a.data == data[0] || a.data == data[1] );
+    EXPECT_TRUE( b.data == data[0] || b.data == data[1] );
+    EXPECT_EQ( 0u, p.size() );
+}
+
+} } // namespace snark { namespace cv_mat {
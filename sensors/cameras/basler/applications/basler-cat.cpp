@@ -38,7 +38,8 @@
 #include <comma/name_value/map.h>
 #include <comma/visiting/traits.h>
 #include <snark/imaging/cv_mat/pipeline.h>
-#include <snark/imaging/cv_mat/bursty_pipeline.h>
+#include <snark/imaging/cv_mat/pool.h>
+#include <snark/tbb/bursty_pipeline.h>
 #include <pylon/PylonIncludes.h>
 #include <pylon/gige/BaslerGigECamera.h>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -195,11 +196,11 @@ static P capture_( Pylon::CBaslerGigECamera& camera, Pylon::CBaslerGigECamera::S
         switch( header.type )
         {
             case CV_8UC1:
-                pair.second = cv::Mat( result.GetSizeY(), result.GetSizeX(), header.type );
+                pair.second = snark::cv_mat::pool::instance().make( result.GetSizeY(), result.GetSizeX(), header.type );
                 ::memcpy( pair.second.data, reinterpret_cast< const char* >( result.Buffer() ), pair.second.dataend - pair.second.datastart );
                 break;
             case CV_8UC3: // quick and dirty for now: rgb are not contiguous in basler camera frame
-                pair.second = cv::Mat( result.GetSizeY(), result.GetSizeX(), header.type );
+                pair.second = snark::cv_mat::pool::instance().make( result.GetSizeY(), result.GetSizeX(), header.type );
                 ::memcpy( pair.second.data, reinterpret_cast< const char* >( result.Buffer() ), pair.second.dataend - pair.second.datastart );
                 cv::cvtColor( pair.second, pair.second, CV_RGB2BGR );
                 break;
@@ -313,6 +314,7 @@ int main( int argc, char** argv )
             ( "help,h", "display help message" )
             ( "address", boost::program_options::value< std::string >( &address ), "camera ip address; default: connect to the first available camera" )
             ( "discard", "discard frames, if cannot keep up; same as --buffer=1" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "list-cameras", "output camera list and exit" )
             ( "fields,f", boost::program_options::value< std::string >( &options.fields )->default_value( "t,rows,cols,type" ), "header fields, possible values: t,rows,cols,type,size,counters" )
@@ -333,6 +335,7 @@ int main( int argc, char** argv )
             ( "timeout", boost::program_options::value< double >( &timeout_seconds )->default_value( 3.0 ), " frame acquisition timeout" )
             ( "test-colour", "output colour test image" )
             ( "verbose,v", "be more verbose" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
         boost::program_options::variables_map vm;
         boost::program_options::store( boost::program_options::parse_command_line( argc, argv, description), vm );
         boost::program_options::parsed_options parsed = boost::program_options::command_line_parser(argc, argv).options( description ).allow_unregistered().run();
@@ -649,7 +652,8 @@ int main( int argc, char** argv )
         {
             snark::cv_mat::serialization serialization( options );
             snark::tbb::bursty_reader< Pair > reader( boost::bind( &capture_< Pair >, boost::ref( camera ), boost::ref( grabber ) ), discard );
-            snark::imaging::applications::pipeline pipeline( serialization, filters, reader );
+            snark::imaging::applications::pipeline pipeline( serialization, filters, reader, 0, vm.count( "latency" ) ? 1 : 0 );
+            pipeline.profile( vm );
             camera.AcquisitionMode.SetValue( Basler_GigECamera::AcquisitionMode_Continuous );
             camera.AcquisitionStart.Execute(); // continuous acquisition mode        
             if( verbose ) { std::cerr << "basler-cat: running..." << std::endl; }
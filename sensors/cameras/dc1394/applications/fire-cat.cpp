@@ -29,6 +29,7 @@
 
 
 #include <snark/imaging/cv_mat/pipeline.h>
+#include <snark/imaging/cv_mat/pool.h>
 #include "../dc1394.h"
 #include <boost/program_options.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -51,8 +52,9 @@ static Pair capture( snark::camera::dc1394& camera )
 {
     static comma::signal_flag is_shutdown;
     if( is_shutdown ) { reader->stop(); return Pair(); }
-    cv::Mat image = camera.read();
-    return std::make_pair( camera.time(), image.clone() );
+    cv::Mat image = snark::cv_mat::pool::instance().make();
+    camera.read().copyTo( image );
+    return std::make_pair( camera.time(), image );
 }
 
 int main( int argc, char** argv )
@@ -70,12 +72,14 @@ int main( int argc, char** argv )
             ( "list", "list cameras on the bus with guids" )
             ( "list-attributes", "output current camera attributes" )
             ( "discard,d", "discard frames, if cannot keep up; same as --buffer=1" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "config,c", boost::program_options::value< std::string >( &config_string ), "configuration file for the camera or semicolon-separated name=value string, see long help for details" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "fields,f", boost::program_options::value< std::string >( &fields )->default_value( "t,rows,cols,type" ), "header fields, possible values: t,rows,cols,type,size" )
             ( "header", "output header only" )
             ( "no-header", "output image data only" )
             ( "strobe", boost::program_options::value< std::string >( &strobe_string ), "strobe control" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
         boost::program_options::variables_map vm;
         boost::program_options::store( boost::program_options::parse_command_line( argc, argv, description), vm );
         boost::program_options::parsed_options parsed = boost::program_options::command_line_parser(argc, argv).options( description ).allow_unregistered().run();
@@ -203,7 +207,8 @@ int main( int argc, char** argv )
         if( trigger_strobe_and_exit ) { return 0; }
         if( vm.count( "list-attributes" ) ) { camera.list_attributes(); return 0; }
         reader.reset( new snark::tbb::bursty_reader< Pair >( boost::bind( &capture, boost::ref( camera ) ), discard ) );
-        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader );
+        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader, 0, vm.count( "latency" ) ? 1 : 0 );
+        pipeline.profile( vm );
         pipeline.run();
         return 0;
     }
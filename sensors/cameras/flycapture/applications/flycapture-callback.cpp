@@ -38,6 +38,7 @@
 #include <comma/csv/stream.h>
 #include <comma/name_value/map.h>
 #include <snark/imaging/cv_mat/filters.h>
+#include <snark/imaging/cv_mat/pool.h>
 #include <snark/imaging/cv_mat/serialization.h>
 #include <snark/tbb/queue.h>
 #include "../flycapture.h"
@@ -79,6 +80,7 @@ static void on_frame_( const Pair& p ) // quick and dirty
     Pair q;
     if( is_shutdown || !running ) { return queue.push( q ); } // to force read exit
     q.first = p.first;
+    q.second = snark::cv_mat::pool::instance().make();
     p.second.copyTo( q.second ); // quick and dirty: full copy; todo: implement circular queue in flycapture::callback?
     queue.push( q );
     
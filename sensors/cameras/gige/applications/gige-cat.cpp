@@ -63,6 +63,7 @@ int main( int argc, char** argv )
             ( "id", boost::program_options::value< unsigned int >( &id )->default_value( 0 ), "camera id; default: first available camera" )
             ( "frame-timeout,t", boost::program_options::value< unsigned int >( &timeout )->default_value( 0 ), "timeout requesting frames from camera; default: 3x max frame interval up to interval + 500ms" )
             ( "discard", "discard frames, if cannot keep up; same as --buffer=1" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "fields,f", boost::program_options::value< std::string >( &fields )->default_value( "t,rows,cols,type" ), "header fields, possible values: t,rows,cols,type,size" )
             ( "list-attributes", "output current camera attributes" )
@@ -70,6 +71,7 @@ int main( int argc, char** argv )
             ( "header", "output header only" )
             ( "no-header", "output image data only" )
             ( "verbose,v", "be more verbose" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
 
         boost::program_options::variables_map vm;
         boost::program_options::store( boost::program_options::parse_command_line( argc, argv, description), vm );
@@ -149,7 +151,8 @@ int main( int argc, char** argv )
             serialization.reset( new snark::cv_mat::serialization( fields, format, vm.count( "header" ) ) );
         }
         reader.reset( new snark::tbb::bursty_reader< Pair >( boost::bind( &capture, boost::ref( camera ) ), discard ) );
-        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader );
+        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader, 0, vm.count( "latency" ) ? 1 : 0 );
+        pipeline.profile( vm );
         pipeline.run();
         return 0;
     }
@@ -64,6 +64,7 @@ int main( int argc, char** argv )
             ( "set-and-exit", "set camera attributes specified in --set and exit" )
             ( "address", boost::program_options::value< std::string >( &address )->default_value( "" ), "ip address of the camera" )
             ( "discard", "discard frames, if cannot keep up; same as --buffer=1" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "fields,f", boost::program_options::value< std::string >( &fields )->default_value( "t,rows,cols,type" ), "header fields, possible values: t,rows,cols,type,size" )
             ( "list-attributes", "output current camera attributes" )
@@ -73,6 +74,7 @@ int main( int argc, char** argv )
             ( "calibration", boost::program_options::value< std::string >( &calibration_file ), "calibration file for thermography")
             ( "output-conversion", boost::program_options::value< std::string >( &directory ), "output conversion table to a timestamped csv file in the specified directory")
             ( "verbose,v", "be more verbose" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
             
         std::ostringstream autocorrection_message;
         autocorrection_message << "autocorrection attributes:" << std::endl;
@@ -180,7 +182,8 @@ int main( int argc, char** argv )
             serialization.reset( new snark::cv_mat::serialization( fields, format, vm.count( "header" ) ) );
         }
         reader.reset( new snark::tbb::bursty_reader< Pair >( boost::bind( &capture, boost::ref( camera ) ), discard ) );
-        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader );
+        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader, 0, vm.count( "latency" ) ? 1 : 0 );
+        pipeline.profile( vm );
         pipeline.run();
         return 0;
     }
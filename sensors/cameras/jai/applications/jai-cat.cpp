@@ -86,6 +86,7 @@ int main( int argc, char** argv )
             ( "do-and-exit", "perform --set, or --load-settings, or --save-settings and exit" )
             ( "id", boost::program_options::value< std::string >( &id )->default_value( "" ), "any fragment of user-readable part of camera id; connect to the first device with matching id" )
             ( "discard", "discard frames, if cannot keep up; same as --buffer=1" )
+            ( "latency", "prefer lower latency per frame over throughput: process one frame at a time using all threads within the frame" )
             ( "buffer", boost::program_options::value< unsigned int >( &discard )->default_value( 0 ), "maximum buffer size before discarding frames, default: unlimited" )
             ( "fields,f", boost::program_options::value< std::string >( &fields )->default_value( "t,rows,cols,type" ), "header fields, possible values: t,rows,cols,type,size" )
             ( "list-cameras,l", "list all cameras" )
@@ -98,6 +99,7 @@ int main( int argc, char** argv )
             ( "no-header", "output image data only" )
             ( "output-conversion", boost::program_options::value< std::string >( &directory ), "output conversion table to a timestamped csv file in the specified directory")
             ( "verbose,v", "be more verbose" );
+        snark::imaging::applications::pipeline::add_profile_options( description );
 
         boost::program_options::variables_map vm;
         boost::program_options::store( boost::program_options::parse_command_line( argc, argv, description), vm );
@@ -208,7 +210,8 @@ int main( int argc, char** argv )
         camera->start_acquisition();
         if( verbose ) { std::cerr << "jai-cat: data acquisition: started" << std::endl; }
         reader.reset( new snark::tbb::bursty_reader< pair_t >( boost::bind( &capture, boost::ref( stream ) ), discard ) );
-        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader );
+        snark::imaging::applications::pipeline pipeline( *serialization, filters, *reader, 0, vm.count( "latency" ) ? 1 : 0 );
+        pipeline.profile( vm );
         pipeline.run();
         return 0;
     }
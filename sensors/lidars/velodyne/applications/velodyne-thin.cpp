@@ -32,9 +32,6 @@
 #include <boost/array.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/optional.hpp>
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/uniform_real.hpp>
-#include <boost/random/variate_generator.hpp>
 #include <boost/shared_ptr.hpp>
 #include <comma/application/command_line_options.h>
 #include <comma/application/signal_flag.h>
@@ -71,6 +68,10 @@ static void usage()
     std::cerr << std::endl;
     std::cerr << "data flow options" << std::endl;
     std::cerr << "    --output-raw: if present, output uncompressed thinned packets" << std::endl;
+    std::cerr << "    --compress: if present, delta- and entropy-code ranges of thinned packets" << std::endl;
+    std::cerr << "                output is about 2.5 times smaller unthinned and 1.5-1.9 times smaller thinned," << std::endl;
+    std::cerr << "                since presence of randomly thinned returns hardly compresses" << std::endl;
+    std::cerr << "                velodyne-to-csv --thin reads both formats" << std::endl;
     std::cerr << "    --pcap: if present, velodyne data is read from pcap packets" << std::endl;
     std::cerr << "             e.g: cat velo.pcap | velodyne-thin <options> --pcap" << std::endl;
     std::cerr << "    --proprietary,-q : read velodyne data directly from stdin using the proprietary protocol" << std::endl;
@@ -81,9 +82,11 @@ static void usage()
     std::cerr << std::endl;
     std::cerr << "filtering options" << std::endl;
     std::cerr << "    --udp-port <port>: if present, read raw velodyne packets from udp and timestamp them" << std::endl;
+    std::cerr << "        --udp-receive-buffer=<bytes>: socket receive buffer size; default: system default" << std::endl;
     std::cerr << "    --rate <rate>: thinning rate between 0 and 1" << std::endl;
     std::cerr << "                    default 1: send all valid datapoints" << std::endl;
     std::cerr << "    --scan-rate <rate>: scan thin rate between 0 and 1" << std::endl;
+    std::cerr << "    --seed=<seed>: seed for random thinning; same seed on the same input gives the same output; default: 0" << std::endl;
     std::cerr << "    --focus --region <options>: focus on particular region" << std::endl;
     std::cerr << "        <options>" << std::endl;
     std::cerr << "            sector: e.g: sector;range=10;bearing=0;ken=30" << std::endl;
@@ -100,7 +103,9 @@ static void usage()
 
 static bool verbose = false;
 static bool outputRaw = false;
+static bool compress = false;
 static boost::optional< float > rate;
+static comma::uint64 seed = 0;
 static boost::optional< double > scan_rate;
 static boost::optional< double > angularSpeed_;
 static boost::optional< velodyne::db > db;
@@ -139,9 +144,7 @@ template < typename S >
 void run( S* stream )
 {
     static const unsigned int timeSize = 12;
-    boost::mt19937 generator;
-    boost::uniform_real< float > distribution( 0, 1 );
-    boost::variate_generator< boost::mt19937&, boost::uniform_real< float > > random( generator, distribution );
+    velodyne::thin::random random( seed );
     comma::uint64 count = 0;
     comma::uint64 dropped_count = 0;
     double compression = 0;
@@ -184,7 +187,7 @@ void run( S* stream )
         {
             // todo: certainly rewrite with the proper header using comma::packed
             static char buf[ timeSize + sizeof( comma::uint16 ) + velodyne::thin::maxBufferSize ];
-            comma::uint16 size = velodyne::thin::serialize( packet, buf + timeSize + sizeof( comma::uint16 ), scan_id );
+            comma::uint16 size = velodyne::thin::serialize( packet, buf + timeSize + sizeof( comma::uint16 ), scan_id, compress );
             bool empty = size == ( sizeof( comma::uint32 ) + 1 ); // todo: atrocious... i.e. packet is not empty; refactor!!!
             if( !empty )
             {
@@ -220,6 +223,7 @@ int main( int ac, char** av )
         comma::command_line_options options( ac, av );
         if( options.exists( "--help,-h" ) ) { usage(); }
         outputRaw = options.exists( "--output-raw" );
+        compress = options.exists( "--compress" );
         rate = options.optional< float >( "--rate" );
 
         scan_rate = options.optional< double >( "--scan-rate" );
@@ -252,16 +256,18 @@ int main( int ac, char** av )
         if( options.exists( "--focus,--region" ) )
         {
             focus.reset( make_focus( options.value< std::string >( "--focus,--region" ), rate ? *rate : 1.0 ) );
+            focus->index( *db );
             std::cerr << "velodyne-thin: rate in focus: " << focus->rate_in_focus() << "; rate out of focus: " << focus->rate_out_of_focus() << "; coverage: " << focus->coverage() << std::endl;
         }
         verbose = options.exists( "--verbose,-v" );
+        seed = options.value< comma::uint64 >( "--seed", 0 );
         #ifdef WIN32
         _setmode( _fileno( stdin ), _O_BINARY );
         _setmode( _fileno( stdout ), _O_BINARY );
         #endif
         options.assert_mutually_exclusive( "--pcap,--udp-port,--proprietary,-q" );
         boost::optional< unsigned short > port = options.optional< unsigned short >( "--udp-port" );
-        if( port ) { run( new snark::udp_reader( *port ) ); }
+        if( port ) { run( new snark::udp_reader( snark::udp_reader::config( *port, options.value< unsigned int >( "--udp-receive-buffer", 0 ) ) ) ); }
         else if( options.exists( "--pcap" ) ) { run( new snark::pcap_reader ); }
         else if( options.exists( "--proprietary,-q" ) )
         {
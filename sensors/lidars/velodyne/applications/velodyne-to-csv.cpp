@@ -28,6 +28,10 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <boost/bind.hpp>
 #include <boost/optional.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
@@ -39,14 +43,22 @@
 #include <comma/csv/format.h>
 #include <comma/csv/names.h>
 #include <comma/csv/stream.h>
+#include <comma/io/stream.h>
+#include <comma/name_value/parser.h>
 #include <comma/string/string.h>
 #include <comma/visiting/traits.h>
+#include <snark/timing/time.h>
+#include <tbb/pipeline.h>
+#include <snark/tbb/bursty_pipeline.h>
+#include <snark/tbb/bursty_reader.h>
+#include "../impl/pcap_mmap_reader.h"
 #include "../impl/pcap_reader.h"
 #include "../impl/proprietary_reader.h"
 #include "../impl/thin_reader.h"
 #include "../impl/udp_reader.h"
 #include "../impl/stream_reader.h"
 #include "../impl/velodyne_stream.h"
+#include "../deskew.h"
 
 //#include <google/profiler.h>
 
@@ -68,14 +80,21 @@ static void usage()
     std::cerr << "    --db <db.xml file> ; default /usr/local/etc/db.xml" << std::endl;
     std::cerr << "              if the file is a version 0 then the legacy option is used for timing and azimuth calculation" << std::endl;
     std::cerr << "    --pcap : if present, velodyne data is read from pcap packets" << std::endl;
+    std::cerr << "    --pcap-file=<filename> : read velodyne data from pcap or pcapng file, faster than --pcap" << std::endl;
+    std::cerr << "        --pcap-port=<port> : udp port of velodyne data packets; 0: any; default 2368" << std::endl;
+    std::cerr << "        --pcap-index=<filename> : scan index file for fast seek with --scans" << std::endl;
+    std::cerr << "                                  if file does not exist or belongs to another pcap file, it is (re)built" << std::endl;
     std::cerr << "    --thin : if present, velodyne data is thinned (e.g. by velodyne-thin)" << std::endl;
     std::cerr << "    --udp-port <port> : read velodyne data directly from udp port" << std::endl;
+    std::cerr << "        --udp-receive-buffer=<bytes> : socket receive buffer size; increase, if packets get dropped; default: system default" << std::endl;
     std::cerr << "    --proprietary,-q : read velodyne data directly from stdin using the proprietary protocol" << std::endl;
     std::cerr << "        <header, 16 bytes><timestamp, 12 bytes><packet, 1206 bytes><footer, 4 bytes>" << std::endl;
     std::cerr << "    default input format: <timestamp, 8 bytes><packet, 1206 bytes>" << std::endl;
     std::cerr << std::endl;
     std::cerr << "output options:" << std::endl;
     std::cerr << "    --binary,-b[=<format>]: if present, output in binary equivalent of csv" << std::endl;
+    std::cerr << "        --no-fast-binary: write binary through generic csv output stream, e.g. for debugging" << std::endl;
+    std::cerr << "                          default: if each field has its default type, records are packed directly" << std::endl;
     std::cerr << "    --fields <fields>: e.g. t,x,y,z,scan" << std::endl;
     std::cerr << "    --format: output full binary format and exit (see examples)" << std::endl;
     std::cerr << "    --min-range=<value>: do not output points closer than <value>; default 0" << std::endl;
@@ -86,6 +105,15 @@ static void usage()
     std::cerr << "                                    :3 for scans 0, 1, 2, 3" << std::endl;
     std::cerr << "    --raw-intensity: output intensity data without any correction" << std::endl;
     std::cerr << "    --legacy: use old timetable and old algorithm for azimuth calculation" << std::endl;
+    std::cerr << "    --threads=<n>: decode and format packets in <n> threads, output order is preserved; 0: auto" << std::endl;
+    std::cerr << "                   default: decode and format in the main thread" << std::endl;
+    std::cerr << "    --batch-size=<n>: number of packets passed to a thread in one go, if --threads given; default 64" << std::endl;
+    std::cerr << "    --lookup-table: take sin and cos of corrected azimuth from precomputed table (about 18MB)" << std::endl;
+    std::cerr << "                    faster, but point coordinates may differ by a few micrometres" << std::endl;
+    std::cerr << "    --nav=<file>[;<csv options>]: sensor poses over time, output points in the frame of the poses (de-skewed)" << std::endl;
+    std::cerr << "                    pose is interpolated once per laser block at the block firing time, the same way as points-frame does" << std::endl;
+    std::cerr << "                    points out of the time range of the poses are not output" << std::endl;
+    std::cerr << "                    default fields: t,x,y,z,roll,pitch,yaw, e.g. --nav=\"nav.bin;binary=t,6d\"" << std::endl;
     std::cerr << "    default output columns: " << comma::join( comma::csv::names< velodyne_point >(), ',' ) << std::endl;
     std::cerr << "    default binary format: " << comma::csv::format::value< velodyne_point >() << std::endl;
     std::cerr << std::endl;
@@ -111,9 +139,145 @@ static void usage()
     exit( -1 );
 }
 
+static boost::scoped_ptr< velodyne::deskew > deskew;
+
+static velodyne::deskew* make_deskew( const std::string& options )
+{
+    comma::csv::options csv = comma::name_value::parser( "filename" ).get< comma::csv::options >( options );
+    if( csv.fields.empty() ) { csv.fields = "t,x,y,z,roll,pitch,yaw"; }
+    csv.full_xpath = false;
+    comma::io::istream is( csv.filename, csv.binary() ? comma::io::mode::binary : comma::io::mode::ascii );
+    comma::csv::input_stream< velodyne::pose > istream( *is, csv );
+    std::vector< velodyne::pose > poses;
+    while( is->good() && !is->eof() )
+    {
+        const velodyne::pose* p = istream.read();
+        if( !p ) { break; }
+        poses.push_back( *p );
+    }
+    return new velodyne::deskew( poses );
+}
+
+/// writes points as packed binary records straight into a buffer, with the same
+/// layout as comma::csv::output_stream< velodyne_point >, but without visiting
+/// each field of each point; supports only the default binary type of each field
+class binary_writer
+{
+    public:
+        /// @return writer for given csv options or NULL, if fields or format are not supported
+        static binary_writer* make( const comma::csv::options& csv )
+        {
+            if( !csv.binary() ) { return NULL; }
+            std::vector< std::string > names = comma::split( csv.fields.empty() ? comma::join( comma::csv::names< velodyne_point >(), ',' ) : csv.fields, ',' );
+            std::vector< std::string > v;
+            for( std::size_t i = 0; i < names.size(); ++i )
+            {
+                if( names[i] == "ray" ) { names[i] = "ray/first"; names.insert( names.begin() + i + 1, "ray/second" ); }
+                if( names[i] == "ray/first" || names[i] == "ray/second" ) { v.push_back( names[i] + "/x" ); v.push_back( names[i] + "/y" ); v.push_back( names[i] + "/z" ); }
+                else { v.push_back( names[i] ); }
+            }
+            binary_writer writer;
+            std::string format;
+            for( std::size_t i = 0; i < v.size(); ++i )
+            {
+                field f;
+                f.offset = writer.m_size;
+                if( v[i] == "t" ) { f.type = field::t; format += ",t"; writer.m_size += sizeof( comma::int64 ); }
+                else if( v[i] == "id" ) { f.type = field::id; format += ",ui"; writer.m_size += sizeof( comma::uint32 ); }
+                else if( v[i] == "intensity" ) { f.type = field::intensity; format += ",ui"; writer.m_size += sizeof( comma::uint32 ); }
+                else if( v[i] == "scan" ) { f.type = field::scan; format += ",ui"; writer.m_size += sizeof( comma::uint32 ); }
+                else if( v[i] == "valid" ) { f.type = field::valid; format += ",b"; writer.m_size += 1; }
+                else
+                {
+                    if( v[i] == "ray/first/x" ) { f.type = field::first_x; }
+                    else if( v[i] == "ray/first/y" ) { f.type = field::first_y; }
+                    else if( v[i] == "ray/first/z" ) { f.type = field::first_z; }
+                    else if( v[i] == "ray/second/x" ) { f.type = field::second_x; }
+                    else if( v[i] == "ray/second/y" ) { f.type = field::second_y; }
+                    else if( v[i] == "ray/second/z" ) { f.type = field::second_z; }
+                    else if( v[i] == "azimuth" ) { f.type = field::azimuth; }
+                    else if( v[i] == "range" ) { f.type = field::range; }
+                    else if( v[i] == "" ) { f.type = field::none; }
+                    else { return NULL; }
+                    format += ",d";
+                    writer.m_size += sizeof( double );
+                }
+                writer.m_fields.push_back( f );
+            }
+            if( comma::csv::format( format.substr( 1 ) ).expanded_string() != csv.format().expanded_string() ) { return NULL; }
+            return new binary_writer( writer );
+        }
+
+        /// record size
+        std::size_t size() const { return m_size; }
+
+        /// write point to buf, buf should have at least size() bytes
+        void write( const velodyne_point& p, char* buf ) const
+        {
+            for( std::size_t i = 0; i < m_fields.size(); ++i )
+            {
+                char* b = buf + m_fields[i].offset;
+                switch( m_fields[i].type )
+                {
+                    case field::t: { comma::int64 t = ( p.timestamp - boost::posix_time::ptime( snark::timing::epoch ) ).total_microseconds(); ::memcpy( b, &t, sizeof( t ) ); break; }
+                    case field::id: ::memcpy( b, &p.id, sizeof( p.id ) ); break;
+                    case field::intensity: ::memcpy( b, &p.intensity, sizeof( p.intensity ) ); break;
+                    case field::scan: ::memcpy( b, &p.scan, sizeof( p.scan ) ); break;
+                    case field::valid: *b = p.valid; break;
+                    case field::first_x: ::memcpy( b, &p.ray.first.x(), sizeof( double ) ); break;
+                    case field::first_y: ::memcpy( b, &p.ray.first.y(), sizeof( double ) ); break;
+                    case field::first_z: ::memcpy( b, &p.ray.first.z(), sizeof( double ) ); break;
+                    case field::second_x: ::memcpy( b, &p.ray.second.x(), sizeof( double ) ); break;
+                    case field::second_y: ::memcpy( b, &p.ray.second.y(), sizeof( double ) ); break;
+                    case field::second_z: ::memcpy( b, &p.ray.second.z(), sizeof( double ) ); break;
+                    case field::azimuth: ::memcpy( b, &p.azimuth, sizeof( double ) ); break;
+                    case field::range: ::memcpy( b, &p.range, sizeof( double ) ); break;
+                    case field::none: ::memset( b, 0, sizeof( double ) ); break;
+                }
+            }
+        }
+
+    private:
+        struct field
+        {
+            enum types { t, id, intensity, scan, valid, first_x, first_y, first_z, second_x, second_y, second_z, azimuth, range, none };
+            types type;
+            std::size_t offset;
+        };
+        std::vector< field > m_fields;
+        std::size_t m_size;
+        binary_writer() : m_size( 0 ) {}
+};
+
+static boost::scoped_ptr< binary_writer > binary;
+
+template < typename S >
+inline static void run( velodyne_stream< S >& v, const binary_writer& writer, bool flush, double min_range )
+{
+    comma::signal_flag is_shutdown;
+    std::vector< char > buf( writer.size() * velodyne::soa_points::size * 16 );
+    std::size_t size = 0;
+    while( !is_shutdown && v.read() )
+    {
+        if( v.point().range <= min_range ) { continue; }
+        writer.write( v.point(), &buf[size] );
+        size += writer.size();
+        if( size < buf.size() && !flush ) { continue; }
+        std::cout.write( &buf[0], size );
+        if( flush ) { std::cout.flush(); }
+        size = 0;
+    }
+    std::cout.write( &buf[0], size );
+    std::cout.flush();
+    if( is_shutdown ) { std::cerr << "velodyne-to-csv: interrupted by signal" << std::endl; }
+    else { std::cerr << "velodyne-to-csv: done, no more data" << std::endl; }
+}
+
 template < typename S >
 inline static void run( velodyne_stream< S >& v, const comma::csv::options& csv, double min_range )
 {
+    v.set_deskew( deskew.get() );
+    if( binary ) { run( v, *binary, csv.flush, min_range ); return; }
     comma::signal_flag isShutdown;
     comma::csv::output_stream< velodyne_point > ostream( std::cout, csv );
     //Profilerstart( "velodyne-to-csv.prof" );{
@@ -123,6 +287,116 @@ inline static void run( velodyne_stream< S >& v, const comma::csv::options& csv,
     else { std::cerr << "velodyne-to-csv: done, no more data" << std::endl; }
 }
 
+/// packets read in reader thread to be decoded and formatted in one go by one of the pipeline threads
+struct batch
+{
+    struct entry
+    {
+        velodyne::packet packet;
+        boost::posix_time::ptime timestamp;
+        comma::uint32 scan;
+        entry( const velodyne::packet& packet, const boost::posix_time::ptime& timestamp, comma::uint32 scan ) : packet( packet ), timestamp( timestamp ), scan( scan ) {}
+    };
+    std::vector< entry > entries;
+    std::string output;
+};
+
+typedef boost::shared_ptr< batch > batch_ptr;
+
+namespace snark { namespace tbb {
+
+template <> struct bursty_reader_traits< batch_ptr >
+{
+    static bool valid( const batch_ptr& b ) { return bool( b ); }
+};
+
+} } // namespace snark { namespace tbb {
+
+template < typename S >
+static batch_ptr read_batch( velodyne_stream< S >& v, std::size_t size, const comma::signal_flag& is_shutdown )
+{
+    batch_ptr b( new batch );
+    b->entries.reserve( size );
+    while( b->entries.size() < size && !is_shutdown )
+    {
+        const velodyne::packet* packet = v.read_packet();
+        if( packet == NULL ) { break; }
+        b->entries.push_back( batch::entry( *packet, v.timestamp(), v.scan() ) );
+    }
+    return b->entries.empty() ? batch_ptr() : b;
+}
+
+class format_batch
+{
+    public:
+        format_batch( const velodyne::db& db, const velodyne::azimuth_table* table, const velodyne::deskew* deskew, const binary_writer* binary, const comma::csv::options& csv, double min_range, bool output_invalid, bool raw_intensity, bool legacy )
+            : m_db( db ), m_table( table ), m_deskew( deskew ), m_binary( binary ), m_csv( csv ), m_min_range( min_range ), m_output_invalid( output_invalid ), m_raw_intensity( raw_intensity ), m_legacy( legacy )
+        {
+        }
+
+        batch_ptr operator()( batch_ptr b ) const
+        {
+            velodyne_decoder decoder( m_db, m_output_invalid, m_raw_intensity, m_legacy, m_table, m_deskew );
+            if( m_binary )
+            {
+                b->output.resize( b->entries.size() * velodyne::soa_points::size * m_binary->size() );
+                std::size_t size = 0;
+                for( std::size_t i = 0; i < b->entries.size(); ++i )
+                {
+                    decoder.decode( b->entries[i].packet, b->entries[i].timestamp, b->entries[i].scan );
+                    while( decoder.read() ) { if( decoder.point().range > m_min_range ) { m_binary->write( decoder.point(), &b->output[size] ); size += m_binary->size(); } }
+                }
+                b->output.resize( size );
+                std::vector< batch::entry >().swap( b->entries );
+                return b;
+            }
+            std::ostringstream oss;
+            comma::csv::output_stream< velodyne_point > ostream( oss, m_csv );
+            for( std::size_t i = 0; i < b->entries.size(); ++i )
+            {
+                decoder.decode( b->entries[i].packet, b->entries[i].timestamp, b->entries[i].scan );
+                while( decoder.read() ) { if( decoder.point().range > m_min_range ) { ostream.write( decoder.point() ); } }
+            }
+            ostream.flush();
+            b->output = oss.str();
+            std::vector< batch::entry >().swap( b->entries );
+            return b;
+        }
+
+    private:
+        const velodyne::db& m_db;
+        const velodyne::azimuth_table* m_table;
+        const velodyne::deskew* m_deskew;
+        const binary_writer* m_binary;
+        comma::csv::options m_csv;
+        double m_min_range;
+        bool m_output_invalid;
+        bool m_raw_intensity;
+        bool m_legacy;
+};
+
+static void write_batch( batch_ptr b, bool flush )
+{
+    std::cout.write( b->output.data(), b->output.size() );
+    if( flush ) { std::cout.flush(); }
+}
+
+/// read packets in a separate thread, decode and format them in parallel, output in original order
+template < typename S >
+inline static void run( velodyne_stream< S >& v, const comma::csv::options& csv, double min_range, bool output_invalid, bool raw_intensity, bool legacy, unsigned int threads, std::size_t batch_size )
+{
+    comma::signal_flag is_shutdown;
+    snark::tbb::bursty_pipeline< batch_ptr > pipeline( threads );
+    unsigned int capacity = ( threads == 0 ? ::tbb::task_scheduler_init::default_num_threads() : threads ) * 4;
+    snark::tbb::bursty_reader< batch_ptr > reader( boost::bind( &read_batch< S >, boost::ref( v ), batch_size, boost::cref( is_shutdown ) ), 0, capacity );
+    ::tbb::filter_t< batch_ptr, void > filter = ::tbb::make_filter< batch_ptr, batch_ptr >( ::tbb::filter::parallel, format_batch( v.db(), v.table(), deskew.get(), binary.get(), csv, min_range, output_invalid, raw_intensity, legacy ) )
+                                              & ::tbb::make_filter< batch_ptr, void >( ::tbb::filter::serial_in_order, boost::bind( &write_batch, _1, csv.flush ) );
+    pipeline.run( reader, filter );
+    reader.join();
+    if( is_shutdown ) { std::cerr << "velodyne-to-csv: interrupted by signal" << std::endl; }
+    else { std::cerr << "velodyne-to-csv: done, no more data" << std::endl; }
+}
+
 static std::string fields_( const std::string& s ) // parsing fields, quick and dirty
 {
     if( s == "" ) { return s; }
@@ -187,37 +461,51 @@ int main( int ac, char** av )
         csv.fields = fields;
         csv.full_xpath = true;
         if( options.exists( "--binary,-b" ) ) { csv.format( format ); }
-        options.assert_mutually_exclusive( "--pcap,--thin,--udp-port,--proprietary,-q" );
+        if( !options.exists( "--no-fast-binary" ) ) { binary.reset( binary_writer::make( csv ) ); }
+        options.assert_mutually_exclusive( "--pcap,--pcap-file,--thin,--udp-port,--proprietary,-q" );
         double min_range = options.value( "--min-range", 0.0 );
         bool raw_intensity=options.exists( "--raw-intensity" );
         bool legacy = options.exists( "--legacy");
         //use old algorithm for old database
         if (!legacy && db.version == 0){legacy=true; std::cerr<<"using legacy option for old database"<<std::endl;}
         if(legacy && db.version > 0){std::cerr<<"using new calibration with legacy option"<<std::endl;}
+        bool lookup_table = options.exists( "--lookup-table" );
+        boost::optional< unsigned int > threads = options.optional< unsigned int >( "--threads" );
+        std::size_t batch_size = options.value< std::size_t >( "--batch-size", 64 );
+        if( batch_size == 0 ) { COMMA_THROW( comma::exception, "expected positive batch size, got 0" ); }
+        if( lookup_table && legacy ) { std::cerr << "velodyne-to-csv: --lookup-table has no effect in legacy mode" << std::endl; }
+        if( options.exists( "--nav" ) ) { deskew.reset( make_deskew( options.value< std::string >( "--nav" ) ) ); }
         if( options.exists( "--pcap" ) )
         {
-            velodyne_stream< snark::pcap_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy );
-            run( v, csv, min_range );
+            velodyne_stream< snark::pcap_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
+        }
+        else if( options.exists( "--pcap-file" ) )
+        {
+            snark::pcap_mmap_reader::config config( options.value< std::string >( "--pcap-file" ), options.value< unsigned short >( "--pcap-port", 2368 ), options.value< std::string >( "--pcap-index", "" ) );
+            velodyne_stream< snark::pcap_mmap_reader > v( config, db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
         }
         else if( options.exists( "--thin" ) )
         {
-            velodyne_stream< snark::thin_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy );
-            run( v, csv, min_range );
+            velodyne_stream< snark::thin_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
         }
         else if( options.exists( "--udp-port" ) )
         {
-            velodyne_stream< snark::udp_reader > v( options.value< unsigned short >( "--udp-port" ), db, outputInvalidpoints, from, to, raw_intensity, legacy );
-            run( v, csv, min_range );
+            snark::udp_reader::config config( options.value< unsigned short >( "--udp-port" ), options.value< unsigned int >( "--udp-receive-buffer", 0 ) );
+            velodyne_stream< snark::udp_reader > v( config, db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
         }
         else if( options.exists( "--proprietary,-q" ) )
         {
-            velodyne_stream< snark::proprietary_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy );
-            run( v, csv, min_range );
+            velodyne_stream< snark::proprietary_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
         }
         else
         {
-            velodyne_stream< snark::stream_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy );
-            run( v, csv, min_range );
+            velodyne_stream< snark::stream_reader > v( db, outputInvalidpoints, from, to, raw_intensity, legacy, lookup_table );
+            if( threads ) { run( v, csv, min_range, outputInvalidpoints, raw_intensity, legacy, *threads, batch_size ); } else { run( v, csv, min_range ); }
         }
         return 0;
     }
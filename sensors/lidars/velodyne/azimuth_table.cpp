@@ -0,0 +1,70 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cmath>
+#include "azimuth_table.h"
+
+namespace snark {  namespace velodyne {
+
+azimuth_table::azimuth_table( const velodyne::db& db )
+    : m_db( db )
+    , m_sin( db.lasers.size() * steps )
+    , m_cos( db.lasers.size() * steps )
+{
+    for( unsigned int step = 0; step < steps; ++step )
+    {
+        db::laser_data::angle a( double( step ) / 100 );
+        for( unsigned int laser = 0, i = step; laser < db.lasers.size(); ++laser, i += steps )
+        {
+            const db::laser_data::angle& rotational = db.lasers[laser].correction_angles.rotational;
+            m_sin[i] = a.sin * rotational.cos + a.cos * rotational.sin;
+            m_cos[i] = a.cos * rotational.cos - a.sin * rotational.sin;
+        }
+    }
+}
+
+unsigned int azimuth_table::step( double azimuth )
+{
+    int s = static_cast< int >( std::floor( azimuth * 100 + 0.5 ) ) % steps;
+    return s < 0 ? s + steps : s;
+}
+
+std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > azimuth_table::ray( unsigned int laser, double range, unsigned int step ) const
+{
+    std::size_t i = laser * steps + step;
+    return m_db.lasers[laser].corrected_ray( range, m_sin[i], m_cos[i] );
+}
+
+::Eigen::Vector3d azimuth_table::point( unsigned int laser, double range, unsigned int step ) const
+{
+    return ray( laser, range, step ).second;
+}
+
+} } // namespace snark {  namespace velodyne {
@@ -0,0 +1,73 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_AZIMUTH_TABLE_H_
+#define SNARK_SENSORS_VELODYNE_AZIMUTH_TABLE_H_
+
+#include <vector>
+#include "db.h"
+
+namespace snark {  namespace velodyne {
+
+/// velodyne db view with sin and cos of azimuth plus rotational correction
+/// precomputed for each laser and each azimuth step of 0.01 degree,
+/// the resolution of rotation in velodyne packets
+/// @note sin and cos are stored as float, i.e. the table takes about 18MB
+///       and point coordinates differ from db::laser_data::ray() by a few micrometres
+class azimuth_table
+{
+    public:
+        /// number of azimuth steps in full revolution
+        enum { steps = 36000 };
+
+        /// build table for given db; db should outlive the table
+        azimuth_table( const velodyne::db& db );
+
+        /// return azimuth step for given azimuth in degrees, rounded to the nearest step
+        static unsigned int step( double azimuth );
+
+        /// same as db().lasers[laser].ray( range, step / 100.0 ), but without trigonometry
+        std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > ray( unsigned int laser, double range, unsigned int step ) const;
+
+        /// same as db().lasers[laser].point( range, step / 100.0 ), but without trigonometry
+        ::Eigen::Vector3d point( unsigned int laser, double range, unsigned int step ) const;
+
+        /// return db
+        const velodyne::db& db() const { return m_db; }
+
+    private:
+        const velodyne::db& m_db;
+        std::vector< float > m_sin;
+        std::vector< float > m_cos;
+};
+
+} } // namespace snark {  namespace velodyne {
+
+#endif // SNARK_SENSORS_VELODYNE_AZIMUTH_TABLE_H_
@@ -103,9 +103,11 @@ double db::laser_data::azimuth( double azimuth ) const
 ///       Naveed Muhammad and Simon Lacroix, with the coordinate system changes
 std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > db::laser_data::ray( double distance, double a ) const
 {
-    angle angle( a );
-    double distance_original = distance; // why is DistLSB factor missing?
-    distance += distance_correction;
+    return ray( distance, angle( a ) );
+}
+
+std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > db::laser_data::ray( double distance, const angle& angle ) const
+{
     // add 90 degrees for our system of coordinates
     //double angleSin( angle.cos ); // could also be added to the nav to velodyne offset
     //double angleCos( -angle.sin );
@@ -114,6 +116,13 @@ std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > db::laser_data::ray( double di
 
     double correctedangleCos( angleCos * correction_angles.rotational.cos - angleSin * correction_angles.rotational.sin );
     double correctedangleSin( angleSin * correction_angles.rotational.cos + angleCos * correction_angles.rotational.sin );
+    return corrected_ray( distance, correctedangleSin, correctedangleCos );
+}
+
+std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > db::laser_data::corrected_ray( double distance, double correctedangleSin, double correctedangleCos ) const
+{
+    double distance_original = distance; // why is DistLSB factor missing?
+    distance += distance_correction;
     std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > ray;
     // laser position
     double vertical_offsetXYProjection( vertical_offset * correction_angles.vertical.sin );
@@ -94,6 +94,12 @@ struct db
 
         std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > ray( double range, double angle ) const;
 
+        /// same as ray( range, angle ), but with sin and cos of azimuth already computed
+        std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > ray( double range, const angle& azimuth ) const;
+
+        /// same as ray( range, angle ), but with sin and cos of azimuth plus rotational correction already computed
+        std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > corrected_ray( double range, double corrected_sin, double corrected_cos ) const;
+
         ::Eigen::Vector3d point( double range, double angle ) const;
 
         double range( double range ) const;
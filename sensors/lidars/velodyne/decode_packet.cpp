@@ -0,0 +1,119 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <comma/math/compare.h>
+#include "impl/get_laser_return.h"
+#include "azimuth_table.h"
+#include "decode_packet.h"
+
+namespace snark {  namespace velodyne {
+
+class time_offsets_table
+{
+    public:
+        time_offsets_table( bool legacy )
+        {
+            for( unsigned int i = 0; i < m_offsets.size(); ++i ) { m_offsets[i] = impl::time_offset( i / 32, i % 32, legacy ).total_microseconds(); }
+        }
+
+        comma::int64 operator[]( std::size_t i ) const { return m_offsets[i]; }
+
+    private:
+        boost::array< comma::int64, soa_points::size > m_offsets;
+};
+
+static const time_offsets_table& time_offsets( bool legacy )
+{
+    // initialised on first use, since timing constants are defined in another translation unit
+    static const time_offsets_table table( false );
+    static const time_offsets_table legacy_table( true );
+    return legacy ? legacy_table : table;
+}
+
+static void decode_packet_( const packet& packet, const db& db, const azimuth_table* table, soa_points& points, bool legacy )
+{
+    const time_offsets_table& offsets = time_offsets( legacy );
+    boost::array< double, 64 > distance_corrections;
+    for( unsigned int i = 0; i < distance_corrections.size(); ++i ) { distance_corrections[i] = db.lasers[i].distance_correction; }
+    for( unsigned int block = 0, i = 0; block < packet.blocks.size(); ++block )
+    {
+        comma::uint32 first = ( block & 0x1 ) ? 32 : 0;
+        const packet::laser_block& b = packet.blocks[block];
+        for( unsigned int laser = 0; laser < b.lasers.size(); ++laser, ++i )
+        {
+            points.t[i] = offsets[i];
+            points.id[i] = first + laser;
+            points.intensity[i] = b.lasers[laser].intensity();
+            points.raw_range[i] = double( b.lasers[laser].range() ) / 500;
+        }
+    }
+    for( unsigned int i = 0; i < soa_points::size; i += 64 )
+    {
+        for( unsigned int j = 0; j < 64; ++j ) { points.range[ i + j ] = points.raw_range[ i + j ] + distance_corrections[j]; }
+    }
+    for( unsigned int i = 0; i < soa_points::size; ++i ) { points.valid[i] = !comma::math::equal( points.raw_range[i], 0 ); }
+    double angular_speed = legacy ? impl::angular_speed( packet ) : 0;
+    for( unsigned int block = 0, i = 0; block < packet.blocks.size(); ++block )
+    {
+        db::laser_data::angle azimuth;
+        unsigned int step = 0;
+        if( !legacy ) // the same for all lasers in block
+        {
+            double a = impl::azimuth( packet, block, 0, angular_speed, false );
+            if( table ) { azimuth.value = a; step = azimuth_table::step( a ); }
+            else { azimuth = db::laser_data::angle( a ); }
+        }
+        for( unsigned int laser = 0; laser < 32; ++laser, ++i )
+        {
+            const db::laser_data& data = db.lasers[ points.id[i] ];
+            if( legacy ) { azimuth = db::laser_data::angle( impl::azimuth( packet, block, laser, angular_speed, true ) ); }
+            const std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d >& ray = table && !legacy ? table->ray( points.id[i], points.raw_range[i], step ) : data.ray( points.raw_range[i], azimuth );
+            points.laser_x[i] = ray.first.x();
+            points.laser_y[i] = ray.first.y();
+            points.laser_z[i] = ray.first.z();
+            points.x[i] = ray.second.x();
+            points.y[i] = ray.second.y();
+            points.z[i] = ray.second.z();
+            points.azimuth[i] = data.azimuth( azimuth.value );
+        }
+    }
+}
+
+void decode_packet( const packet& packet, const db& db, soa_points& points, bool legacy )
+{
+    decode_packet_( packet, db, NULL, points, legacy );
+}
+
+void decode_packet( const packet& packet, const azimuth_table& table, soa_points& points, bool legacy )
+{
+    decode_packet_( packet, table.db(), &table, points, legacy );
+}
+
+} } // namespace snark {  namespace velodyne {
@@ -0,0 +1,98 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_DECODE_PACKET_H_
+#define SNARK_SENSORS_VELODYNE_DECODE_PACKET_H_
+
+#include <boost/array.hpp>
+#include <comma/base/types.h>
+#include "azimuth_table.h"
+#include "db.h"
+#include "packet.h"
+
+namespace snark {  namespace velodyne {
+
+/// laser returns of a whole packet as structure of arrays
+/// @note returns are stored block by block, i.e. i-th element is laser i % 32 of block i / 32;
+///       use ordered() to iterate in the same order as velodyne::stream::read()
+struct soa_points
+{
+    enum { size = 12 * 32 };
+
+    /// return index of n-th laser return in the order of velodyne::stream::read(),
+    /// i.e. upper and lower laser of the same firing next to each other
+    static std::size_t ordered( std::size_t n ) { return ( ( n >> 6 ) * 2 + ( n & 0x1 ) ) * 32 + ( ( n & 63 ) >> 1 ); }
+
+    /// time offset from the packet timestamp in microseconds
+    boost::array< comma::int64, size > t;
+
+    /// laser id
+    boost::array< comma::uint32, size > id;
+
+    /// intensity as in the packet
+    boost::array< unsigned char, size > intensity;
+
+    /// range in metres, without range correction
+    boost::array< double, size > raw_range;
+
+    /// range in metres, with range correction
+    boost::array< double, size > range;
+
+    /// azimuth in degrees, with angle correction
+    boost::array< double, size > azimuth;
+
+    /// laser position, i.e. ray origin
+    boost::array< double, size > laser_x;
+    boost::array< double, size > laser_y;
+    boost::array< double, size > laser_z;
+
+    /// laser return position
+    boost::array< double, size > x;
+    boost::array< double, size > y;
+    boost::array< double, size > z;
+
+    /// true, if range is not zero
+    boost::array< bool, size > valid;
+};
+
+/// decode all laser returns of a packet in one go
+/// @note gives the same result as impl::get_laser_return() followed by db
+///       corrections per laser return, but computes trigonometry only once
+///       per laser block and takes time offsets from a precomputed table
+void decode_packet( const packet& packet, const db& db, soa_points& points, bool legacy = false );
+
+/// same as above, but taking sin and cos of corrected azimuth from lookup table
+/// @note in legacy mode azimuth is not a multiple of 0.01 degree, thus
+///       the lookup table is not used and the result is the same as above
+void decode_packet( const packet& packet, const azimuth_table& table, soa_points& points, bool legacy = false );
+
+} } // namespace snark {  namespace velodyne {
+
+#endif // SNARK_SENSORS_VELODYNE_DECODE_PACKET_H_
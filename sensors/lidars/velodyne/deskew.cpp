@@ -0,0 +1,70 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/exception.h>
+#include <snark/math/rotation_matrix.h>
+#include "deskew.h"
+
+namespace snark {  namespace velodyne {
+
+static bool earlier( const boost::posix_time::ptime& t, const pose& p ) { return t < p.t; }
+
+deskew::deskew( const std::vector< pose >& poses ) : m_poses( poses )
+{
+    if( m_poses.empty() ) { COMMA_THROW( comma::exception, "expected poses, got none" ); }
+    for( std::size_t i = 1; i < m_poses.size(); ++i )
+    {
+        if( m_poses[i].t < m_poses[ i - 1 ].t ) { COMMA_THROW( comma::exception, "expected poses sorted by time; got " << boost::posix_time::to_iso_string( m_poses[i].t ) << " after " << boost::posix_time::to_iso_string( m_poses[ i - 1 ].t ) ); }
+    }
+}
+
+bool deskew::transform( const boost::posix_time::ptime& t, transform_type& m ) const
+{
+    std::vector< pose >::const_iterator it = std::upper_bound( m_poses.begin(), m_poses.end(), t, earlier );
+    if( it == m_poses.begin() ) { return false; }
+    const pose& first = *( it - 1 );
+    ::Eigen::Vector3d coordinates = first.coordinates;
+    ::Eigen::Vector3d orientation = first.orientation;
+    if( first.t != t )
+    {
+        if( it == m_poses.end() ) { return false; }
+        const pose& second = *it;
+        double factor = double( ( t - first.t ).total_microseconds() ) / ( second.t - first.t ).total_microseconds();
+        coordinates = first.coordinates * ( 1 - factor ) + second.coordinates * factor;
+        orientation = first.orientation * ( 1 - factor ) + second.orientation * factor;
+    }
+    m.leftCols< 3 >() = rotation_matrix::rotation( orientation );
+    m.col( 3 ) = coordinates;
+    return true;
+}
+
+} } // namespace snark {  namespace velodyne {
@@ -0,0 +1,108 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_DESKEW_H_
+#define SNARK_SENSORS_VELODYNE_DESKEW_H_
+
+#include <vector>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <Eigen/Core>
+#include <comma/visiting/traits.h>
+
+namespace snark {  namespace velodyne {
+
+/// timestamped sensor pose, e.g. from navigation
+struct pose
+{
+    boost::posix_time::ptime t;
+    ::Eigen::Vector3d coordinates;
+    ::Eigen::Vector3d orientation; // roll, pitch, yaw
+
+    pose() : coordinates( ::Eigen::Vector3d::Zero() ), orientation( ::Eigen::Vector3d::Zero() ) {}
+};
+
+/// sensor poses over time, used to transform points from sensor frame
+/// to the frame of the poses at the time the points were taken
+/// @note poses are interpolated linearly in coordinates and roll, pitch, yaw,
+///       the same way as points-frame does it
+class deskew
+{
+    public:
+        typedef ::Eigen::Matrix< double, 3, 4 > transform_type;
+
+        /// constructor
+        /// @param poses sorted by time
+        deskew( const std::vector< pose >& poses );
+
+        /// compute transform from sensor frame for given time
+        /// @return false, if t is out of time range of the poses
+        bool transform( const boost::posix_time::ptime& t, transform_type& m ) const;
+
+        /// apply transform to a point
+        static ::Eigen::Vector3d apply( const transform_type& m, const ::Eigen::Vector3d& p ) { return m.leftCols< 3 >() * p + m.col( 3 ); }
+
+    private:
+        std::vector< pose > m_poses;
+};
+
+} } // namespace snark {  namespace velodyne {
+
+namespace comma { namespace visiting {
+
+template <> struct traits< snark::velodyne::pose >
+{
+    template < typename Key, class Visitor >
+    static void visit( const Key&, snark::velodyne::pose& p, Visitor& v )
+    {
+        v.apply( "t", p.t );
+        v.apply( "x", p.coordinates.x() );
+        v.apply( "y", p.coordinates.y() );
+        v.apply( "z", p.coordinates.z() );
+        v.apply( "roll", p.orientation.x() );
+        v.apply( "pitch", p.orientation.y() );
+        v.apply( "yaw", p.orientation.z() );
+    }
+
+    template < typename Key, class Visitor >
+    static void visit( const Key&, const snark::velodyne::pose& p, Visitor& v )
+    {
+        v.apply( "t", p.t );
+        v.apply( "x", p.coordinates.x() );
+        v.apply( "y", p.coordinates.y() );
+        v.apply( "z", p.coordinates.z() );
+        v.apply( "roll", p.orientation.x() );
+        v.apply( "pitch", p.orientation.y() );
+        v.apply( "yaw", p.orientation.z() );
+    }
+};
+
+} } // namespace comma { namespace visiting {
+
+#endif // SNARK_SENSORS_VELODYNE_DESKEW_H_
@@ -154,6 +154,23 @@ hdl64_s2_fw_v48::block_time_table hdl64_s2_fw_v48::time_table[block_count]=
     { 48, 46.74, 45.54, 44.34, 42, 40.74, 39.54, 38.34, 36, 34.74, 33.54, 32.34, 30, 28.74, 27.54, 26.34, 24, 22.74, 21.54, 20.34, 18, 16.74, 15.54, 14.34, 12, 10.74, 9.54, 8.34, 6, 4.74, 3.54, 2.34 }, 
 };
 
+boost::posix_time::time_duration time_offset( unsigned int block, unsigned int laser, bool legacy )
+{
+    return legacy ? time_offset( block, laser ) : hdl64_s2_fw_v48::time_offset( block, laser );
+}
+
+double azimuth( const packet& packet, unsigned int block, unsigned int laser, double angularSpeed, bool legacy )
+{
+    return legacy ? azimuth( packet, block, laser, angularSpeed ) : hdl64_s2_fw_v48::azimuth( packet, block );
+}
+
+double angular_speed( const packet& packet )
+{
+    double da = double( packet.blocks[0].rotation() - packet.blocks[11].rotation() ) / 100;
+    double dt = double( ( time_offset( 0, 0 ) - time_offset( 11, 0 ) ).total_microseconds() ) / 1e6;
+    return da / dt;
+}
+
 static bool is_upper( unsigned int block ) { return ( block & 0x1 ) == 0; }
 
 laser_return get_laser_return( const packet& packet
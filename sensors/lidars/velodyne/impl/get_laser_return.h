@@ -47,6 +47,15 @@ laser_return get_laser_return( const packet& packet
 
 boost::posix_time::time_duration time_offset( unsigned int block, unsigned int laser );
 
+/// time offset of the laser return from the packet timestamp for the legacy or current timing table
+boost::posix_time::time_duration time_offset( unsigned int block, unsigned int laser, bool legacy );
+
+/// laser return azimuth in degrees, without angle correction
+double azimuth( const packet& packet, unsigned int block, unsigned int laser, double angularSpeed, bool legacy );
+
+/// angular speed in degrees per second estimated from the rotation of the first and last block
+double angular_speed( const packet& packet );
+
 } } } // namespace snark {  namespace velodyne { namespace impl {
 
 #endif // SNARK_SENSORS_VELODYNE_IMPL_GETFROMLASERRETURN_H_
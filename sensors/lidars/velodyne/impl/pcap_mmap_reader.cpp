@@ -0,0 +1,330 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cstring>
+#include <fstream>
+#include <comma/base/exception.h>
+#include <snark/timing/time.h>
+#include "../packet.h"
+#include "../scan_tick.h"
+#include "pcap_mmap_reader.h"
+
+namespace snark {
+
+static const std::size_t pcap_header_size = 24;
+static const std::size_t pcap_record_header_size = 16;
+
+static comma::uint16 big_endian_uint16( const char* p ) { return ( comma::uint16( static_cast< unsigned char >( p[0] ) ) << 8 ) | static_cast< unsigned char >( p[1] ); }
+
+static comma::uint16 swap( comma::uint16 v ) { return ( v >> 8 ) | ( v << 8 ); }
+
+static comma::uint32 swap( comma::uint32 v ) { return ( v >> 24 ) | ( ( v >> 8 ) & 0xff00 ) | ( ( v << 8 ) & 0xff0000 ) | ( v << 24 ); }
+
+pcap_mmap_reader::pcap_mmap_reader( const config& c )
+    : m_config( c )
+    , m_fd( -1 )
+    , m_begin( NULL )
+    , m_file_size( 0 )
+    , m_offset( 0 )
+    , m_size( 0 )
+    , m_format( pcap )
+    , m_swapped( false )
+    , m_nanoseconds( false )
+    , m_link_type( 0 )
+    , m_indexed( false )
+{
+    #ifdef WIN32
+    COMMA_THROW( comma::exception, "memory-mapped pcap reader: not implemented on windows" );
+    #else
+    m_fd = ::open( c.filename.c_str(), O_RDONLY );
+    if( m_fd < 0 ) { COMMA_THROW( comma::exception, "failed to open pcap file " << c.filename ); }
+    struct stat s;
+    if( ::fstat( m_fd, &s ) != 0 ) { ::close( m_fd ); COMMA_THROW( comma::exception, "failed to get size of pcap file " << c.filename ); }
+    m_file_size = s.st_size;
+    if( m_file_size < pcap_header_size ) { ::close( m_fd ); COMMA_THROW( comma::exception, "expected pcap file, got file of " << m_file_size << " bytes: " << c.filename ); }
+    void* p = ::mmap( NULL, m_file_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+    if( p == MAP_FAILED ) { ::close( m_fd ); COMMA_THROW( comma::exception, "failed to map pcap file " << c.filename ); }
+    m_begin = static_cast< const char* >( p );
+    ::madvise( p, m_file_size, MADV_SEQUENTIAL );
+    comma::uint32 magic;
+    ::memcpy( &magic, m_begin, sizeof( magic ) );
+    switch( magic )
+    {
+        case 0xa1b2c3d4: break;
+        case 0xd4c3b2a1: m_swapped = true; break;
+        case 0xa1b23c4d: m_nanoseconds = true; break;
+        case 0x4d3cb2a1: m_swapped = true; m_nanoseconds = true; break;
+        case 0x0a0d0d0a: m_format = pcapng; break;
+        default: close(); COMMA_THROW( comma::exception, "expected pcap or pcapng file, got unknown magic number " << magic << " in " << c.filename );
+    }
+    if( m_format == pcap )
+    {
+        m_link_type = uint32( m_begin + 20 ) & 0xffff; // upper bits may hold fcs flags
+        m_offset = pcap_header_size;
+    }
+    else // read section and interface descriptions preceding the first packet, as seek_scan() may skip them
+    {
+        std::size_t length;
+        comma::uint32 link_type;
+        next_record( length, link_type );
+        m_offset = 0;
+    }
+    #endif
+}
+
+pcap_mmap_reader::~pcap_mmap_reader() { close(); }
+
+void pcap_mmap_reader::close()
+{
+    #ifndef WIN32
+    if( m_begin ) { ::munmap( const_cast< char* >( m_begin ), m_file_size ); m_begin = NULL; }
+    if( m_fd >= 0 ) { ::close( m_fd ); m_fd = -1; }
+    #endif
+}
+
+bool pcap_mmap_reader::eof() const { return m_begin == NULL || m_offset >= m_file_size; }
+
+comma::uint16 pcap_mmap_reader::uint16( const char* p ) const
+{
+    comma::uint16 v;
+    ::memcpy( &v, p, sizeof( v ) );
+    return m_swapped ? swap( v ) : v;
+}
+
+comma::uint32 pcap_mmap_reader::uint32( const char* p ) const
+{
+    comma::uint32 v;
+    ::memcpy( &v, p, sizeof( v ) );
+    return m_swapped ? swap( v ) : v;
+}
+
+const char* pcap_mmap_reader::read()
+{
+    std::size_t length;
+    comma::uint32 link_type;
+    for( const char* frame = next_record( length, link_type ); frame; frame = next_record( length, link_type ) )
+    {
+        const char* payload = udp_payload( frame, length, link_type, m_size );
+        if( payload ) { return payload; }
+    }
+    return NULL;
+}
+
+/// return pointer to the next captured frame and advance; NULL, if end of file
+const char* pcap_mmap_reader::next_record( std::size_t& length, comma::uint32& link_type )
+{
+    while( !eof() )
+    {
+        const char* p = m_begin + m_offset;
+        std::size_t left = m_file_size - m_offset;
+        if( m_format == pcap )
+        {
+            if( left < pcap_record_header_size ) { m_offset = m_file_size; return NULL; } // truncated file
+            length = uint32( p + 8 );
+            if( left - pcap_record_header_size < length ) { m_offset = m_file_size; return NULL; }
+            comma::uint32 fraction = uint32( p + 4 );
+            m_timestamp = boost::posix_time::ptime( snark::timing::epoch, boost::posix_time::seconds( uint32( p ) ) + boost::posix_time::microseconds( m_nanoseconds ? fraction / 1000 : fraction ) );
+            m_offset += pcap_record_header_size + length;
+            link_type = m_link_type;
+            return p + pcap_record_header_size;
+        }
+        if( left < 12 ) { m_offset = m_file_size; return NULL; }
+        comma::uint32 type;
+        ::memcpy( &type, p, sizeof( type ) ); // section header block type is the same in both byte orders
+        if( type == 0x0a0d0d0a )
+        {
+            comma::uint32 byte_order_magic;
+            ::memcpy( &byte_order_magic, p + 8, sizeof( byte_order_magic ) );
+            if( byte_order_magic == 0x1a2b3c4d ) { m_swapped = false; }
+            else if( byte_order_magic == 0x4d3c2b1a ) { m_swapped = true; }
+            else { COMMA_THROW( comma::exception, "pcapng: expected byte order magic, got " << byte_order_magic << " in " << m_config.filename ); }
+            m_interfaces.clear();
+        }
+        else
+        {
+            type = uint32( p );
+        }
+        std::size_t block_length = uint32( p + 4 );
+        if( block_length < 12 || block_length > left ) { m_offset = m_file_size; return NULL; } // truncated or corrupted file
+        const char* body = p + 8;
+        std::size_t body_length = block_length - 12;
+        m_offset += block_length;
+        switch( type )
+        {
+            case 1: // interface description block
+            {
+                if( body_length < 8 ) { break; }
+                interface i( uint16( body ) );
+                for( std::size_t o = 8; o + 4 <= body_length; )
+                {
+                    comma::uint16 code = uint16( body + o );
+                    comma::uint16 size = uint16( body + o + 2 );
+                    if( code == 0 ) { break; }
+                    if( code == 9 && size == 1 && o + 5 <= body_length ) // if_tsresol
+                    {
+                        unsigned char r = body[ o + 4 ];
+                        i.units_per_second = 1;
+                        if( r & 0x80 ) { i.units_per_second <<= ( r & 0x7f ); }
+                        else { for( unsigned int k = 0; k < r; ++k ) { i.units_per_second *= 10; } }
+                    }
+                    o += 4 + ( ( size + 3 ) & ~3 );
+                }
+                m_interfaces.push_back( i );
+                break;
+            }
+            case 3: // simple packet block: no timestamp, interface 0
+            {
+                if( body_length < 4 || m_interfaces.empty() ) { break; }
+                length = std::min< std::size_t >( uint32( body ), body_length - 4 );
+                link_type = m_interfaces[0].link_type;
+                return body + 4;
+            }
+            case 6: // enhanced packet block
+            {
+                if( body_length < 20 ) { break; }
+                comma::uint32 id = uint32( body );
+                if( id >= m_interfaces.size() ) { break; }
+                const interface& i = m_interfaces[id];
+                comma::uint64 t = ( comma::uint64( uint32( body + 4 ) ) << 32 ) | uint32( body + 8 );
+                length = std::min< std::size_t >( uint32( body + 12 ), body_length - 20 );
+                link_type = i.link_type;
+                m_timestamp = boost::posix_time::ptime( snark::timing::epoch, boost::posix_time::seconds( long( t / i.units_per_second ) )
+                                                                            + boost::posix_time::microseconds( comma::int64( double( t % i.units_per_second ) * 1000000 / i.units_per_second ) ) );
+                return body + 20;
+            }
+            default:
+                break;
+        }
+    }
+    return NULL;
+}
+
+/// return udp payload of ipv4 packet to the configured port, NULL for anything else
+const char* pcap_mmap_reader::udp_payload( const char* frame, std::size_t length, comma::uint32 link_type, std::size_t& size ) const
+{
+    std::size_t offset;
+    comma::uint16 ethertype;
+    switch( link_type )
+    {
+        case 1: // ethernet
+            if( length < 14 ) { return NULL; }
+            ethertype = big_endian_uint16( frame + 12 );
+            offset = 14;
+            while( ethertype == 0x8100 || ethertype == 0x88a8 ) // vlan tags
+            {
+                if( length < offset + 4 ) { return NULL; }
+                ethertype = big_endian_uint16( frame + offset + 2 );
+                offset += 4;
+            }
+            break;
+        case 113: // linux cooked capture
+            if( length < 16 ) { return NULL; }
+            ethertype = big_endian_uint16( frame + 14 );
+            offset = 16;
+            break;
+        case 12: // raw ip
+        case 101:
+        case 228:
+            ethertype = 0x0800;
+            offset = 0;
+            break;
+        default:
+            return NULL;
+    }
+    if( ethertype != 0x0800 || length < offset + 20 ) { return NULL; }
+    const char* ip = frame + offset;
+    if( ( static_cast< unsigned char >( ip[0] ) >> 4 ) != 4 || ip[9] != 17 ) { return NULL; } // not ipv4 or not udp
+    if( big_endian_uint16( ip + 6 ) & 0x3fff ) { return NULL; } // fragmented
+    std::size_t ip_header_size = ( ip[0] & 0x0f ) * 4;
+    if( length < offset + ip_header_size + 8 ) { return NULL; }
+    const char* udp = ip + ip_header_size;
+    if( m_config.port != 0 && big_endian_uint16( udp + 2 ) != m_config.port ) { return NULL; }
+    std::size_t udp_size = big_endian_uint16( udp + 4 );
+    if( udp_size < 8 ) { return NULL; }
+    size = std::min( udp_size - 8, length - offset - ip_header_size - 8 );
+    return udp + 8;
+}
+
+unsigned int pcap_mmap_reader::seek_scan( unsigned int scan )
+{
+    if( !m_indexed )
+    {
+        if( !load_index() ) { build_index(); save_index(); }
+        m_indexed = true;
+    }
+    if( scan <= 1 ) { m_offset = m_format == pcap ? pcap_header_size : 0; return 0; }
+    if( scan > m_scans.size() ) { m_offset = m_file_size; return m_scans.size(); }
+    m_offset = m_scans[ scan - 1 ];
+    return scan - 1;
+}
+
+void pcap_mmap_reader::build_index()
+{
+    m_scans.clear();
+    m_offset = m_format == pcap ? pcap_header_size : 0;
+    velodyne::scan_tick tick;
+    std::size_t offset = m_offset;
+    for( const char* p = read(); p; offset = m_offset, p = read() )
+    {
+        if( m_size != velodyne::packet::size ) { continue; }
+        if( tick.is_new_scan( *reinterpret_cast< const velodyne::packet* >( p ) ) ) { m_scans.push_back( offset ); }
+    }
+}
+
+bool pcap_mmap_reader::load_index()
+{
+    if( m_config.index.empty() ) { return false; }
+    std::ifstream ifs( m_config.index.c_str(), std::ios::binary );
+    if( !ifs.good() ) { return false; }
+    comma::uint64 header[3]; // file size, port, number of scans
+    if( !ifs.read( reinterpret_cast< char* >( header ), sizeof( header ) ) ) { return false; }
+    if( header[0] != m_file_size || header[1] != m_config.port ) { return false; } // index of another file or port
+    m_scans.resize( header[2] );
+    if( m_scans.empty() ) { return true; }
+    return bool( ifs.read( reinterpret_cast< char* >( &m_scans[0] ), m_scans.size() * sizeof( comma::uint64 ) ) );
+}
+
+void pcap_mmap_reader::save_index() const
+{
+    if( m_config.index.empty() ) { return; }
+    std::ofstream ofs( m_config.index.c_str(), std::ios::binary );
+    if( !ofs.good() ) { COMMA_THROW( comma::exception, "failed to open \"" << m_config.index << "\" for writing" ); }
+    comma::uint64 header[3] = { m_file_size, m_config.port, m_scans.size() };
+    ofs.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+    if( !m_scans.empty() ) { ofs.write( reinterpret_cast< const char* >( &m_scans[0] ), m_scans.size() * sizeof( comma::uint64 ) ); }
+}
+
+}
@@ -0,0 +1,126 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_PCAP_MMAP_READER_H_
+#define SNARK_SENSORS_VELODYNE_PCAP_MMAP_READER_H_
+
+#ifndef WIN32
+#include <stdlib.h>
+#endif
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <comma/base/types.h>
+
+namespace snark {
+
+/// pcap and pcapng file reader that memory-maps the file and returns
+/// pointers to udp payloads of given port straight into the mapping
+/// @note supports ethernet, linux cooked and raw ip link types, ipv4 only
+class pcap_mmap_reader : public boost::noncopyable
+{
+    public:
+        struct config
+        {
+            /// pcap or pcapng file name
+            std::string filename;
+
+            /// udp destination port of velodyne data packets; 0: any port
+            unsigned short port;
+
+            /// scan index file name; if empty, index is built in memory on first seek
+            std::string index;
+
+            config( const std::string& filename = "", unsigned short port = 2368, const std::string& index = "" ) : filename( filename ), port( port ), index( index ) {}
+        };
+
+        /// constructor, map a file
+        pcap_mmap_reader( const config& c );
+
+        /// destructor, unmap file
+        ~pcap_mmap_reader();
+
+        /// return pointer to udp payload of the next packet; NULL, if end of file
+        const char* read();
+
+        /// return size of the current udp payload
+        std::size_t size() const { return m_size; }
+
+        /// close
+        void close();
+
+        /// return true, if end of file
+        bool eof() const;
+
+        /// return current timestamp
+        boost::posix_time::ptime timestamp() const { return m_timestamp; }
+
+        /// position reader at the beginning of given scan, counting scans
+        /// the same way as velodyne::stream does, i.e. scan 1 starts with the first packet
+        /// @note builds scan index on first call, or loads it from index file, if any
+        /// @return scan number, i.e. number of scan boundaries passed in the file so far
+        unsigned int seek_scan( unsigned int scan );
+
+    private:
+        config m_config;
+        int m_fd;
+        const char* m_begin;
+        std::size_t m_file_size;
+        std::size_t m_offset;
+        std::size_t m_size;
+        boost::posix_time::ptime m_timestamp;
+        enum format_type { pcap, pcapng };
+        format_type m_format;
+        bool m_swapped;
+        bool m_nanoseconds;
+        comma::uint32 m_link_type;
+        struct interface
+        {
+            comma::uint32 link_type;
+            comma::uint64 units_per_second;
+            interface( comma::uint32 link_type = 0, comma::uint64 units_per_second = 1000000 ) : link_type( link_type ), units_per_second( units_per_second ) {}
+        };
+        std::vector< interface > m_interfaces;
+        std::vector< comma::uint64 > m_scans;
+        bool m_indexed;
+
+        comma::uint16 uint16( const char* p ) const;
+        comma::uint32 uint32( const char* p ) const;
+        const char* next_record( std::size_t& length, comma::uint32& link_type );
+        const char* udp_payload( const char* frame, std::size_t length, comma::uint32 link_type, std::size_t& size ) const;
+        void build_index();
+        bool load_index();
+        void save_index() const;
+};
+
+}
+
+#endif // SNARK_SENSORS_VELODYNE_PCAP_MMAP_READER_H_
@@ -34,6 +34,7 @@
 #include <boost/optional.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "../scan_tick.h"
+#include "pcap_mmap_reader.h"
 #include "pcap_reader.h"
 #include "proprietary_reader.h"
 #include "thin_reader.h"
@@ -52,6 +53,10 @@ struct stream_traits
     static void close( S& s ) { s.close(); }
 
     static bool is_new_scan( scan_tick& tick, const S&, const packet& p ) { return tick.is_new_scan( p ); }
+
+    /// position stream at the beginning of given scan, if supported
+    /// @return number of scans passed so far, none if seek is not supported
+    static boost::optional< unsigned int > seek_scan( S&, unsigned int ) { return boost::none; }
 };
 
 template <>
@@ -64,6 +69,8 @@ struct stream_traits< proprietary_reader >
     static void close( proprietary_reader& s ) { s.close(); }
 
     static bool is_new_scan( scan_tick& tick, const proprietary_reader&, const packet& p ) { return tick.is_new_scan( p ); }
+
+    static boost::optional< unsigned int > seek_scan( proprietary_reader&, unsigned int ) { return boost::none; }
 };
 
 template <>
@@ -81,6 +88,26 @@ struct stream_traits< pcap_reader >
     static void close( pcap_reader& s ) { s.close(); }
 
     static bool is_new_scan( scan_tick& tick, const pcap_reader&, const packet& p ) { return tick.is_new_scan( p ); }
+
+    static boost::optional< unsigned int > seek_scan( pcap_reader&, unsigned int ) { return boost::none; }
+};
+
+template <>
+struct stream_traits< pcap_mmap_reader >
+{
+    static const char* read( pcap_mmap_reader& s, std::size_t size )
+    {
+        for( const char* r = s.read(); r; r = s.read() ) { if( s.size() == size ) { return r; } } // skip e.g. truncated packets
+        return NULL;
+    }
+
+    static boost::posix_time::ptime timestamp( const pcap_mmap_reader& s ) { return s.timestamp(); }
+
+    static void close( pcap_mmap_reader& s ) { s.close(); }
+
+    static bool is_new_scan( scan_tick& tick, const pcap_mmap_reader&, const packet& p ) { return tick.is_new_scan( p ); }
+
+    static boost::optional< unsigned int > seek_scan( pcap_mmap_reader& s, unsigned int scan ) { return s.seek_scan( scan ); }
 };
 
 template <> struct stream_traits< thin_reader >
@@ -94,6 +121,8 @@ template <> struct stream_traits< thin_reader >
     static void close( thin_reader& s ) { s.close(); }
 
     static bool is_new_scan( const scan_tick&, thin_reader& r, const packet& ) { return r.is_new_scan(); }
+
+    static boost::optional< unsigned int > seek_scan( thin_reader&, unsigned int ) { return boost::none; }
 };
 
 } } } // namespace snark {  namespace velodyne { namespace impl {
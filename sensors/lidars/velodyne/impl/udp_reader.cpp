@@ -28,7 +28,11 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#ifdef __linux__
+#include <errno.h>
+#endif
 #include <comma/base/exception.h>
+#include <snark/timing/time.h>
 #include "udp_reader.h"
 
 namespace snark { 
@@ -36,17 +40,88 @@ namespace snark {
 udp_reader::udp_reader( unsigned short port )
     : socket_( service_ )
 {
+    init_( config( port ) );
+}
+
+udp_reader::udp_reader( const config& c )
+    : socket_( service_ )
+{
+    init_( c );
+}
+
+void udp_reader::init_( const config& c )
+{
+    unsigned short port = c.port;
     socket_.open( boost::asio::ip::udp::v4() );
     boost::system::error_code error;
     socket_.set_option( boost::asio::ip::udp::socket::broadcast( true ), error );
     if( error ) { COMMA_THROW( comma::exception, "failed to set broadcast option on port " << port ); }
     socket_.set_option( boost::asio::ip::udp::socket::reuse_address( true ), error );
     if( error ) { COMMA_THROW( comma::exception, "failed to set reuse address option on port " << port ); }
+    if( c.receive_buffer_size > 0 )
+    {
+        socket_.set_option( boost::asio::ip::udp::socket::receive_buffer_size( c.receive_buffer_size ), error );
+        if( error ) { COMMA_THROW( comma::exception, "failed to set receive buffer size to " << c.receive_buffer_size << " on port " << port ); }
+    }
     socket_.bind( boost::asio::ip::udp::endpoint( boost::asio::ip::udp::v4(), port ), error );
     if( error ) { COMMA_THROW( comma::exception, "failed to bind port " << port ); }
+    #ifdef __linux__
+    int on = 1;
+    if( ::setsockopt( socket_.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on ) ) != 0 ) { COMMA_THROW( comma::exception, "failed to set timestamp option on port " << port ); }
+    unsigned int size = c.batch_size == 0 ? 1 : c.batch_size;
+    buffers_.resize( size );
+    controls_.resize( size );
+    headers_.resize( size );
+    iovecs_.resize( size );
+    for( unsigned int i = 0; i < size; ++i )
+    {
+        iovecs_[i].iov_base = &buffers_[i][0];
+        iovecs_[i].iov_len = buffers_[i].size();
+        headers_[i].msg_hdr.msg_name = NULL;
+        headers_[i].msg_hdr.msg_namelen = 0;
+        headers_[i].msg_hdr.msg_iov = &iovecs_[i];
+        headers_[i].msg_hdr.msg_iovlen = 1;
+        headers_[i].msg_hdr.msg_flags = 0;
+    }
+    size_ = 0;
+    index_ = 0;
+    #endif // #ifdef __linux__
+}
 
+#ifdef __linux__
+
+const char* udp_reader::read()
+{
+    if( index_ >= size_ )
+    {
+        for( unsigned int i = 0; i < headers_.size(); ++i ) // recvmmsg() overwrites control length
+        {
+            headers_[i].msg_hdr.msg_control = controls_[i].buffer;
+            headers_[i].msg_hdr.msg_controllen = sizeof( controls_[i].buffer );
+        }
+        int size;
+        do { size = ::recvmmsg( socket_.native_handle(), &headers_[0], headers_.size(), MSG_WAITFORONE, NULL ); }
+        while( size < 0 && errno == EINTR );
+        if( size <= 0 ) { return NULL; }
+        size_ = size;
+        index_ = 0;
+    }
+    const ::mmsghdr& header = headers_[ index_ ];
+    if( header.msg_len == 0 ) { return NULL; }
+    timestamp_ = boost::posix_time::not_a_date_time;
+    for( ::cmsghdr* c = CMSG_FIRSTHDR( &header.msg_hdr ); c != NULL; c = CMSG_NXTHDR( const_cast< ::msghdr* >( &header.msg_hdr ), c ) )
+    {
+        if( c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS ) { continue; }
+        const ::timespec* t = reinterpret_cast< const ::timespec* >( CMSG_DATA( c ) );
+        timestamp_ = boost::posix_time::ptime( snark::timing::epoch, boost::posix_time::seconds( t->tv_sec ) + boost::posix_time::microseconds( t->tv_nsec / 1000 ) );
+        break;
+    }
+    if( timestamp_.is_not_a_date_time() ) { timestamp_ = boost::posix_time::microsec_clock::universal_time(); }
+    return &buffers_[ index_++ ][0];
 }
 
+#else // #ifdef __linux__
+
 const char* udp_reader::read()
 {
     boost::system::error_code error;
@@ -56,9 +131,12 @@ const char* udp_reader::read()
     return &packet_[0];
 }
 
+#endif // #ifdef __linux__
+
 void udp_reader::close() { socket_.close(); }
 
 const boost::posix_time::ptime& udp_reader::timestamp() const { return timestamp_; }
 
-} // namespace snark {
+unsigned short udp_reader::port() const { return socket_.local_endpoint().port(); }
 
+} // namespace snark {
@@ -34,7 +34,14 @@
 #ifndef WIN32
 #include <stdlib.h>
 #endif
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#endif
+#include <vector>
 #include <boost/array.hpp>
+#include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/noncopyable.hpp>
@@ -42,12 +49,30 @@
 namespace snark { 
 
 /// udp reader
+/// @note on linux, packets are received in batches with recvmmsg() and
+///       timestamped by the kernel on arrival (SO_TIMESTAMPNS)
 class udp_reader : public boost::noncopyable
 {
     public:
+        struct config
+        {
+            unsigned short port;
+
+            /// socket receive buffer size in bytes (SO_RCVBUF); 0: system default
+            unsigned int receive_buffer_size;
+
+            /// max number of packets received in one system call (linux only)
+            unsigned int batch_size;
+
+            config( unsigned short port = 0, unsigned int receive_buffer_size = 0, unsigned int batch_size = 64 ) : port( port ), receive_buffer_size( receive_buffer_size ), batch_size( batch_size ) {}
+        };
+
         /// constructor
         udp_reader( unsigned short port );
 
+        /// constructor
+        udp_reader( const config& c );
+
         /// read and return pointer to the current packet; NULL, if end of file
         const char* read();
 
@@ -57,11 +82,26 @@ class udp_reader : public boost::noncopyable
         /// return current timestamp
         const boost::posix_time::ptime& timestamp() const;
 
+        /// return local port, e.g. the one picked by the system, if port 0 was given
+        unsigned short port() const;
+
     private:
         boost::asio::io_service service_;
         boost::asio::ip::udp::socket socket_;
-        boost::array< char, 2000 > packet_; // way greater than velodyne packet
         boost::posix_time::ptime timestamp_;
+        #ifdef __linux__
+        typedef boost::array< char, 2000 > buffer_type;
+        std::vector< buffer_type > buffers_;
+        union control_type { ::cmsghdr header; char buffer[ CMSG_SPACE( sizeof( ::timespec ) ) ]; }; // ancillary data for kernel timestamp
+        std::vector< control_type > controls_;
+        std::vector< ::mmsghdr > headers_;
+        std::vector< ::iovec > iovecs_;
+        unsigned int size_;
+        unsigned int index_;
+        #else // #ifdef __linux__
+        boost::array< char, 2000 > packet_; // way greater than velodyne packet
+        #endif // #ifdef __linux__
+        void init_( const config& c );
 };
 
 } // namespace snark {
@@ -34,9 +34,14 @@
 #ifndef WIN32
 #include <stdlib.h>
 #endif
+#include <boost/array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <snark/visiting/eigen.h>
 #include "../stream.h"
+#include "../azimuth_table.h"
 #include "../db.h"
+#include "../decode_packet.h"
+#include "../deskew.h"
 
 namespace snark {
 
@@ -53,6 +58,101 @@ struct velodyne_point
     comma::uint32 scan;
 };
 
+/// decode raw velodyne packets into velodyne points
+class velodyne_decoder
+{
+public:
+    /// @param table optional lookup table for the same db, see velodyne::azimuth_table
+    /// @param deskew optional poses to transform points with, see set_deskew()
+    velodyne_decoder( const velodyne::db& db
+                    , bool outputInvalidpoints
+                    , bool raw_intensity = false
+                    , bool legacy = false
+                    , const velodyne::azimuth_table* table = NULL
+                    , const velodyne::deskew* deskew = NULL );
+
+    /// transform rays by sensor pose interpolated once per laser block at the block firing time;
+    /// points of blocks out of the time range of the poses are skipped; NULL: do not transform
+    void set_deskew( const velodyne::deskew* deskew ) { m_deskew = deskew; }
+
+    /// decode packet, then its points can be read one by one
+    void decode( const velodyne::packet& packet, const boost::posix_time::ptime& timestamp, comma::uint32 scan );
+
+    /// convert next point of the current packet
+    /// @return false if no more points in the current packet
+    bool read();
+    const velodyne_point& point() const { return m_point; }
+
+private:
+    const velodyne::db& m_db;
+    const velodyne::azimuth_table* m_table;
+    const velodyne::deskew* m_deskew;
+    bool m_output_invalid;
+    bool m_raw_intensity;
+    bool m_legacy;
+    velodyne::soa_points m_points;
+    std::size_t m_index;
+    boost::posix_time::ptime m_timestamp;
+    comma::uint32 m_scan;
+    velodyne_point m_point;
+    boost::array< velodyne::deskew::transform_type, 12 > m_transforms;
+    boost::array< bool, 12 > m_deskewed;
+};
+
+inline velodyne_decoder::velodyne_decoder( const velodyne::db& db, bool outputInvalidpoints, bool raw_intensity, bool legacy, const velodyne::azimuth_table* table, const velodyne::deskew* deskew ):
+    m_db( db ),
+    m_table( table ),
+    m_deskew( deskew ),
+    m_output_invalid( outputInvalidpoints ),
+    m_raw_intensity( raw_intensity ),
+    m_legacy( legacy ),
+    m_index( velodyne::soa_points::size ),
+    m_scan( 0 )
+{
+}
+
+inline void velodyne_decoder::decode( const velodyne::packet& packet, const boost::posix_time::ptime& timestamp, comma::uint32 scan )
+{
+    if( m_table ) { velodyne::decode_packet( packet, *m_table, m_points, m_legacy ); }
+    else { velodyne::decode_packet( packet, m_db, m_points, m_legacy ); }
+    m_timestamp = timestamp;
+    m_scan = scan;
+    m_index = 0;
+    if( !m_deskew ) { return; }
+    for( unsigned int block = 0; block < m_transforms.size(); ++block )
+    {
+        comma::int64 t = ( m_points.t[ block * 32 ] + m_points.t[ block * 32 + 31 ] ) / 2;
+        m_deskewed[block] = m_deskew->transform( timestamp + boost::posix_time::microseconds( t ), m_transforms[block] );
+    }
+}
+
+inline bool velodyne_decoder::read()
+{
+    while( m_index < velodyne::soa_points::size )
+    {
+        std::size_t i = velodyne::soa_points::ordered( m_index++ );
+        if( !m_points.valid[i] && !m_output_invalid ) { continue; }
+        if( m_deskew && !m_deskewed[ i / 32 ] ) { continue; }
+        m_point.timestamp = m_timestamp + boost::posix_time::microseconds( m_points.t[i] );
+        m_point.id = m_points.id[i];
+        // multiply by 255 to keep with the old format
+        m_point.intensity = m_raw_intensity ? m_points.intensity[i] : ( m_db.lasers[ m_point.id ].intensity( m_points.intensity[i], m_points.raw_range[i] ) * 255 );
+        m_point.valid = m_points.valid[i];
+        m_point.ray.first = ::Eigen::Vector3d( m_points.laser_x[i], m_points.laser_y[i], m_points.laser_z[i] );
+        m_point.ray.second = ::Eigen::Vector3d( m_points.x[i], m_points.y[i], m_points.z[i] );
+        if( m_deskew )
+        {
+            m_point.ray.first = velodyne::deskew::apply( m_transforms[ i / 32 ], m_point.ray.first );
+            m_point.ray.second = velodyne::deskew::apply( m_transforms[ i / 32 ], m_point.ray.second );
+        }
+        m_point.range = m_points.range[i];
+        m_point.scan = m_scan;
+        m_point.azimuth = m_points.azimuth[i];
+        return true;
+    }
+    return false;
+}
+
 /// convert stream of raw velodyne data into velodyne points
 template < typename S >
 class velodyne_stream
@@ -62,7 +162,8 @@ public:
                   , bool outputInvalidpoints
                   , boost::optional< std::size_t > from = boost::optional< std::size_t >(), boost::optional< std::size_t > to = boost::optional< std::size_t >()
                    , bool raw_intensity = false
-                   , bool legacy = false);
+                   , bool legacy = false
+                   , bool lookup_table = false );
 
     template < typename P >
     velodyne_stream( const P& p
@@ -70,17 +171,36 @@ public:
                   , bool outputInvalidpoints
                   , boost::optional< std::size_t > from = boost::optional< std::size_t >(), boost::optional< std::size_t > to = boost::optional< std::size_t >() 
                    , bool raw_intensity = false
-                   , bool legacy = false);
+                   , bool legacy = false
+                   , bool lookup_table = false );
 
     bool read();
-    const velodyne_point& point() const { return m_point; }
+    const velodyne_point& point() const { return m_decoder.point(); }
+
+    /// read whole raw packet, skipping the rest of the current one
+    /// @return NULL if end of stream or last scan is reached
+    const velodyne::packet* read_packet();
+
+    /// timestamp of the current packet
+    const boost::posix_time::ptime& timestamp() const { return m_stream.timestamp(); }
+
+    /// scan number of the current packet
+    unsigned int scan() const { return m_stream.scan(); }
+
+    const velodyne::db& db() const { return m_db; }
+
+    /// lookup table, if requested, NULL otherwise
+    const velodyne::azimuth_table* table() const { return m_table.get(); }
+
+    /// transform points by interpolated sensor poses, see velodyne_decoder::set_deskew()
+    void set_deskew( const velodyne::deskew* deskew ) { m_decoder.set_deskew( deskew ); }
 
 private:
     velodyne::stream< S > m_stream;
     velodyne::db m_db;
-    velodyne_point m_point;
     boost::optional< std::size_t > m_to;
-    bool m_raw_intensity;
+    boost::scoped_ptr< velodyne::azimuth_table > m_table;
+    velodyne_decoder m_decoder;
 };
 
 template < typename S >
@@ -88,13 +208,15 @@ velodyne_stream< S >::velodyne_stream ( const velodyne::db& db, bool outputInval
                     , boost::optional< std::size_t > from
                     , boost::optional< std::size_t > to 
                     , bool raw_intensity
-                    , bool legacy):
+                    , bool legacy
+                    , bool lookup_table ):
     m_stream( new S, outputInvalidpoints, legacy ),
     m_db( db ),
     m_to( to ),
-    m_raw_intensity(raw_intensity)
+    m_table( lookup_table ? new velodyne::azimuth_table( m_db ) : NULL ),
+    m_decoder( m_db, outputInvalidpoints, raw_intensity, legacy, m_table.get() )
 {
-    if( from ) { while( m_stream.scan() < *from ) { m_stream.skip_scan(); } }
+    if( from && !m_stream.seek_scan( *from ) ) { while( m_stream.scan() < *from ) { m_stream.skip_scan(); } }
 }
 
 template < typename S >
@@ -103,13 +225,24 @@ velodyne_stream< S >::velodyne_stream ( const P& p, const velodyne::db& db, bool
                     , boost::optional< std::size_t > from
                     , boost::optional< std::size_t > to 
                     , bool raw_intensity
-                    , bool legacy):
+                    , bool legacy
+                    , bool lookup_table ):
     m_stream( new S( p ), outputInvalidpoints, legacy ),
     m_db( db ),
     m_to( to ),
-    m_raw_intensity(raw_intensity)
+    m_table( lookup_table ? new velodyne::azimuth_table( m_db ) : NULL ),
+    m_decoder( m_db, outputInvalidpoints, raw_intensity, legacy, m_table.get() )
+{
+    if( from && !m_stream.seek_scan( *from ) ) { while( m_stream.scan() < *from ) { m_stream.skip_scan(); } }
+}
+
+template < typename S >
+const velodyne::packet* velodyne_stream< S >::read_packet()
 {
-    if( from ) { while( m_stream.scan() < *from ) { m_stream.skip_scan(); } }
+    if( m_to && m_stream.scan() > *m_to ) { return NULL; }
+    const velodyne::packet* packet = m_stream.read_packet();
+    if( packet == NULL || ( m_to && m_stream.scan() > *m_to ) ) { return NULL; }
+    return packet;
 }
 
 /// read and convert one point from the stream
@@ -117,18 +250,12 @@ velodyne_stream< S >::velodyne_stream ( const P& p, const velodyne::db& db, bool
 template < typename S >
 bool velodyne_stream< S >::read()
 {
-    if( m_to && m_stream.scan() > *m_to ) { return false; }
-    const velodyne::laser_return* r = m_stream.read();
-    if( r == NULL ) { return false; }
-    m_point.timestamp = r->timestamp;
-    m_point.id = r->id;
-    // multiply by 255 to keep with the old format
-    m_point.intensity = m_raw_intensity ? r->intensity : (m_db.lasers[ m_point.id ].intensity(r->intensity, r->range) * 255);
-    m_point.valid = !comma::math::equal( r->range, 0 ); // quick and dirty
-    m_point.ray = m_db.lasers[ m_point.id ].ray( r->range, r->azimuth );
-    m_point.range = m_db.lasers[ m_point.id ].range( r->range );
-    m_point.scan = m_stream.scan();
-    m_point.azimuth = m_db.lasers[ m_point.id ].azimuth( r->azimuth );
+    while( !m_decoder.read() )
+    {
+        const velodyne::packet* packet = read_packet();
+        if( packet == NULL ) { return false; }
+        m_decoder.decode( *packet, m_stream.timestamp(), m_stream.scan() );
+    }
     return true;
 }
 
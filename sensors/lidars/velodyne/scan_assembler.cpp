@@ -0,0 +1,164 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/exception.h>
+#include "scan_assembler.h"
+
+namespace snark {  namespace velodyne {
+
+void revolution::clear()
+{
+    t.clear();
+    id.clear();
+    intensity.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+}
+
+void revolution::reserve( std::size_t size )
+{
+    t.reserve( size );
+    id.reserve( size );
+    intensity.reserve( size );
+    x.reserve( size );
+    y.reserve( size );
+    z.reserve( size );
+}
+
+scan_assembler::scan_assembler( const velodyne::db& db, const scan_assembler::config& c )
+    : m_db( db )
+    , m_table( NULL )
+    , m_config( c )
+    , m_buffers( c.buffers )
+    , m_ready( c.buffers )
+    , m_free( c.buffers )
+{
+    init();
+}
+
+scan_assembler::scan_assembler( const azimuth_table& table, const scan_assembler::config& c )
+    : m_db( table.db() )
+    , m_table( &table )
+    , m_config( c )
+    , m_buffers( c.buffers )
+    , m_ready( c.buffers )
+    , m_free( c.buffers )
+{
+    init();
+}
+
+void scan_assembler::init()
+{
+    if( m_config.buffers < 2 ) { COMMA_THROW( comma::exception, "expected at least 2 buffers, got " << m_config.buffers ); }
+    m_boundary = azimuth_table::step( m_config.boundary - 90 ); // see impl::get_laser_return(): azimuth is rotation + 90 degrees
+    for( unsigned int i = 0; i < m_buffers.size(); ++i ) { m_buffers[i].reserve( m_config.reserve ); m_free.push( &m_buffers[i] ); }
+    m_current = NULL;
+    m_scan = 0;
+    m_dropped = 0;
+    start();
+}
+
+bool scan_assembler::crossed( unsigned int rotation )
+{
+    unsigned int phase = ( rotation + azimuth_table::steps - m_boundary ) % azimuth_table::steps;
+    bool crossed = m_last && phase < *m_last;
+    m_last = phase;
+    return crossed;
+}
+
+void scan_assembler::start()
+{
+    revolution* r;
+    if( !m_free.pop( r ) ) { ++m_dropped; return; }
+    r->clear();
+    r->scan = m_scan;
+    r->timestamp = boost::posix_time::not_a_date_time;
+    m_current = r;
+}
+
+void scan_assembler::finish()
+{
+    if( !m_current ) { return; }
+    m_ready.push( m_current ); // never full: there are only as many buffers as the queue capacity
+    m_current = NULL;
+}
+
+void scan_assembler::append( unsigned int block, comma::int64 offset )
+{
+    for( std::size_t i = block * 32; i < ( block + 1 ) * 32; ++i )
+    {
+        if( !m_points.valid[i] && !m_config.output_invalid ) { continue; }
+        m_current->t.push_back( offset + m_points.t[i] );
+        m_current->id.push_back( m_points.id[i] );
+        m_current->intensity.push_back( m_points.intensity[i] );
+        m_current->x.push_back( m_points.x[i] );
+        m_current->y.push_back( m_points.y[i] );
+        m_current->z.push_back( m_points.z[i] );
+    }
+}
+
+void scan_assembler::push( const packet& packet, const boost::posix_time::ptime& timestamp )
+{
+    if( m_table ) { decode_packet( packet, *m_table, m_points, m_config.legacy ); }
+    else { decode_packet( packet, m_db, m_points, m_config.legacy ); }
+    boost::optional< comma::uint32 > scan; // buffers get recycled, thus tell revolutions by scan number
+    comma::int64 offset = 0;
+    for( unsigned int block = 0; block < packet.blocks.size(); ++block )
+    {
+        if( crossed( packet.blocks[block].rotation() ) ) { flush(); }
+        if( !m_current ) { continue; }
+        if( !scan || *scan != m_current->scan )
+        {
+            scan = m_current->scan;
+            if( m_current->timestamp.is_not_a_date_time() ) { m_current->timestamp = timestamp; }
+            offset = ( timestamp - m_current->timestamp ).total_microseconds();
+        }
+        append( block, offset );
+    }
+}
+
+void scan_assembler::flush()
+{
+    finish();
+    ++m_scan;
+    start();
+}
+
+revolution* scan_assembler::pop()
+{
+    revolution* r;
+    return m_ready.pop( r ) ? r : NULL;
+}
+
+void scan_assembler::release( revolution* r ) { m_free.push( r ); }
+
+} } // namespace snark {  namespace velodyne {
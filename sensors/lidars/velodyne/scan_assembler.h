@@ -0,0 +1,157 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_SCAN_ASSEMBLER_H_
+#define SNARK_SENSORS_VELODYNE_SCAN_ASSEMBLER_H_
+
+#include <vector>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/optional.hpp>
+#include <comma/base/types.h>
+#include "azimuth_table.h"
+#include "db.h"
+#include "decode_packet.h"
+#include "packet.h"
+
+namespace snark {  namespace velodyne {
+
+/// points of a whole revolution as structure of arrays
+struct revolution
+{
+    /// revolution number, counting from 0 for the first, possibly partial, revolution
+    comma::uint32 scan;
+
+    /// timestamp of the first packet of the revolution
+    boost::posix_time::ptime timestamp;
+
+    /// time offset from timestamp in microseconds; negative for returns
+    /// fired before the timestamp of the first packet
+    std::vector< comma::int64 > t;
+
+    /// laser id
+    std::vector< comma::uint32 > id;
+
+    /// intensity as in the packet
+    std::vector< unsigned char > intensity;
+
+    /// laser return position
+    std::vector< double > x;
+    std::vector< double > y;
+    std::vector< double > z;
+
+    /// number of points
+    std::size_t size() const { return t.size(); }
+
+    /// remove all points, keeping allocated memory
+    void clear();
+
+    /// preallocate memory for given number of points
+    void reserve( std::size_t size );
+};
+
+/// assembles decoded packets into whole revolutions in one thread and hands
+/// them to a consumer in another thread through a lock-free single producer
+/// single consumer queue; revolution buffers are allocated once and recycled
+///
+/// producer: push() packets, flush() at the end of stream
+/// consumer: pop() revolutions and release() them, once done
+///
+/// @note if the consumer holds on to all the buffers, revolutions are dropped
+///       rather than assembled into newly allocated memory, see dropped()
+class scan_assembler
+{
+    public:
+        struct config
+        {
+            /// azimuth in degrees at which revolutions start, in the same frame
+            /// as decoded azimuth; default 0, i.e. the same as velodyne::scan_tick
+            double boundary;
+
+            /// number of revolution buffers
+            unsigned int buffers;
+
+            /// number of points to preallocate in each buffer
+            std::size_t reserve;
+
+            /// output returns with zero range
+            bool output_invalid;
+
+            /// legacy time table and azimuth calculation, see decode_packet()
+            bool legacy;
+
+            config() : boundary( 0 ), buffers( 4 ), reserve( 12 * 32 * 360 ), output_invalid( false ), legacy( false ) {}
+        };
+
+        /// constructor
+        scan_assembler( const velodyne::db& db, const config& c = config() );
+
+        /// constructor, using azimuth lookup table for decoding
+        scan_assembler( const azimuth_table& table, const config& c = config() );
+
+        /// producer: decode packet and add it to the current revolution;
+        /// the revolution is queued for the consumer, once the packet crosses the boundary azimuth
+        void push( const packet& packet, const boost::posix_time::ptime& timestamp );
+
+        /// producer: queue the current incomplete revolution, e.g. at the end of stream
+        void flush();
+
+        /// consumer: return next assembled revolution or NULL, if none available; does not block
+        revolution* pop();
+
+        /// consumer: give revolution buffer back for reuse
+        void release( revolution* r );
+
+        /// producer: number of revolutions dropped, since no free buffer was available
+        comma::uint64 dropped() const { return m_dropped; }
+
+    private:
+        const velodyne::db& m_db;
+        const azimuth_table* m_table;
+        config m_config;
+        unsigned int m_boundary;
+        std::vector< revolution > m_buffers;
+        boost::lockfree::spsc_queue< revolution* > m_ready;
+        boost::lockfree::spsc_queue< revolution* > m_free;
+        revolution* m_current;
+        comma::uint32 m_scan;
+        boost::optional< unsigned int > m_last;
+        comma::uint64 m_dropped;
+        soa_points m_points;
+        void init();
+        bool crossed( unsigned int rotation );
+        void start();
+        void finish();
+        void append( unsigned int block, comma::int64 offset );
+};
+
+} } // namespace snark {  namespace velodyne {
+
+#endif // SNARK_SENSORS_VELODYNE_SCAN_ASSEMBLER_H_
@@ -58,10 +58,21 @@ class stream : public boost::noncopyable
         /// read point, return NULL, if end of stream
         laser_return* read();
 
+        /// read whole packet, return NULL, if end of stream
+        /// @note the rest of the current packet, if any, is skipped
+        const packet* read_packet();
+
+        /// return timestamp of the current packet
+        const boost::posix_time::ptime& timestamp() const;
+
         /// skip given number of scans including the current one
         /// @todo: the same for packets and points, once needed
         void skip_scan();
 
+        /// position stream at the beginning of given scan, if the underlying stream supports it (e.g. indexed pcap file)
+        /// @return false, if seek is not supported
+        bool seek_scan( unsigned int scan );
+
         /// return current scan number
         unsigned int scan() const;
 
@@ -111,6 +122,7 @@ inline stream< S >::stream( S* stream, unsigned int rpm, bool outputInvalid, boo
     : m_angularSpeed( ( 360 / 60 ) * rpm )
     , m_outputInvalid( outputInvalid )
     , m_stream( stream )
+    , m_packet( NULL )
     , m_scan( 0 )
     , m_closed( false )
     , m_legacy(legacy)
@@ -122,6 +134,7 @@ template < typename S >
 inline stream< S >::stream( S* stream, bool outputInvalid, bool legacy )
     : m_outputInvalid( outputInvalid )
     , m_stream( stream )
+    , m_packet( NULL )
     , m_scan( 0 )
     , m_closed( false )
     , m_legacy(legacy)
@@ -133,9 +146,7 @@ template < typename S >
 inline double stream< S >::angularSpeed()
 {
     if( m_angularSpeed ) { return *m_angularSpeed; }
-    double da = double( m_packet->blocks[0].rotation() - m_packet->blocks[11].rotation() ) / 100;
-    double dt = double( ( impl::time_offset( 0, 0 ) - impl::time_offset( 11, 0 ) ).total_microseconds() ) / 1e6;
-    return da / dt;
+    return impl::angular_speed( *m_packet );
 }
 
 template < typename S >
@@ -161,6 +172,37 @@ inline laser_return* stream< S >::read()
     return NULL;
 }
 
+template < typename S >
+inline const packet* stream< S >::read_packet()
+{
+    if( m_closed ) { return NULL; }
+    bool pending = m_index.idx == 0 && m_packet != NULL; // packet left by skip_scan(), none of its returns read yet
+    m_index.idx = m_size;
+    if( !pending )
+    {
+        m_packet = reinterpret_cast< const packet* >( impl::stream_traits< S >::read( *m_stream, sizeof( packet ) ) );
+        if( m_packet == NULL ) { return NULL; }
+        if( impl::stream_traits< S >::is_new_scan( m_tick, *m_stream, *m_packet ) ) { ++m_scan; }
+    }
+    m_timestamp = impl::stream_traits< S >::timestamp( *m_stream );
+    return m_packet;
+}
+
+template < typename S >
+inline const boost::posix_time::ptime& stream< S >::timestamp() const { return m_timestamp; }
+
+template < typename S >
+inline bool stream< S >::seek_scan( unsigned int scan )
+{
+    boost::optional< unsigned int > passed = impl::stream_traits< S >::seek_scan( *m_stream, scan );
+    if( !passed ) { return false; }
+    m_scan = *passed;
+    m_tick = scan_tick(); // the first packet read will start a new scan
+    m_packet = NULL;
+    m_index.idx = m_size;
+    return true;
+}
+
 template < typename S >
 inline unsigned int stream< S >::scan() const { return m_scan; }
 
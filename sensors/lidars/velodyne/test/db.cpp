@@ -28,6 +28,7 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <cstring>
 #include <string>
 #include "db.h"
 
@@ -45,6 +46,18 @@ db zerodb()
     return db;
 }
 
+packet make_packet( unsigned int rotation )
+{
+    packet p;
+    ::memset( p.data(), 0, packet::size );
+    for( unsigned int block = 0; block < p.blocks.size(); ++block )
+    {
+        ::memcpy( p.blocks[block].id.data(), ( block & 0x1 ) ? packet::lower_block_id() : packet::upper_block_id(), 2 );
+        p.blocks[block].rotation = ( rotation + block / 2 * 20 ) % 36000;
+    }
+    return p;
+}
+
 db testdb()
 {
     velodyne::db db;
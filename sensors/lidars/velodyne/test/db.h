@@ -32,6 +32,7 @@
 #define SNARK_SENSORS_VELODYNE_TEST_DB_H_
 
 #include "../db.h"
+#include "../packet.h"
 
 namespace snark {  namespace velodyne { namespace test {
 
@@ -41,6 +42,11 @@ db zerodb();
 
 db testdb();
 
+/// return packet with block ids set and all laser data zeroed; the first block pair
+/// is at given rotation in hundredths of degree, each next pair 0.2 degree further,
+/// i.e. 1.2 degree per packet or 300 packets per revolution
+packet make_packet( unsigned int rotation );
+
 } } } // namespace snark {  namespace velodyne { namespace Test {
 
 #endif // SNARK_SENSORS_VELODYNE_TEST_DB_H_
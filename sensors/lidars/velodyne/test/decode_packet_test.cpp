@@ -0,0 +1,123 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include "../azimuth_table.h"
+#include "../decode_packet.h"
+#include "../impl/get_laser_return.h"
+#include "db.h"
+
+namespace snark {  namespace velodyne {
+
+static packet make_packet()
+{
+    packet p = test::make_packet( 35900 ); // rotation wraps around within packet
+    for( unsigned int block = 0; block < p.blocks.size(); ++block )
+    {
+        for( unsigned int laser = 0; laser < p.blocks[block].lasers.size(); ++laser )
+        {
+            p.blocks[block].lasers[laser].range = laser % 7 == 0 ? 0 : std::rand() % 60000;
+            p.blocks[block].lasers[laser].intensity = std::rand() % 256;
+        }
+    }
+    return p;
+}
+
+static void test_decode_packet( bool legacy )
+{
+    db db = test::testdb();
+    packet p = make_packet();
+    soa_points points;
+    decode_packet( p, db, points, legacy );
+    double speed = impl::angular_speed( p );
+    boost::posix_time::ptime t( boost::posix_time::from_iso_string( "20140101T000000" ) );
+    for( unsigned int n = 0; n < soa_points::size; ++n )
+    {
+        unsigned int block = ( n >> 6 ) * 2 + ( n & 0x1 );
+        unsigned int laser = ( n & 63 ) >> 1;
+        std::size_t i = soa_points::ordered( n );
+        EXPECT_EQ( block * 32 + laser, i );
+        laser_return r = impl::get_laser_return( p, block, laser, t, speed, legacy );
+        std::pair< ::Eigen::Vector3d, ::Eigen::Vector3d > ray = db.lasers[ r.id ].ray( r.range, r.azimuth );
+        EXPECT_EQ( r.id, points.id[i] );
+        EXPECT_EQ( r.intensity, points.intensity[i] );
+        EXPECT_EQ( r.range, points.raw_range[i] );
+        EXPECT_EQ( r.range != 0, points.valid[i] );
+        EXPECT_EQ( r.timestamp, t + boost::posix_time::microseconds( points.t[i] ) );
+        EXPECT_DOUBLE_EQ( db.lasers[ r.id ].range( r.range ), points.range[i] );
+        EXPECT_DOUBLE_EQ( db.lasers[ r.id ].azimuth( r.azimuth ), points.azimuth[i] );
+        EXPECT_NEAR( ray.first.x(), points.laser_x[i], 1e-9 );
+        EXPECT_NEAR( ray.first.y(), points.laser_y[i], 1e-9 );
+        EXPECT_NEAR( ray.first.z(), points.laser_z[i], 1e-9 );
+        EXPECT_NEAR( ray.second.x(), points.x[i], 1e-9 );
+        EXPECT_NEAR( ray.second.y(), points.y[i], 1e-9 );
+        EXPECT_NEAR( ray.second.z(), points.z[i], 1e-9 );
+    }
+}
+
+TEST( decode_packet, same_as_laser_return ) { test_decode_packet( false ); }
+
+TEST( decode_packet, same_as_laser_return_legacy ) { test_decode_packet( true ); }
+
+TEST( decode_packet, lookup_table )
+{
+    db db = test::testdb();
+    azimuth_table table( db );
+    packet p = make_packet();
+    soa_points expected;
+    soa_points points;
+    decode_packet( p, db, expected, false );
+    decode_packet( p, table, points, false );
+    for( unsigned int i = 0; i < soa_points::size; ++i )
+    {
+        EXPECT_EQ( expected.id[i], points.id[i] );
+        EXPECT_EQ( expected.valid[i], points.valid[i] );
+        EXPECT_DOUBLE_EQ( expected.range[i], points.range[i] );
+        EXPECT_DOUBLE_EQ( expected.azimuth[i], points.azimuth[i] );
+        EXPECT_NEAR( expected.laser_x[i], points.laser_x[i], 1e-5 );
+        EXPECT_NEAR( expected.laser_y[i], points.laser_y[i], 1e-5 );
+        EXPECT_NEAR( expected.laser_z[i], points.laser_z[i], 1e-5 );
+        EXPECT_NEAR( expected.x[i], points.x[i], 1e-4 );
+        EXPECT_NEAR( expected.y[i], points.y[i], 1e-4 );
+        EXPECT_NEAR( expected.z[i], points.z[i], 1e-4 );
+    }
+}
+
+TEST( azimuth_table, step )
+{
+    EXPECT_EQ( 0u, azimuth_table::step( 0 ) );
+    EXPECT_EQ( 0u, azimuth_table::step( 360 ) );
+    EXPECT_EQ( 9000u, azimuth_table::step( 90 ) );
+    EXPECT_EQ( 12345u, azimuth_table::step( 123.45 ) );
+    EXPECT_EQ( 35999u, azimuth_table::step( -0.01 ) );
+}
+
+} } // namespace snark {  namespace velodyne {
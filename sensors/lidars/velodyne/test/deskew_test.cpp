@@ -0,0 +1,89 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/exception.h>
+#include "../deskew.h"
+
+namespace snark {  namespace velodyne {
+
+static const boost::posix_time::ptime start( boost::posix_time::from_iso_string( "20140101T000000" ) );
+
+static pose make_pose( unsigned int seconds, const Eigen::Vector3d& coordinates, const Eigen::Vector3d& orientation )
+{
+    pose p;
+    p.t = start + boost::posix_time::seconds( seconds );
+    p.coordinates = coordinates;
+    p.orientation = orientation;
+    return p;
+}
+
+TEST( deskew, transform )
+{
+    std::vector< pose > poses;
+    poses.push_back( make_pose( 0, Eigen::Vector3d( 0, 0, 0 ), Eigen::Vector3d( 0, 0, 0 ) ) );
+    poses.push_back( make_pose( 1, Eigen::Vector3d( 10, 0, 0 ), Eigen::Vector3d( 0, 0, M_PI / 2 ) ) );
+    poses.push_back( make_pose( 2, Eigen::Vector3d( 10, 20, 0 ), Eigen::Vector3d( 0, 0, M_PI / 2 ) ) );
+    deskew d( poses );
+    deskew::transform_type m;
+    EXPECT_FALSE( d.transform( start - boost::posix_time::microseconds( 1 ), m ) );
+    EXPECT_FALSE( d.transform( start + boost::posix_time::microseconds( 2000001 ), m ) );
+    ASSERT_TRUE( d.transform( start, m ) );
+    Eigen::Vector3d p = deskew::apply( m, Eigen::Vector3d( 1, 0, 0 ) );
+    EXPECT_NEAR( 1, p.x(), 1e-9 );
+    EXPECT_NEAR( 0, p.y(), 1e-9 );
+    ASSERT_TRUE( d.transform( start + boost::posix_time::seconds( 2 ), m ) );
+    p = deskew::apply( m, Eigen::Vector3d( 1, 0, 0 ) );
+    EXPECT_NEAR( 10, p.x(), 1e-9 );
+    EXPECT_NEAR( 21, p.y(), 1e-9 );
+    ASSERT_TRUE( d.transform( start + boost::posix_time::milliseconds( 500 ), m ) );
+    p = deskew::apply( m, Eigen::Vector3d( 1, 0, 0 ) );
+    EXPECT_NEAR( 5 + std::cos( M_PI / 4 ), p.x(), 1e-9 );
+    EXPECT_NEAR( std::sin( M_PI / 4 ), p.y(), 1e-9 );
+    EXPECT_NEAR( 0, p.z(), 1e-9 );
+    ASSERT_TRUE( d.transform( start + boost::posix_time::milliseconds( 1500 ), m ) );
+    p = deskew::apply( m, Eigen::Vector3d( 0, 0, 1 ) );
+    EXPECT_NEAR( 10, p.x(), 1e-9 );
+    EXPECT_NEAR( 10, p.y(), 1e-9 );
+    EXPECT_NEAR( 1, p.z(), 1e-9 );
+}
+
+TEST( deskew, unsorted )
+{
+    std::vector< pose > poses;
+    EXPECT_THROW( deskew d( poses ), comma::exception );
+    poses.push_back( make_pose( 1, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero() ) );
+    poses.push_back( make_pose( 0, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero() ) );
+    EXPECT_THROW( deskew d( poses ), comma::exception );
+}
+
+} } // namespace snark {  namespace velodyne {
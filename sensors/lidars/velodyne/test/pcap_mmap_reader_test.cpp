@@ -0,0 +1,125 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <comma/base/types.h>
+#include "../impl/pcap_mmap_reader.h"
+#include "../packet.h"
+
+namespace snark { namespace velodyne {
+
+static void write( std::string& s, comma::uint32 v ) { s.append( reinterpret_cast< const char* >( &v ), sizeof( v ) ); }
+
+static void write_big_endian( std::string& s, comma::uint16 v ) { s += char( v >> 8 ); s += char( v & 0xff ); }
+
+static std::string frame( unsigned short port, unsigned int rotation, std::size_t size = packet::size )
+{
+    std::string s( 12, 0 ); // mac addresses
+    write_big_endian( s, 0x0800 );
+    std::string ip( 20, 0 );
+    ip[0] = 0x45;
+    ip[9] = 17;
+    s += ip;
+    write_big_endian( s, 2368 );
+    write_big_endian( s, port );
+    write_big_endian( s, size + 8 );
+    write_big_endian( s, 0 );
+    std::string payload( size, 0 );
+    if( size == packet::size ) { reinterpret_cast< packet* >( &payload[0] )->blocks[0].rotation = rotation; }
+    return s + payload;
+}
+
+static std::string make_pcap( const std::vector< std::string >& frames )
+{
+    std::string s;
+    write( s, 0xa1b2c3d4 );
+    write( s, 0x00040002 ); // version 2.4
+    write( s, 0 );
+    write( s, 0 );
+    write( s, 65535 );
+    write( s, 1 ); // ethernet
+    for( unsigned int i = 0; i < frames.size(); ++i )
+    {
+        write( s, 1000 + i );
+        write( s, 500 );
+        write( s, frames[i].size() );
+        write( s, frames[i].size() );
+        s += frames[i];
+    }
+    return s;
+}
+
+TEST( pcap_mmap_reader, read_and_seek )
+{
+    std::vector< std::string > frames;
+    unsigned int rotations[] = { 100, 10000, 20000, 500, 8308, 15000, 200, 10000 }; // scans start at 1st, 4th and 7th packets
+    for( unsigned int i = 0; i < 8; ++i ) { frames.push_back( rotations[i] == 8308 ? frame( 8308, 0, 512 ) : frame( 2368, rotations[i] ) ); }
+    std::string filename = "pcap_mmap_reader_test.pcap";
+    std::string index = "pcap_mmap_reader_test.pcap.index";
+    {
+        std::ofstream ofs( filename.c_str(), std::ios::binary );
+        const std::string& s = make_pcap( frames );
+        ofs.write( &s[0], s.size() );
+    }
+    for( unsigned int k = 0; k < 2; ++k ) // second time, index is loaded from file
+    {
+        pcap_mmap_reader reader( pcap_mmap_reader::config( filename, 2368, index ) );
+        unsigned int count = 0;
+        for( const char* p = reader.read(); p; p = reader.read(), ++count )
+        {
+            EXPECT_EQ( std::size_t( packet::size ), reader.size() );
+            EXPECT_NE( 8308u, reinterpret_cast< const packet* >( p )->blocks[0].rotation() );
+        }
+        EXPECT_EQ( 7u, count );
+        EXPECT_TRUE( reader.eof() );
+        EXPECT_EQ( 2u, reader.seek_scan( 3 ) );
+        const char* p = reader.read();
+        ASSERT_TRUE( p != NULL );
+        EXPECT_EQ( 200u, reinterpret_cast< const packet* >( p )->blocks[0].rotation() );
+        EXPECT_EQ( boost::posix_time::ptime( boost::gregorian::date( 1970, 1, 1 ), boost::posix_time::seconds( 1006 ) + boost::posix_time::microseconds( 500 ) ), reader.timestamp() );
+        EXPECT_EQ( 1u, reader.seek_scan( 2 ) );
+        p = reader.read();
+        ASSERT_TRUE( p != NULL );
+        EXPECT_EQ( 500u, reinterpret_cast< const packet* >( p )->blocks[0].rotation() );
+        EXPECT_EQ( 0u, reader.seek_scan( 0 ) );
+        EXPECT_EQ( 100u, reinterpret_cast< const packet* >( reader.read() )->blocks[0].rotation() );
+        EXPECT_EQ( 3u, reader.seek_scan( 4 ) );
+        EXPECT_TRUE( reader.read() == NULL );
+    }
+    std::remove( filename.c_str() );
+    std::remove( index.c_str() );
+}
+
+} } // namespace snark { namespace velodyne {
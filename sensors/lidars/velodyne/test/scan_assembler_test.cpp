@@ -0,0 +1,169 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <gtest/gtest.h>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include "../scan_assembler.h"
+#include "db.h"
+
+namespace snark {  namespace velodyne {
+
+static const boost::posix_time::ptime start( boost::posix_time::from_iso_string( "20140101T000000" ) );
+
+static packet make_packet( unsigned int n ) // 300 packets per revolution
+{
+    packet p = test::make_packet( n * 120 );
+    for( unsigned int block = 0; block < p.blocks.size(); ++block )
+    {
+        for( unsigned int laser = 0; laser < p.blocks[block].lasers.size(); ++laser ) { p.blocks[block].lasers[laser].range = 1000 + laser; }
+    }
+    return p;
+}
+
+static boost::posix_time::ptime timestamp( unsigned int n ) { return start + boost::posix_time::microseconds( n * 333 ); }
+
+TEST( scan_assembler, revolutions )
+{
+    db db = test::testdb();
+    scan_assembler assembler( db );
+    std::vector< std::size_t > sizes;
+    for( unsigned int n = 0; n < 1000; ++n )
+    {
+        assembler.push( make_packet( n ), timestamp( n ) );
+        for( revolution* r = assembler.pop(); r; r = assembler.pop() )
+        {
+            EXPECT_EQ( sizes.size(), r->scan );
+            sizes.push_back( r->size() );
+            EXPECT_EQ( r->size(), r->x.size() );
+            EXPECT_EQ( r->size(), r->id.size() );
+            if( r->scan > 0 ) { EXPECT_EQ( timestamp( 225 + ( r->scan - 1 ) * 300 ), r->timestamp ); } // rotation 27000, i.e. azimuth 0
+            assembler.release( r );
+        }
+    }
+    EXPECT_EQ( 0u, assembler.dropped() );
+    ASSERT_EQ( 3u, sizes.size() );
+    EXPECT_EQ( 225u * 384, sizes[0] );
+    EXPECT_EQ( 300u * 384, sizes[1] );
+    EXPECT_EQ( 300u * 384, sizes[2] );
+    assembler.flush();
+    revolution* r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( 3u, r->scan );
+    EXPECT_EQ( ( 1000u - 225 - 600 ) * 384, r->size() );
+}
+
+TEST( scan_assembler, boundary )
+{
+    db db = test::testdb();
+    scan_assembler::config config;
+    config.boundary = 135; // rotation 4500, i.e. in the middle of packet 37
+    scan_assembler assembler( db, config );
+    soa_points points;
+    for( unsigned int n = 0; n < 400; ++n ) { assembler.push( make_packet( n ), timestamp( n ) ); }
+    revolution* r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( ( 37u * 6 + 3 ) * 64, r->size() );
+    assembler.release( r );
+    r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( 300u * 384, r->size() );
+    EXPECT_EQ( timestamp( 37 ), r->timestamp );
+    decode_packet( make_packet( 37 ), db, points );
+    EXPECT_DOUBLE_EQ( points.x[ 6 * 32 ], r->x[0] );
+    EXPECT_DOUBLE_EQ( points.y[ 6 * 32 ], r->y[0] );
+    EXPECT_EQ( points.t[ 6 * 32 ], r->t[0] );
+    decode_packet( make_packet( 38 ), db, points );
+    EXPECT_EQ( points.id[0], r->id[ 6 * 32 ] );
+    EXPECT_EQ( points.t[0] + 333, r->t[ 6 * 32 ] );
+    EXPECT_TRUE( assembler.pop() == NULL );
+}
+
+TEST( scan_assembler, dropped )
+{
+    db db = test::testdb();
+    scan_assembler::config config;
+    config.buffers = 2;
+    config.reserve = 0;
+    scan_assembler assembler( db, config );
+    for( unsigned int n = 0; n < 1000; ++n ) { assembler.push( make_packet( n ), timestamp( n ) ); }
+    EXPECT_EQ( 2u, assembler.dropped() );
+    revolution* r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( 0u, r->scan );
+    assembler.release( r );
+    r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( 1u, r->scan );
+    EXPECT_TRUE( assembler.pop() == NULL );
+    for( unsigned int n = 1000; n < 1450; ++n ) { assembler.push( make_packet( n ), timestamp( n ) ); }
+    r = assembler.pop();
+    ASSERT_TRUE( r != NULL );
+    EXPECT_EQ( 4u, r->scan );
+    EXPECT_EQ( 300u * 384, r->size() );
+}
+
+static void produce( scan_assembler& assembler, unsigned int size )
+{
+    for( unsigned int n = 0; n < size; ++n ) { assembler.push( make_packet( n ), timestamp( n ) ); }
+    assembler.flush();
+}
+
+TEST( scan_assembler, threads )
+{
+    db db = test::testdb();
+    scan_assembler assembler( db );
+    boost::thread producer( boost::bind( &produce, boost::ref( assembler ), 3100 ) );
+    std::size_t size = 0;
+    comma::uint32 scan = 0;
+    unsigned int count = 0;
+    bool done = false;
+    while( true )
+    {
+        revolution* r = assembler.pop();
+        if( !r )
+        {
+            if( done ) { break; } // producer has joined and nothing is left
+            done = producer.timed_join( boost::posix_time::milliseconds( 1 ) );
+            continue;
+        }
+        EXPECT_LE( scan, r->scan );
+        scan = r->scan + 1;
+        size += r->size();
+        ++count;
+        if( r->scan > 0 && r->scan < 10 ) { EXPECT_EQ( 300u * 384, r->size() ); }
+        assembler.release( r );
+    }
+    EXPECT_EQ( 11u, count + assembler.dropped() );
+    if( assembler.dropped() == 0 ) { EXPECT_EQ( 3100u * 384, size ); }
+}
+
+} } // namespace snark {  namespace velodyne {
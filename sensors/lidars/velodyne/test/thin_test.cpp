@@ -0,0 +1,249 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include "../thin/thin.h"
+#include "db.h"
+
+namespace snark { namespace velodyne {
+
+static packet make_packet( unsigned int n, double rate )
+{
+    packet p = test::make_packet( n * 120 );
+    for( unsigned int block = 0; block < p.blocks.size(); ++block )
+    {
+        for( unsigned int laser = 0; laser < p.blocks[block].lasers.size(); ++laser )
+        {
+            if( double( std::rand() ) / RAND_MAX > rate ) { continue; }
+            double a = ( n * 6 + block / 2 ) * 0.003;
+            p.blocks[block].lasers[laser].range = 5000 + 2000 * std::sin( a + laser * 0.1 ) + 500 * ( block & 0x1 ) + std::rand() % 8; // smooth surface, a bit of noise
+        }
+    }
+    return p;
+}
+
+static void expect_equal_ranges( const packet& a, const packet& b )
+{
+    for( unsigned int block = 0; block < a.blocks.size(); ++block )
+    {
+        for( unsigned int laser = 0; laser < a.blocks[block].lasers.size(); ++laser )
+        {
+            EXPECT_EQ( a.blocks[block].lasers[laser].range(), b.blocks[block].lasers[laser].range() );
+        }
+    }
+}
+
+static double compression( double rate )
+{
+    std::size_t size = 0;
+    std::size_t compressed_size = 0;
+    for( unsigned int n = 0; n < 100; ++n )
+    {
+        packet p = make_packet( n, rate );
+        char buf[ thin::maxBufferSize ];
+        char compressed_buf[ thin::maxBufferSize ];
+        size += thin::serialize( p, buf, 123 );
+        compressed_size += thin::serialize( p, compressed_buf, 123, true );
+        std::pair< packet, comma::uint32 > expected = thin::deserialize( buf );
+        std::pair< packet, comma::uint32 > q = thin::deserialize( compressed_buf );
+        EXPECT_EQ( 123u, q.second );
+        expect_equal_ranges( expected.first, q.first );
+        for( unsigned int block = 0; block < p.blocks.size(); ++block )
+        {
+            if( expected.first.blocks[block].rotation() != 0 ) { EXPECT_EQ( expected.first.blocks[block].rotation(), q.first.blocks[block].rotation() ); }
+        }
+    }
+    return double( size ) / compressed_size;
+}
+
+TEST( thin, compressed )
+{
+    EXPECT_LT( 2.4, compression( 1.0 ) ); // about 2.5
+    EXPECT_LT( 1.8, compression( 0.5 ) ); // about 1.9: presence of randomly thinned returns is incompressible
+    EXPECT_LT( 1.4, compression( 0.2 ) ); // about 1.5: most lasers have no earlier range in the packet to predict from
+    EXPECT_LT( 1.8, compression( 0.02 ) ); // about 1.9
+}
+
+TEST( thin, compressed_empty )
+{
+    packet p = make_packet( 0, 0 );
+    char buf[ thin::maxBufferSize ];
+    EXPECT_EQ( sizeof( comma::uint32 ) + 1, thin::serialize( p, buf, 5, true ) );
+    EXPECT_EQ( 5u, thin::deserialize( buf ).second );
+}
+
+TEST( thin, random )
+{
+    thin::random a( 123 );
+    thin::random b( 123 );
+    thin::random c( 124 );
+    float values[1000];
+    b.generate( values, values + 1000 );
+    thin::random d( 123 );
+    double sum = 0;
+    unsigned int different = 0;
+    for( unsigned int i = 0; i < 1000; ++i )
+    {
+        float v = a();
+        EXPECT_LE( 0, v );
+        EXPECT_LT( v, 1 );
+        sum += v;
+        if( v != c() ) { ++different; }
+    }
+    EXPECT_NEAR( 0.5, sum / 1000, 0.05 );
+    EXPECT_LT( 990u, different );
+    for( unsigned int i = 0; i < 1000; ++i ) { EXPECT_EQ( values[i], d() ); }
+}
+
+TEST( thin, seeded_rate )
+{
+    thin::random a( 5 );
+    thin::random b( 5 );
+    unsigned int count = 0;
+    for( unsigned int n = 0; n < 100; ++n )
+    {
+        packet p = make_packet( n, 1.0 );
+        packet q = p;
+        thin::thin( p, 0.3f, a );
+        thin::thin( q, 0.3f, b );
+        expect_equal_ranges( p, q );
+        for( unsigned int block = 0; block < p.blocks.size(); ++block )
+        {
+            for( unsigned int laser = 0; laser < p.blocks[block].lasers.size(); ++laser ) { if( p.blocks[block].lasers[laser].range() != 0 ) { ++count; } }
+        }
+    }
+    EXPECT_NEAR( 0.3, double( count ) / ( 100 * 12 * 32 ), 0.02 );
+}
+
+struct sequence
+{
+    unsigned int n;
+    sequence() : n( 0 ) {}
+    double operator()() { return double( n++ % 97 ) / 97; }
+};
+
+static void expect_equal_thinning( const thin::focus& focus, const thin::focus& indexed, const db& db )
+{
+    for( unsigned int k = 0; k < 2; ++k )
+    {
+        double angular_speed = k * 3600; // 10Hz
+        sequence random;
+        sequence indexed_random;
+        for( unsigned int n = 0; n < 300; ++n )
+        {
+            packet p = make_packet( n, 1.0 );
+            packet q = p;
+            thin::thin( p, focus, db, angular_speed, random );
+            thin::thin( q, indexed, db, angular_speed, indexed_random );
+            expect_equal_ranges( p, q );
+        }
+    }
+}
+
+static void expect_equal_lookup( const thin::focus& focus, const thin::focus& indexed, const db& db ) // returns off the rotation grid, e.g. with per-laser angular speed offset
+{
+    sequence random;
+    sequence indexed_random;
+    for( unsigned int laser = 0; laser < db.lasers.size(); ++laser )
+    {
+        for( unsigned int step = 0; step < 36000; step += 7 )
+        {
+            double azimuth = double( step ) / 100 + 0.001 * ( laser % 10 ); // offset up to 0.09 degree
+            double range = 5 + ( step % 31 );
+            bool expected = focus.has( range, db.lasers[laser].azimuth( azimuth ), db.lasers[laser].elevation, random );
+            EXPECT_EQ( expected, indexed.has( laser, azimuth, range, indexed_random ) ) << "laser: " << laser << " azimuth: " << azimuth << " range: " << range;
+        }
+    }
+}
+
+static void insert( thin::focus& focus, thin::focus& indexed, std::size_t id, const thin::sector& s )
+{
+    focus.insert( id, new thin::sector( s ) );
+    indexed.insert( id, new thin::sector( s ) );
+}
+
+static void insert( thin::focus& focus, thin::focus& indexed, std::size_t id, const thin::extents& e )
+{
+    focus.insert( id, new thin::extents( e ) );
+    indexed.insert( id, new thin::extents( e ) );
+}
+
+TEST( thin, focus_index )
+{
+    db db = test::testdb();
+    thin::focus focus( 0.5, 0.8 );
+    thin::focus indexed( 0.5, 0.8 );
+    indexed.index( db );
+    EXPECT_TRUE( indexed.indexed() );
+    EXPECT_FALSE( focus.indexed() );
+    insert( focus, indexed, 0, thin::sector( 30, 60, 12 ) );
+    expect_equal_thinning( focus, indexed, db );
+    insert( focus, indexed, 1, thin::sector( -175, 20 ) );
+    insert( focus, indexed, 2, thin::sector( 40, 20 ) );
+    expect_equal_thinning( focus, indexed, db );
+    insert( focus, indexed, 3, thin::extents( Eigen::Vector3d( 12, -20, -20 ), Eigen::Vector3d( 14, 20, 20 ) ) );
+    expect_equal_thinning( focus, indexed, db );
+    focus.erase( 2 );
+    indexed.erase( 2 );
+    insert( focus, indexed, 1, thin::sector( 170, 30, 11 ) );
+    expect_equal_thinning( focus, indexed, db );
+    focus.erase( 0 );
+    indexed.erase( 0 );
+    expect_equal_thinning( focus, indexed, db );
+}
+
+TEST( thin, focus_index_off_grid )
+{
+    db db = test::testdb();
+    thin::focus focus( 0.5, 0.8 );
+    thin::focus indexed( 0.5, 0.8 );
+    indexed.index( db );
+    insert( focus, indexed, 0, thin::sector( 30, 60, 12 ) );
+    insert( focus, indexed, 1, thin::sector( -175, 0.005 ) ); // narrower than rotation step
+    insert( focus, indexed, 2, thin::extents( Eigen::Vector3d( 12, -20, -20 ), Eigen::Vector3d( 14, 20, 20 ) ) );
+    expect_equal_lookup( focus, indexed, db );
+    focus.erase( 0 );
+    indexed.erase( 0 );
+    expect_equal_lookup( focus, indexed, db );
+}
+
+TEST( thin, focus_index_after_insert )
+{
+    db db = test::testdb();
+    thin::focus focus( 0.5, 0.8 );
+    thin::focus indexed( 0.5, 0.8 );
+    insert( focus, indexed, 0, thin::sector( 100, 90 ) );
+    indexed.index( db );
+    expect_equal_thinning( focus, indexed, db );
+}
+
+} } // namespace snark { namespace velodyne {
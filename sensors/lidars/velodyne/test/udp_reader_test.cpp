@@ -0,0 +1,62 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <boost/array.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include "../impl/udp_reader.h"
+
+TEST( udp_reader, loopback )
+{
+    snark::udp_reader reader( snark::udp_reader::config( 0, 1 << 20, 8 ) ); // any free port; batch smaller than number of packets sent
+    boost::asio::io_service service;
+    boost::asio::ip::udp::socket socket( service, boost::asio::ip::udp::endpoint( boost::asio::ip::udp::v4(), 0 ) );
+    boost::asio::ip::udp::endpoint destination( boost::asio::ip::address_v4::loopback(), reader.port() );
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int i = 0; i < 20; ++i )
+    {
+        boost::array< char, 1206 > packet;
+        ::memset( &packet[0], i, packet.size() );
+        socket.send_to( boost::asio::buffer( packet ), destination );
+    }
+    boost::posix_time::ptime finish = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int i = 0; i < 20; ++i )
+    {
+        const char* p = reader.read();
+        ASSERT_TRUE( p != NULL );
+        EXPECT_EQ( char( i ), p[0] );
+        EXPECT_EQ( char( i ), p[1205] );
+        EXPECT_LE( start - boost::posix_time::milliseconds( 1 ), reader.timestamp() ); // kernel and user clocks may differ in resolution
+        EXPECT_GE( finish + boost::posix_time::milliseconds( 1 ), reader.timestamp() );
+    }
+    reader.close();
+}
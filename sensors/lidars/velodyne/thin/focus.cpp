@@ -28,6 +28,7 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <comma/base/exception.h>
@@ -41,6 +42,7 @@ focus::focus( double rate, double ratio ) // todo: unit test
     , m_ratio( ratio )
     , m_rate_in_focus( 0 )
     , m_rate_out_of_focus( rate )
+    , m_db( NULL )
 {
 }
 
@@ -65,14 +67,109 @@ void focus::update()
 
 void focus::insert( std::size_t id, region* r )
 {
+    boost::shared_ptr< region > previous;
+    Map::iterator it = m_regions.find( id );
+    if( it != m_regions.end() ) { previous = it->second; }
     m_regions[id] = boost::shared_ptr< region >( r );
     update();
+    if( !m_db ) { return; }
+    if( previous ) { reindex( *previous ); }
+    reindex( *r );
 }
 
 void focus::erase( std::size_t id )
 {
-    m_regions.erase( id );
+    Map::iterator it = m_regions.find( id );
+    if( it == m_regions.end() ) { return; }
+    boost::shared_ptr< region > r = it->second;
+    m_regions.erase( it );
     update();
+    if( m_db ) { reindex( *r ); }
+}
+
+void focus::index( const velodyne::db& db )
+{
+    m_db = &db;
+    m_footprints.assign( db.lasers.size() * azimuth_table::steps, false );
+    m_candidates.assign( m_footprints.size(), false );
+    m_intervals.clear();
+    m_intervals.resize( m_candidates.size() / chunk_size );
+    for( Map::const_iterator it = m_regions.begin(); it != m_regions.end(); ++it ) { reindex( *it->second ); }
+}
+
+bool focus::indexed() const { return m_db != NULL; }
+
+double focus::bearing( unsigned int laser, unsigned int step ) const // same as in thin()
+{
+    double a = double( step ) / 100 + 90;
+    if( !comma::math::less( a, 360 ) ) { a -= 360; }
+    return m_db->lasers[laser].azimuth( a );
+}
+
+std::pair< int, int > focus::footprint( const region& r, unsigned int laser ) const // rotation steps [first, second) of laser, conservatively, one step more on each side
+{
+    std::pair< double, double > bearings = r.bearings();
+    if( !comma::math::less( bearings.second - bearings.first, 360 ) ) { return std::make_pair( 0, int( azimuth_table::steps ) ); }
+    double correction = 90 + m_db->lasers[laser].correction_angles.rotational.value;
+    int begin = int( std::floor( ( bearings.first - correction ) * 100 ) ) - 1;
+    int end = int( std::ceil( ( bearings.second - correction ) * 100 ) ) + 2;
+    return std::make_pair( begin, end - begin > azimuth_table::steps ? begin + azimuth_table::steps : end );
+}
+
+void focus::reindex( const region& r )
+{
+    for( unsigned int laser = 0; laser < m_db->lasers.size(); ++laser )
+    {
+        std::size_t offset = std::size_t( laser ) * azimuth_table::steps;
+        std::pair< int, int > steps = footprint( r, laser );
+        for( int s = steps.first; s < steps.second; ++s )
+        {
+            int step = s % azimuth_table::steps;
+            reindex( offset + ( step < 0 ? step + azimuth_table::steps : step ) );
+        }
+    }
+}
+
+void focus::reindex( std::size_t bin )
+{
+    unsigned int laser = bin / azimuth_table::steps;
+    int step = bin % azimuth_table::steps;
+    double b = bearing( laser, step );
+    double elevation = m_db->lasers[laser].elevation;
+    std::vector< std::pair< double, double > > intervals;
+    bool near = false;
+    for( Map::const_iterator it = m_regions.begin(); it != m_regions.end(); ++it )
+    {
+        std::pair< int, int > steps = footprint( *it->second, laser );
+        if( ( ( step - steps.first ) % azimuth_table::steps + azimuth_table::steps ) % azimuth_table::steps >= steps.second - steps.first ) { continue; }
+        near = true;
+        double min, max;
+        if( it->second->range_interval( b, elevation, min, max ) ) { intervals.push_back( std::make_pair( min, max ) ); }
+    }
+    m_footprints[bin] = near;
+    m_candidates[bin] = !intervals.empty();
+    if( intervals.empty() ) { return; }
+    std::vector< interval >& chunk = m_intervals[ bin / chunk_size ];
+    if( chunk.empty() ) { chunk.resize( chunk_size ); }
+    std::sort( intervals.begin(), intervals.end() );
+    interval& i = chunk[ bin % chunk_size ];
+    i.min = intervals[0].first;
+    i.max = intervals[0].second;
+    i.exact = true;
+    for( unsigned int k = 1; k < intervals.size(); ++k )
+    {
+        if( comma::math::less( i.max, intervals[k].first ) ) { i.exact = false; }
+        if( i.max < intervals[k].second ) { i.max = intervals[k].second; }
+    }
+}
+
+bool focus::in_regions( unsigned int laser, double bearing, double range ) const
+{
+    for( Map::const_iterator it = m_regions.begin(); it != m_regions.end(); ++it )
+    {
+        if( it->second->has( range, bearing, m_db->lasers[laser].elevation ) ) { return true; }
+    }
+    return false;
 }
 
 } } } // namespace snark {  namespace velodyne { namespace thin {
@@ -31,8 +31,13 @@
 #ifndef SNARK_SENSORS_VELODYNE_THIN_FOCUS
 #define SNARK_SENSORS_VELODYNE_THIN_FOCUS
 
+#include <cmath>
 #include <map>
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <comma/math/compare.h>
+#include "../azimuth_table.h"
+#include "../db.h"
 #include "region.h"
 
 namespace snark {  namespace velodyne { namespace thin {
@@ -44,6 +49,22 @@ class focus
         focus( double rate = 1.0, double ratio = 1.0 );
         template < typename Random >
         bool has( double range, double bearing, double elevation, Random& random ) const;
+
+        /// same as has( range, bearing, elevation, random ) for the return of given laser
+        /// with given azimuth as in laser_return, i.e. in degrees before rotational correction,
+        /// but looked up in the index, see index(); returns off the 0.01 degree grid of packet
+        /// rotation (e.g. with per-laser angular speed offset) are looked up by the nearest
+        /// rotation steps and tested exactly, if any region is near
+        template < typename Random >
+        bool has( unsigned int laser, double azimuth, double range, Random& random ) const;
+
+        /// build lookup of regions by laser and rotation step for given db, db should outlive focus;
+        /// once indexed, insert() and erase() update only the bins covered by the region
+        /// @note the index is a bitmap of bins touched by any region, plus range intervals
+        ///       allocated in chunks of 1 degree only where regions are
+        void index( const velodyne::db& db );
+        bool indexed() const;
+
         double rate_in_focus() const;
         double rate_out_of_focus() const;
         double coverage() const;
@@ -58,6 +79,23 @@ class focus
         double m_rate_in_focus;
         double m_rate_out_of_focus;
         void update();
+
+        enum { chunk_size = 100 };
+        struct interval
+        {
+            double min;
+            double max;
+            bool exact; // false, if regions give disjoint range intervals in the bin
+        };
+        const velodyne::db* m_db;
+        std::vector< bool > m_footprints;
+        std::vector< bool > m_candidates;
+        std::vector< std::vector< interval > > m_intervals;
+        double bearing( unsigned int laser, unsigned int step ) const;
+        std::pair< int, int > footprint( const region& r, unsigned int laser ) const;
+        void reindex( const region& r );
+        void reindex( std::size_t bin );
+        bool in_regions( unsigned int laser, double bearing, double range ) const;
 };
 
 template < typename Random >
@@ -71,6 +109,27 @@ bool focus::has( double range, double bearing, double elevation, Random& random
     return r < m_rate_out_of_focus;
 }
 
+template < typename Random >
+bool focus::has( unsigned int laser, double azimuth, double range, Random& random ) const
+{
+    double r = random();
+    double s = ( azimuth - 90 ) * 100;
+    double nearest = std::floor( s + 0.5 );
+    std::size_t offset = std::size_t( laser ) * azimuth_table::steps;
+    if( !comma::math::equal( s, nearest, 1e-6 ) ) // off the grid: test exactly, if near regions
+    {
+        int step = int( std::floor( s ) ) + 2 * azimuth_table::steps;
+        if( !m_footprints[ offset + step % azimuth_table::steps ] && !m_footprints[ offset + ( step + 1 ) % azimuth_table::steps ] ) { return r < m_rate_out_of_focus; }
+        return r < ( in_regions( laser, m_db->lasers[laser].azimuth( azimuth ), range ) ? m_rate_in_focus : m_rate_out_of_focus );
+    }
+    unsigned int step = ( int( nearest ) + 2 * azimuth_table::steps ) % azimuth_table::steps;
+    std::size_t bin = offset + step;
+    if( !m_candidates[bin] ) { return r < m_rate_out_of_focus; }
+    const interval& i = m_intervals[ bin / chunk_size ][ bin % chunk_size ];
+    bool in = i.exact ? !comma::math::less( range, i.min ) && !comma::math::less( i.max, range ) : in_regions( laser, bearing( laser, step ), range );
+    return r < ( in ? m_rate_in_focus : m_rate_out_of_focus );
+}
+
 } } } // namespace snark {  namespace velodyne { namespace thin {
 
 #endif // #ifndev SNARK_SENSORS_VELODYNE_THIN_FOCUS
@@ -0,0 +1,80 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "random.h"
+
+namespace snark {  namespace velodyne { namespace thin {
+
+static comma::uint64 splitmix( comma::uint64& x ) // see http://xoroshiro.di.unimi.it/splitmix64.c
+{
+    comma::uint64 z = ( x += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+random::random( comma::uint64 seed ) { this->seed( seed ); }
+
+void random::seed( comma::uint64 seed )
+{
+    for( unsigned int i = 0; i < lanes; ++i ) { m_state[0][i] = splitmix( seed ); m_state[1][i] = splitmix( seed ); } // never all zeros
+    m_index = size;
+}
+
+void random::generate( float* begin, float* end )
+{
+    static const float scale = 1.0f / ( 1 << 24 );
+    comma::uint64 s0[lanes];
+    comma::uint64 s1[lanes];
+    comma::uint64 x[lanes];
+    for( unsigned int i = 0; i < lanes; ++i ) { s0[i] = m_state[0][i]; s1[i] = m_state[1][i]; }
+    while( begin != end )
+    {
+        for( unsigned int i = 0; i < lanes; ++i ) // xorshift128+, see Vigna, Further scramblings of Marsaglia's xorshift generators
+        {
+            comma::uint64 a = s0[i];
+            comma::uint64 b = s1[i];
+            s0[i] = b;
+            a ^= a << 23;
+            s1[i] = a ^ b ^ ( a >> 17 ) ^ ( b >> 26 );
+            x[i] = s1[i] + b;
+        }
+        float values[ lanes * 2 ]; // two 24-bit values out of each 64-bit output
+        for( unsigned int i = 0; i < lanes; ++i )
+        {
+            values[i] = float( comma::uint32( x[i] >> 40 ) ) * scale;
+            values[ lanes + i ] = float( comma::uint32( x[i] >> 8 ) & 0xffffff ) * scale;
+        }
+        for( unsigned int i = 0; i < lanes * 2 && begin != end; ++i, ++begin ) { *begin = values[i]; }
+    }
+    for( unsigned int i = 0; i < lanes; ++i ) { m_state[0][i] = s0[i]; m_state[1][i] = s1[i]; }
+}
+
+} } } // namespace snark {  namespace velodyne { namespace thin {
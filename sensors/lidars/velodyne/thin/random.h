@@ -0,0 +1,70 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_SENSORS_VELODYNE_THIN_RANDOM_H_
+#define SNARK_SENSORS_VELODYNE_THIN_RANDOM_H_
+
+#include <cstddef>
+#include <comma/base/types.h>
+
+namespace snark {  namespace velodyne { namespace thin {
+
+/// fast uniform random numbers in [0, 1) for thinning: a few independent
+/// xorshift128+ generators stepped side by side, so that filling a packet's
+/// worth of values is a loop the compiler can vectorise
+/// @note same seed gives the same sequence, as long as values are drawn the same way
+class random
+{
+    public:
+        /// number of generators stepped side by side
+        enum { lanes = 4 };
+
+        /// constructor
+        explicit random( comma::uint64 seed = 0 );
+
+        /// reseed
+        void seed( comma::uint64 seed );
+
+        /// fill [begin, end) with uniform values in [0, 1)
+        void generate( float* begin, float* end );
+
+        /// return next uniform value in [0, 1)
+        float operator()() { if( m_index == size ) { generate( m_values, m_values + size ); m_index = 0; } return m_values[ m_index++ ]; }
+
+    private:
+        enum { size = 64 };
+        comma::uint64 m_state[2][lanes];
+        float m_values[size];
+        unsigned int m_index;
+};
+
+} } } // namespace snark {  namespace velodyne { namespace thin {
+
+#endif // SNARK_SENSORS_VELODYNE_THIN_RANDOM_H_
@@ -31,6 +31,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <limits>
 #include <comma/base/exception.h>
 #include <comma/math/compare.h>
 #include <snark/math/range_bearing_elevation.h>
@@ -59,6 +60,19 @@ bool sector::has( double r, double b, double ) const
 
 double sector::coverage() const { return comma::math::equal( range, 0 ) ? ken / 360 : ( range / 30 ) * ( ken / 360 ); } // quick and dirty
 
+std::pair< double, double > sector::bearings() const
+{
+    return comma::math::less( ken, 360 ) ? std::make_pair( bearing() - ken / 2, bearing() + ken / 2 ) : std::make_pair( -180.0, 180.0 );
+}
+
+bool sector::range_interval( double b, double, double& min, double& max ) const
+{
+    if( !has( 0, b, 0 ) ) { return false; }
+    min = -std::numeric_limits< double >::max();
+    max = comma::math::equal( range, 0 ) ? std::numeric_limits< double >::max() : range;
+    return true;
+}
+
 extents::extents( const Eigen::Vector3d& min, const Eigen::Vector3d& max ) : interval( min, max ) {}
 
 extents::extents( const math::closed_interval< double, 3 >& interval ) : interval( interval ) {}
@@ -69,6 +83,29 @@ bool extents::has( double range, double bearing, double elevation ) const // qui
     return interval.contains( range_bearing_elevation( range, bearing, elevation ).to_cartesian() );
 }
 
+std::pair< double, double > extents::bearings() const { return std::make_pair( -180.0, 180.0 ); } // quick and dirty: bearing is passed to range_bearing_elevation as is, thus all bearings
+
+bool extents::range_interval( double bearing, double elevation, double& min, double& max ) const // points of the ray are range * direction
+{
+    Eigen::Vector3d direction = range_bearing_elevation( 1, bearing, elevation ).to_cartesian();
+    min = -std::numeric_limits< double >::max();
+    max = std::numeric_limits< double >::max();
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+        if( comma::math::equal( direction[i], 0 ) )
+        {
+            if( comma::math::less( 0, interval.min()[i] ) || comma::math::less( interval.max()[i], 0 ) ) { return false; }
+            continue;
+        }
+        double a = interval.min()[i] / direction[i];
+        double b = interval.max()[i] / direction[i];
+        if( b < a ) { std::swap( a, b ); }
+        if( min < a ) { min = a; }
+        if( b < max ) { max = b; }
+    }
+    return !comma::math::less( max, min );
+}
+
 double extents::coverage() const // todo: quick and dirty; by right need to take cross-section of the extents with a conic section
 {
     double roughly_radius = ( interval.max() - interval.min() ).norm() / 2;
@@ -31,6 +31,7 @@
 #ifndef SNARK_SENSORS_VELODYNE_THIN_REGION
 #define SNARK_SENSORS_VELODYNE_THIN_REGION
 
+#include <utility>
 #include <Eigen/Core>
 #include <comma/math/cyclic.h>
 #include <comma/visiting/traits.h>
@@ -44,6 +45,14 @@ struct region
     virtual ~region() {}
     virtual bool has( double range, double bearing, double elevation ) const = 0;
     virtual double coverage() const = 0;
+
+    /// bearings in degrees covered by the region as [first, second], conservatively;
+    /// second - first >= 360 means all bearings
+    virtual std::pair< double, double > bearings() const = 0;
+
+    /// range interval in which the ray of given bearing and elevation is in the region
+    /// @return false, if the ray does not touch the region
+    virtual bool range_interval( double bearing, double elevation, double& min, double& max ) const = 0;
 };
 
 /// sector, quick and dirty
@@ -53,12 +62,18 @@ struct sector : public region
     sector( double bearing, double ken, double range = 0 );
     bool has( double range, double bearing, double ) const;
     double coverage() const;
+    std::pair< double, double > bearings() const;
+    bool range_interval( double bearing, double, double& min, double& max ) const;
     comma::math::cyclic< double > bearing;
     double ken;
     double range;
 };
 
 /// extents, quick and dirty
+/// @note has() and range_interval() take sin and cos of bearing and elevation per call;
+///       azimuth_table cannot stand in for them: its points include laser offsets and
+///       distance corrections, while regions are defined on plain range, bearing and elevation;
+///       to avoid trigonometry per return, index the focus (see focus::index())
 struct extents : public region
 {
     extents();
@@ -66,6 +81,8 @@ struct extents : public region
     extents( const math::closed_interval< double, 3 >& interval );
     bool has( double range, double bearing, double elevation ) const;
     double coverage() const;
+    std::pair< double, double > bearings() const;
+    bool range_interval( double bearing, double elevation, double& min, double& max ) const;
     math::closed_interval< double, 3 > interval;
 };
 
@@ -28,9 +28,6 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/uniform_real.hpp>
-#include <boost/random/variate_generator.hpp>
 #include <comma/base/types.h>
 #include <comma/base/exception.h>
 #include "../packet.h"
@@ -39,13 +36,39 @@
 
 namespace snark {  namespace velodyne { namespace thin {
 
-static boost::mt19937 generator;
+static thin::random generator;
 
-void thin( velodyne::packet& packet, float rate )
+void thin( velodyne::packet& packet, float rate ) { thin::thin( packet, rate, generator ); }
+
+enum { returns = 12 * 32 };
+
+void thin( velodyne::packet& packet, float rate, thin::random& random )
 {
-    boost::uniform_real< float > distribution( 0, 1 ); // watch performance
-    boost::variate_generator< boost::mt19937&, boost::uniform_real< float > > random( generator, distribution );
-    thin::thin( packet, rate, random );
+    float values[ returns ];
+    random.generate( values, values + returns );
+    const float* value = values;
+    for( unsigned int block = 0; block < packet.blocks.size(); ++block )
+    {
+        for( unsigned int laser = 0; laser < packet.blocks[block].lasers.size(); ++laser, ++value )
+        {
+            if( *value > rate ) { packet.blocks[block].lasers[laser].range = 0; }
+        }
+    }
+}
+
+struct replay // replays values drawn for the whole packet
+{
+    const float* value;
+    replay( const float* value ) : value( value ) {}
+    float operator()() { return *value++; }
+};
+
+void thin( velodyne::packet& packet, const focus& focus, const velodyne::db& db, double angularSpeed, thin::random& random )
+{
+    float v[ returns ];
+    random.generate( v, v + returns );
+    replay r( v );
+    thin::thin( packet, focus, db, angularSpeed, r );
 }
 
 static void set( char* ids, unsigned int i, bool value = true )
@@ -109,6 +132,215 @@ std::size_t serialize( const velodyne::packet& packet, char* buf, comma::uint32
     return buf - begin;
 }
 
+/// format version is stored in the two upper bits of block pair ids, which are unused in the uncompressed format
+enum { versionShift = 6, versionMask = 0xc0, compressedVersion = 1 };
+
+/// bits are written and read least significant first
+class bit_writer
+{
+    public:
+        bit_writer( char* buf ) : m_buf( buf ), m_begin( buf ), m_bits( 0 ), m_size( 0 ) {}
+
+        void write( comma::uint32 value, unsigned int size ) // size <= 32
+        {
+            m_bits |= comma::uint64( value & ( size == 32 ? 0xffffffff : ( ( 1u << size ) - 1 ) ) ) << m_size;
+            m_size += size;
+            while( m_size >= 8 ) { *m_buf++ = static_cast< char >( m_bits & 0xff ); m_bits >>= 8; m_size -= 8; }
+        }
+
+        std::size_t flush() { if( m_size > 0 ) { *m_buf++ = static_cast< char >( m_bits & 0xff ); m_bits = 0; m_size = 0; } return m_buf - m_begin; }
+
+    private:
+        char* m_buf;
+        char* m_begin;
+        comma::uint64 m_bits;
+        unsigned int m_size;
+};
+
+class bit_reader
+{
+    public:
+        bit_reader( const char* buf ) : m_buf( reinterpret_cast< const unsigned char* >( buf ) ), m_bits( 0 ), m_size( 0 ) {}
+
+        comma::uint32 read( unsigned int size ) // size <= 32
+        {
+            while( m_size < size ) { m_bits |= comma::uint64( *m_buf++ ) << m_size; m_size += 8; }
+            comma::uint32 value = static_cast< comma::uint32 >( m_bits & ( size == 32 ? 0xffffffff : ( ( 1u << size ) - 1 ) ) );
+            m_bits >>= size;
+            m_size -= size;
+            return value;
+        }
+
+        bool read() { return read( 1 ); }
+
+    private:
+        const unsigned char* m_buf;
+        comma::uint64 m_bits;
+        unsigned int m_size;
+};
+
+/// rice code with escape: values with large quotient are written in full
+enum { riceEscape = 16, riceValueSize = 17, riceMaxParameter = 16 };
+
+static comma::uint32 zigzag( int value ) { return value < 0 ? ( comma::uint32( -value ) << 1 ) - 1 : comma::uint32( value ) << 1; }
+
+static int unzigzag( comma::uint32 value ) { return value & 1 ? -int( ( value + 1 ) >> 1 ) : int( value >> 1 ); }
+
+static unsigned int rice_size( comma::uint32 value, unsigned int k )
+{
+    comma::uint32 q = value >> k;
+    return q < riceEscape ? q + 1 + k : riceEscape + riceValueSize;
+}
+
+static void write_rice( bit_writer& writer, comma::uint32 value, unsigned int k )
+{
+    comma::uint32 q = value >> k;
+    if( q < riceEscape )
+    {
+        writer.write( ( 1u << q ) - 1, q + 1 ); // q ones and zero
+        if( k > 0 ) { writer.write( value, k ); }
+    }
+    else
+    {
+        writer.write( ( 1u << riceEscape ) - 1, riceEscape );
+        writer.write( value, riceValueSize );
+    }
+}
+
+static comma::uint32 read_rice( bit_reader& reader, unsigned int k )
+{
+    comma::uint32 q = 0;
+    while( q < riceEscape && reader.read() ) { ++q; }
+    if( q == riceEscape ) { return reader.read( riceValueSize ); }
+    return k > 0 ? ( q << k ) | reader.read( k ) : q;
+}
+
+static unsigned int best_rice_parameter( const comma::uint32* values, std::size_t size )
+{
+    unsigned int best = 0;
+    unsigned int best_size = 0;
+    for( unsigned int k = 0; k <= riceMaxParameter; ++k )
+    {
+        unsigned int s = 0;
+        for( std::size_t i = 0; i < size; ++i ) { s += rice_size( values[i], k ); }
+        if( k == 0 || s < best_size ) { best = k; best_size = s; }
+    }
+    return best;
+}
+
+/// range residuals of a packet, in the order they are written
+/// range is predicted from the previous range of the same laser in the packet (temporal),
+/// or else from the previous range in the same block pair (spatial)
+struct residuals
+{
+    boost::array< comma::uint32, 12 * 32 > temporal;
+    boost::array< comma::uint32, 12 * 32 > spatial;
+    boost::array< bool, 12 * 32 > is_temporal;
+    std::size_t temporal_size;
+    std::size_t spatial_size;
+    std::size_t size;
+    residuals() : temporal_size( 0 ), spatial_size( 0 ), size( 0 ) {}
+};
+
+/// rotation is coded as difference from the previous present block pair
+enum { rotationRiceParameter = 5 };
+
+/// number of bits for number of present returns in packet
+enum { gapsSizeBits = 9 };
+
+static std::size_t serialize_compressed( const velodyne::packet& packet, char* buf, comma::uint32 scan )
+{
+    char* begin = buf;
+    ::memcpy( buf, &scan, sizeof( comma::uint32 ) );
+    buf += sizeof( comma::uint32 );
+    char& ids = *buf++;
+    ids = compressedVersion << versionShift;
+    boost::array< comma::uint64, 6 > masks;
+    boost::array< int, 64 > last;
+    last.assign( -1 );
+    residuals r;
+    for( unsigned int pair = 0; pair < masks.size(); ++pair )
+    {
+        masks[pair] = 0;
+        int previous = -1;
+        for( unsigned int i = 0; i < 64; ++i )
+        {
+            int range = packet.blocks[ pair * 2 + i / 32 ].lasers[ i % 32 ].range();
+            if( range == 0 ) { continue; }
+            masks[pair] |= comma::uint64( 1 ) << i;
+            if( last[i] >= 0 ) { r.temporal[ r.temporal_size++ ] = zigzag( range - last[i] ); r.is_temporal[ r.size++ ] = true; }
+            else { r.spatial[ r.spatial_size++ ] = zigzag( previous < 0 ? range : range - previous ); r.is_temporal[ r.size++ ] = false; }
+            last[i] = range;
+            previous = range;
+        }
+        if( masks[pair] ) { ids |= 1 << pair; }
+    }
+    if( r.size == 0 ) { return buf - begin; }
+    bit_writer writer( buf );
+    int rotation = -1;
+    for( unsigned int pair = 0; pair < masks.size(); ++pair )
+    {
+        if( !masks[pair] ) { continue; }
+        int current = packet.blocks[ pair * 2 ].rotation();
+        if( rotation < 0 ) { writer.write( current, 16 ); }
+        else { write_rice( writer, zigzag( current - rotation ), rotationRiceParameter ); }
+        rotation = current;
+    }
+    boost::array< comma::uint32, 12 * 32 > gaps; // numbers of absent returns before each present one, in present block pairs
+    std::size_t gaps_size = 0;
+    unsigned int pairs = 0;
+    for( unsigned int pair = 0, gap = 0; pair < masks.size(); ++pair )
+    {
+        if( !masks[pair] ) { continue; }
+        ++pairs;
+        for( unsigned int i = 0; i < 64; ++i )
+        {
+            if( masks[pair] & ( comma::uint64( 1 ) << i ) ) { gaps[ gaps_size++ ] = gap; gap = 0; } else { ++gap; }
+        }
+    }
+    unsigned int gap_k = best_rice_parameter( &gaps[0], gaps_size );
+    unsigned int gaps_bits = gapsSizeBits;
+    for( std::size_t i = 0; i < gaps_size; ++i ) { gaps_bits += rice_size( gaps[i], gap_k ); }
+    bool gap_coded = gaps_bits < pairs * 64;
+    writer.write( gap_coded, 1 );
+    if( gap_coded ) // sparse, e.g. heavily thinned: presence as rice-coded gaps
+    {
+        writer.write( gap_k, 5 );
+        writer.write( gaps_size, gapsSizeBits );
+        for( std::size_t i = 0; i < gaps_size; ++i ) { write_rice( writer, gaps[i], gap_k ); }
+    }
+    else // dense: presence as bitmaps
+    {
+        for( unsigned int pair = 0; pair < masks.size(); ++pair )
+        {
+            if( !masks[pair] ) { continue; }
+            writer.write( masks[pair] & 0xffffffff, 32 );
+            writer.write( masks[pair] >> 32, 32 );
+        }
+    }
+    unsigned int temporal_k = best_rice_parameter( &r.temporal[0], r.temporal_size );
+    unsigned int spatial_k = best_rice_parameter( &r.spatial[0], r.spatial_size );
+    writer.write( temporal_k, 5 );
+    writer.write( spatial_k, 5 );
+    for( std::size_t i = 0, t = 0, s = 0; i < r.size; ++i )
+    {
+        if( r.is_temporal[i] ) { write_rice( writer, r.temporal[ t++ ], temporal_k ); }
+        else { write_rice( writer, r.spatial[ s++ ], spatial_k ); }
+    }
+    return buf - begin + writer.flush();
+}
+
+std::size_t serialize( const velodyne::packet& packet, char* buf, comma::uint32 scan, bool compressed )
+{
+    if( !compressed ) { return serialize( packet, buf, scan ); }
+    char compressed_buf[ 2048 ]; // big enough for the worst case, when all values are escaped
+    std::size_t size = serialize_compressed( packet, compressed_buf, scan );
+    std::size_t uncompressed_size = serialize( packet, buf, scan );
+    if( size >= uncompressed_size ) { return uncompressed_size; } // e.g. noise: fall back to uncompressed format
+    ::memcpy( buf, compressed_buf, size );
+    return size;
+}
+
 static std::size_t deserialize( velodyne::packet::laser_block& upper, velodyne::packet::laser_block& lower, const char* buf )
 {
     upper.id = velodyne::packet::upper_block_id();
@@ -134,6 +366,65 @@ static std::size_t deserialize( velodyne::packet::laser_block& upper, velodyne::
     return buf - begin;
 }
 
+static void deserialize_compressed( velodyne::packet& packet, char ids, const char* buf )
+{
+    boost::array< comma::uint64, 6 > masks;
+    bit_reader reader( buf );
+    int rotation = -1;
+    for( unsigned int pair = 0; pair < masks.size(); ++pair )
+    {
+        masks[pair] = 0;
+        if( !( ids & ( 1 << pair ) ) ) { continue; }
+        rotation = rotation < 0 ? int( reader.read( 16 ) ) : rotation + unzigzag( read_rice( reader, rotationRiceParameter ) );
+        packet.blocks[ pair * 2 ].rotation = rotation;
+        packet.blocks[ pair * 2 + 1 ].rotation = rotation;
+    }
+    if( !( ids & ~versionMask ) ) { return; }
+    if( reader.read() )
+    {
+        unsigned int gap_k = reader.read( 5 );
+        std::size_t gaps_size = reader.read( gapsSizeBits );
+        unsigned int pair = 0;
+        unsigned int slot = 0;
+        for( std::size_t i = 0; i < gaps_size; ++i, ++slot )
+        {
+            slot += read_rice( reader, gap_k );
+            for( ; pair < masks.size() && ( !( ids & ( 1 << pair ) ) || slot >= 64 ); ++pair ) { if( ids & ( 1 << pair ) ) { slot -= 64; } }
+            if( pair == masks.size() ) { COMMA_THROW( comma::exception, "corrupted compressed thin packet" ); }
+            masks[pair] |= comma::uint64( 1 ) << slot;
+        }
+    }
+    else
+    {
+        for( unsigned int pair = 0; pair < masks.size(); ++pair )
+        {
+            if( !( ids & ( 1 << pair ) ) ) { continue; }
+            masks[pair] = reader.read( 32 );
+            masks[pair] |= comma::uint64( reader.read( 32 ) ) << 32;
+        }
+    }
+    unsigned int temporal_k = reader.read( 5 );
+    unsigned int spatial_k = reader.read( 5 );
+    boost::array< int, 64 > last;
+    last.assign( -1 );
+    for( unsigned int pair = 0; pair < masks.size(); ++pair )
+    {
+        packet.blocks[ pair * 2 ].id = velodyne::packet::upper_block_id();
+        packet.blocks[ pair * 2 + 1 ].id = velodyne::packet::lower_block_id();
+        if( !masks[pair] ) { continue; }
+        int previous = -1;
+        for( unsigned int i = 0; i < 64; ++i )
+        {
+            if( !( masks[pair] & ( comma::uint64( 1 ) << i ) ) ) { continue; }
+            int range = last[i] >= 0 ? last[i] + unzigzag( read_rice( reader, temporal_k ) )
+                                     : ( previous < 0 ? 0 : previous ) + unzigzag( read_rice( reader, spatial_k ) );
+            packet.blocks[ pair * 2 + i / 32 ].lasers[ i % 32 ].range = range;
+            last[i] = range;
+            previous = range;
+        }
+    }
+}
+
 comma::uint32 deserialize( velodyne::packet& packet, const char* buf )
 {
     ::memset( &packet, 0, velodyne::packet::size );
@@ -141,6 +432,12 @@ comma::uint32 deserialize( velodyne::packet& packet, const char* buf )
     memcpy( &scan, buf, sizeof( comma::uint32 ) );
     buf += sizeof( comma::uint32 );
     const char& ids = *buf++;
+    switch( ( ids & versionMask ) >> versionShift )
+    {
+        case 0: break;
+        case compressedVersion: deserialize_compressed( packet, ids, buf ); return scan;
+        default: COMMA_THROW( comma::exception, "expected thin format version 0 or " << compressedVersion << ", got " << ( ( ids & versionMask ) >> versionShift ) );
+    }
     for( unsigned int i = 0; i < packet.blocks.size(); i += 2 )
     {
         if( !( ids & ( 1 << ( i >> 1 ) ) ) ) { continue; }
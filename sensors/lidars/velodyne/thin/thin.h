@@ -36,6 +36,7 @@
 #include "../packet.h"
 #include "../impl/get_laser_return.h"
 #include "focus.h"
+#include "random.h"
 
 namespace snark {  namespace velodyne { namespace thin {
 
@@ -46,13 +47,27 @@ void thin( velodyne::packet& packet, float rate );
 template < typename Random >
 void thin( velodyne::packet& packet, float rate, Random& random );
 
+/// thin packet, drawing random numbers for the whole packet at once
+void thin( velodyne::packet& packet, float rate, thin::random& random );
+
 /// thin packet, using given source of random numbers
+/// @note if focus is indexed, db should be the one the focus is indexed for
 template < typename Random >
-void thin( velodyne::packet& packet, const focus& focus, const db& db, Random& random );
+void thin( velodyne::packet& packet, const focus& focus, const db& db, double angularSpeed, Random& random );
+
+/// thin packet, drawing random numbers for the whole packet at once
+void thin( velodyne::packet& packet, const focus& focus, const db& db, double angularSpeed, thin::random& random );
 
 /// write packet to thin buffer
 std::size_t serialize( const velodyne::packet& packet, char* buf, comma::uint32 scan );
 
+/// write packet to thin buffer, compressed, if required
+/// @note compressed format: ranges are delta-coded against the previous range of
+///       the same laser in the packet (or the previous range in the block pair)
+///       and rice-coded; if compression does not pay off for a packet,
+///       it is written uncompressed; deserialize() reads both formats
+std::size_t serialize( const velodyne::packet& packet, char* buf, comma::uint32 scan, bool compressed );
+
 /// refill packet from thin buffer
 /// @return velodyne packet and scan id
 std::pair< velodyne::packet, comma::uint32 > deserialize( const char* buf );
@@ -85,6 +100,17 @@ void thin( velodyne::packet& packet, const focus& focus, const velodyne::db& db,
     bool upper = true;
     for( unsigned int block = 0; block < packet.blocks.size(); ++block, upper = !upper )
     {
+        if( focus.indexed() ) // quick path: look up by laser and rotation
+        {
+            unsigned int offset = upper ? 0 : 32;
+            for( unsigned int laser = 0; laser < packet.blocks[block].lasers.size(); ++laser )
+            {
+                double azimuth = impl::azimuth( packet, block, laser, angularSpeed, false ); // same as get_laser_return() below
+                double range = db.lasers[ laser + offset ].range( double( packet.blocks[block].lasers[laser].range() ) / 500 );
+                if( !focus.has( laser + offset, azimuth, range, random ) ) { packet.blocks[block].lasers[laser].range = 0; }
+            }
+            continue;
+        }
         for( unsigned int laser = 0; laser < packet.blocks[block].lasers.size(); ++laser )
         {
             velodyne::laser_return r = impl::get_laser_return( packet, block, laser, boost::posix_time::not_a_date_time, angularSpeed );
@@ -28,8 +28,8 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
-#ifndef SNARK_IMAGING_BURSTY_PIPELINE_H_
-#define SNARK_IMAGING_BURSTY_PIPELINE_H_
+#ifndef SNARK_TBB_BURSTY_PIPELINE_H_
+#define SNARK_TBB_BURSTY_PIPELINE_H_
 
 #include <tbb/task_scheduler_init.h>
 #include <tbb/pipeline.h>
@@ -38,51 +38,51 @@
 namespace snark { namespace tbb {
 
 /// run a tbb pipeline with bursty data using bursty_reader
+/// @note run() keeps a single pipeline alive for the whole run, its input stage blocking
+///       on the reader queue instead of stopping the pipeline whenever the queue gets empty;
+///       one extra scheduler thread is reserved for the blocked input stage
 template< typename T >
 class bursty_pipeline
 {
 public:
-    bursty_pipeline( unsigned int numThread = 0 );
+    bursty_pipeline( unsigned int numThread = 0, unsigned int tokens = 0 );
     void run_once( bursty_reader< T >& reader, const ::tbb::filter_t< T, void >& filter );
     void run( bursty_reader< T >& reader, const ::tbb::filter_t< T, void >& filter );
+    unsigned int tokens() const { return m_tokens; }
 
 private:
+    static unsigned int threads_( unsigned int numThread ) { return numThread == 0 ? ::tbb::task_scheduler_init::default_num_threads() : numThread; }
+
     unsigned int m_threads;
+    unsigned int m_tokens;
     ::tbb::task_scheduler_init m_init;
 };
 
 /// constructor
 /// @param numThread maximum number of threads, 0 means auto
+/// @param tokens maximum number of items in flight, 0 means the number of threads
 template< typename T >
-bursty_pipeline< T >::bursty_pipeline( unsigned int numThread ):
-    m_threads( numThread )
+bursty_pipeline< T >::bursty_pipeline( unsigned int numThread, unsigned int tokens ):
+    m_threads( threads_( numThread ) ),
+    m_tokens( tokens == 0 ? m_threads : tokens ),
+    m_init( m_threads + 1 )
 {
-    if( numThread == 0 )
-    {
-        m_threads = m_init.default_num_threads();
-    }
 }
 
-/// run the pipeline once
+/// run the pipeline once, until the reader queue is empty
 template< typename T >
 void bursty_pipeline< T >::run_once( bursty_reader< T >& reader, const ::tbb::filter_t< T, void >& filter )
 {
-    ::tbb::parallel_pipeline( m_threads, reader.filter() & filter );
+    ::tbb::parallel_pipeline( m_tokens, reader.filter() & filter );
 }
 
 /// run the pipeline until the reader stops and the queue is empty
 template< typename T >
 void bursty_pipeline< T >::run( bursty_reader< T >& reader, const ::tbb::filter_t< T, void >& filter )
 {
-    const ::tbb::filter_t< void, void > f = reader.filter() & filter;
-    while( reader.wait() )
-    {
-        ::tbb::parallel_pipeline( m_threads, f );
-    }
+    ::tbb::parallel_pipeline( m_tokens, reader.blocking_filter() & filter );
 }
 
-
-
 } }
 
-#endif // SNARK_IMAGING_BURSTY_PIPELINE_H_
+#endif // SNARK_TBB_BURSTY_PIPELINE_H_
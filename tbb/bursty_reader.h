@@ -31,9 +31,12 @@
 #ifndef SNARK_TBB_BURSTY_READER_H_
 #define SNARK_TBB_BURSTY_READER_H_
 
-#include <snark/tbb/queue.h>
+#include <snark/tbb/ring_queue.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <comma/base/types.h>
+#include <tbb/atomic.h>
 #include <tbb/pipeline.h>
 
 namespace snark{ namespace tbb{
@@ -46,6 +49,19 @@ struct bursty_reader_traits
     static bool valid( const T& t ) { return true; }
 };
 
+/// input queue statistics, e.g. for profiling
+struct bursty_reader_statistics
+{
+    /// number of items taken from the queue
+    comma::uint64 popped;
+    /// number of items discarded, because the pipeline could not keep up
+    comma::uint64 discarded;
+    /// total time the pipeline waited on the empty queue, microseconds
+    comma::uint64 wait;
+    /// current queue size
+    std::size_t size;
+};
+
 /// helper class to run a tbb pipeline with bursty data
 /// the pipeline has to be closed when no data is received to prevent the main thread to spin
 template< typename T >
@@ -60,31 +76,42 @@ public:
     void stop();
     void join();
     ::tbb::filter_t< void, T >& filter() { return m_read_filter; }
+    ::tbb::filter_t< void, T >& blocking_filter() { return m_blocking_read_filter; }
+    bursty_reader_statistics statistics() const;
 
 private:
     T read( ::tbb::flow_control& flow );
+    T blocking_read( ::tbb::flow_control& flow );
+    void discard();
     void push();
     void push_thread();
 
-    queue< T > m_queue;
+    spsc_queue< T > m_queue;
     unsigned int m_size;
     bool m_running;
     boost::scoped_ptr< boost::thread > m_thread;
     boost::function0< T > m_read;
     ::tbb::filter_t< void, T > m_read_filter;
+    ::tbb::filter_t< void, T > m_blocking_read_filter;
+    ::tbb::atomic< comma::uint64 > m_popped;
+    ::tbb::atomic< comma::uint64 > m_discarded;
+    ::tbb::atomic< comma::uint64 > m_wait;
 };
 
 
 /// constructor
 /// @param read the user-provided read functor that outputs the data
 /// @param size maximum input queue size before discarding data, 0 means infinite
+/// @note the reader thread blocks, if the queue reaches default capacity of spsc_queue
 template< typename T >
 bursty_reader< T >::bursty_reader( boost::function0< T > read, unsigned int size ):
     m_size( size ),
     m_running( true ),
     m_read( read ),
-    m_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::read, this, _1 ) )
+    m_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::read, this, _1 ) ),
+    m_blocking_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::blocking_read, this, _1 ) )
 {
+    m_popped = m_discarded = m_wait = 0;
     m_thread.reset( new boost::thread( boost::bind( &bursty_reader< T >::push_thread, this ) ) );
 }
 
@@ -98,8 +125,10 @@ bursty_reader< T >::bursty_reader( boost::function0< T > read, unsigned int size
     m_size( size ),
     m_running( true ),
     m_read( read ),
-    m_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::read, this, _1 ) )
+    m_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::read, this, _1 ) ),
+    m_blocking_read_filter( ::tbb::filter::serial_in_order, boost::bind( &bursty_reader< T >::blocking_read, this, _1 ) )
 {
+    m_popped = m_discarded = m_wait = 0;
     m_thread.reset( new boost::thread( boost::bind( &bursty_reader< T >::push_thread, this ) ) );
 }
 
@@ -140,6 +169,25 @@ void bursty_reader< T >::join()
     m_thread.reset();
 }
 
+/// discard the oldest frames, if the queue grew beyond the maximum size
+template< typename T >
+void bursty_reader< T >::discard()
+{
+    if( m_size == 0 ) { return; }
+    T t;
+    unsigned int n = 0;
+    while( m_queue.size() > m_size )
+    {
+        m_queue.try_pop( t );
+        n++;
+    }
+    m_discarded += n;
+//     if( n > 0 ) TODO how to warn the user that data is discarded ?
+//     {
+//         std::cerr << "warning: discarded " << n << " frame(s)" << std::endl;
+//     }
+}
+
 /// try to pop a frame from the queue
 /// @param flow pipeline flow control used to stop the pipeline when the queue is empty
 template< typename T >
@@ -150,20 +198,7 @@ T bursty_reader< T >::read( ::tbb::flow_control& flow )
         flow.stop();
         return T();
     }
-    if( m_size > 0 )
-    {
-        T t;
-        unsigned int n = 0;
-        while( m_queue.size() > m_size )
-        {
-            m_queue.pop( t );
-            n++;
-        }
-//         if( n > 0 ) TODO how to warn the user that data is discarded ?
-//         {
-//             std::cerr << "warning: discarded " << n << " frame(s)" << std::endl;
-//         }
-    }
+    discard();
     T t;
     m_queue.pop( t );
     if( !bursty_reader_traits< T >::valid( t ) )
@@ -171,9 +206,40 @@ T bursty_reader< T >::read( ::tbb::flow_control& flow )
         flow.stop();
         return T();
     }
+    ++m_popped;
+    return t;
+}
+
+/// pop a frame from the queue, block while the queue is empty
+/// @param flow pipeline flow control used to stop the pipeline when the reader stopped and the queue is empty
+template< typename T >
+T bursty_reader< T >::blocking_read( ::tbb::flow_control& flow )
+{
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    m_queue.wait();
+    m_wait += ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds();
+    discard();
+    T t;
+    if( !m_queue.try_pop( t ) || !bursty_reader_traits< T >::valid( t ) )
+    {
+        flow.stop();
+        return T();
+    }
+    ++m_popped;
     return t;
 }
 
+/// return input queue statistics
+template< typename T >
+bursty_reader_statistics bursty_reader< T >::statistics() const
+{
+    bursty_reader_statistics s;
+    s.popped = m_popped;
+    s.discarded = m_discarded;
+    s.wait = m_wait;
+    s.size = m_queue.size();
+    return s;
+}
 
 /// read an element from the source and push it to the queue
 template< typename T >
@@ -0,0 +1,327 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SNARK_TBB_RING_QUEUE_H_
+#define SNARK_TBB_RING_QUEUE_H_
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+#include <cstddef>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <comma/base/exception.h>
+#include <comma/base/types.h>
+
+namespace snark { namespace tbb {
+
+namespace detail {
+
+/// lightweight blocking for lock-free queues: a waiter calls enter(),
+/// re-checks its condition and calls block() until the condition holds,
+/// then leave(); notify() costs a system call only if someone is waiting
+/// @note on linux backed by eventfd in semaphore mode, elsewhere by a condition variable
+class event : public boost::noncopyable
+{
+    public:
+        event() : m_waiters( 0 )
+        {
+            #ifdef __linux__
+            m_fd = ::eventfd( 0, EFD_SEMAPHORE );
+            if( m_fd < 0 ) { COMMA_THROW( comma::exception, "failed to create eventfd, errno: " << errno ); }
+            #else
+            m_tokens = 0;
+            #endif
+        }
+
+        ~event()
+        {
+            #ifdef __linux__
+            ::close( m_fd );
+            #endif
+        }
+
+        void enter() { ++m_waiters; boost::atomic_thread_fence( boost::memory_order_seq_cst ); }
+
+        void leave() { --m_waiters; }
+
+        /// block until notified; may return spuriously, thus always re-check the condition
+        void block()
+        {
+            #ifdef __linux__
+            comma::uint64 value;
+            while( ::read( m_fd, &value, sizeof( value ) ) < 0 && errno == EINTR );
+            #else
+            boost::unique_lock< boost::mutex > lock( m_mutex );
+            if( m_tokens == 0 ) { m_condition.wait( lock ); }
+            if( m_tokens > 0 ) { --m_tokens; }
+            #endif
+        }
+
+        /// wake up all current waiters
+        void notify()
+        {
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            unsigned int waiters = m_waiters.load();
+            if( waiters == 0 ) { return; }
+            #ifdef __linux__
+            comma::uint64 value = waiters;
+            while( ::write( m_fd, &value, sizeof( value ) ) < 0 && errno == EINTR );
+            #else
+            boost::lock_guard< boost::mutex > lock( m_mutex );
+            m_tokens += waiters;
+            m_condition.notify_all();
+            #endif
+        }
+
+    private:
+        boost::atomic< unsigned int > m_waiters;
+        #ifdef __linux__
+        int m_fd;
+        #else
+        boost::mutex m_mutex;
+        boost::condition_variable m_condition;
+        unsigned int m_tokens;
+        #endif
+};
+
+inline std::size_t ring_size( std::size_t capacity ) { std::size_t s = 1; while( s < capacity ) { s <<= 1; } return s; }
+
+/// number of times to re-check a condition before blocking, since hand-over is usually quick
+enum { spin = 256 };
+
+} // namespace detail {
+
+/// lock-free single producer single consumer ring buffer with blocking push, pop and wait
+/// @note same interface as snark::tbb::queue, but bounded by given capacity (the ring itself
+///       is rounded up to a power of 2); consumer operations may be called from different threads, as long as not concurrently,
+///       e.g. from a serial tbb filter
+template < typename T >
+class spsc_queue : public boost::noncopyable
+{
+    public:
+        /// constructor
+        spsc_queue( std::size_t capacity = 1024 ) : m_capacity( capacity == 0 ? 1 : capacity ), m_size( detail::ring_size( m_capacity ) ), m_values( new T[ m_size ] ), m_head( 0 ), m_tail( 0 ), m_shutdown( false ) {}
+
+        /// push, block while full
+        /// @return false, if queue is shut down
+        bool push( const T& t )
+        {
+            std::size_t tail = m_tail.load( boost::memory_order_relaxed );
+            for( unsigned int i = 0; i < detail::spin && full_( tail ) && !m_shutdown; ++i );
+            if( full_( tail ) )
+            {
+                m_not_full.enter();
+                while( full_( tail ) && !m_shutdown ) { m_not_full.block(); }
+                m_not_full.leave();
+                if( full_( tail ) ) { return false; }
+            }
+            m_values[ tail & ( m_size - 1 ) ] = t;
+            m_tail.store( tail + 1, boost::memory_order_release );
+            m_not_empty.notify();
+            return true;
+        }
+
+        /// pop, block while empty
+        /// @return false, if queue is empty and shut down
+        bool pop( T& t )
+        {
+            wait();
+            return try_pop( t );
+        }
+
+        /// pop, if not empty
+        /// @return false, if queue is empty
+        bool try_pop( T& t )
+        {
+            std::size_t head = m_head.load( boost::memory_order_relaxed );
+            if( head == m_tail.load( boost::memory_order_acquire ) ) { return false; }
+            T& v = m_values[ head & ( m_size - 1 ) ];
+            t = v;
+            v = T(); // release resources held by the value, e.g. shared pointer
+            m_head.store( head + 1, boost::memory_order_release );
+            m_not_full.notify();
+            return true;
+        }
+
+        /// block until not empty or shut down
+        void wait()
+        {
+            for( unsigned int i = 0; i < detail::spin; ++i ) { if( !empty() || m_shutdown ) { return; } }
+            m_not_empty.enter();
+            while( empty() && !m_shutdown ) { m_not_empty.block(); }
+            m_not_empty.leave();
+        }
+
+        /// wake up and do not block any more in wait(), pop(), and push()
+        void shutdown() { m_shutdown = true; m_not_empty.notify(); m_not_full.notify(); }
+
+        std::size_t size() const { return m_tail.load( boost::memory_order_acquire ) - m_head.load( boost::memory_order_acquire ); }
+
+        bool empty() const { return size() == 0; }
+
+        std::size_t capacity() const { return m_capacity; }
+
+    private:
+        const std::size_t m_capacity;
+        const std::size_t m_size;
+        boost::scoped_array< T > m_values;
+        boost::atomic< std::size_t > m_head;
+        boost::atomic< std::size_t > m_tail;
+        boost::atomic< bool > m_shutdown;
+        detail::event m_not_empty;
+        detail::event m_not_full;
+        bool full_( std::size_t tail ) const { return tail - m_head.load( boost::memory_order_acquire ) >= m_capacity; }
+};
+
+/// lock-free multiple producer single consumer ring buffer, otherwise the same as spsc_queue
+/// @note see bounded mpmc queue by Dmitry Vyukov, www.1024cores.net
+template < typename T >
+class mpsc_queue : public boost::noncopyable
+{
+    public:
+        /// constructor
+        mpsc_queue( std::size_t capacity = 1024 ) : m_capacity( capacity == 0 ? 1 : capacity ), m_size( detail::ring_size( m_capacity ) ), m_cells( new cell[ m_size ] ), m_head( 0 ), m_tail( 0 ), m_shutdown( false )
+        {
+            for( std::size_t i = 0; i < m_size; ++i ) { m_cells[i].sequence.store( i, boost::memory_order_relaxed ); }
+        }
+
+        /// push, block while full
+        /// @return false, if queue is shut down
+        bool push( const T& t )
+        {
+            cell* c = NULL;
+            std::size_t tail;
+            for( unsigned int i = 0; i < detail::spin && ( c = claim_( tail ) ) == NULL && !m_shutdown; ++i );
+            if( c == NULL )
+            {
+                m_not_full.enter();
+                while( ( c = claim_( tail ) ) == NULL && !m_shutdown ) { m_not_full.block(); }
+                m_not_full.leave();
+                if( c == NULL ) { return false; }
+            }
+            c->value = t;
+            c->sequence.store( tail + 1, boost::memory_order_release );
+            m_not_empty.notify();
+            return true;
+        }
+
+        /// pop, block while empty
+        /// @return false, if queue is empty and shut down
+        bool pop( T& t )
+        {
+            wait();
+            return try_pop( t );
+        }
+
+        /// pop, if not empty
+        /// @return false, if queue is empty
+        bool try_pop( T& t )
+        {
+            std::size_t head = m_head.load( boost::memory_order_relaxed );
+            cell& c = m_cells[ head & ( m_size - 1 ) ];
+            if( c.sequence.load( boost::memory_order_acquire ) != head + 1 ) { return false; }
+            t = c.value;
+            c.value = T(); // release resources held by the value, e.g. shared pointer
+            c.sequence.store( head + m_size, boost::memory_order_release );
+            m_head.store( head + 1, boost::memory_order_release );
+            m_not_full.notify();
+            return true;
+        }
+
+        /// block until not empty or shut down
+        void wait()
+        {
+            for( unsigned int i = 0; i < detail::spin; ++i ) { if( ready_() || m_shutdown ) { return; } }
+            m_not_empty.enter();
+            while( !ready_() && !m_shutdown ) { m_not_empty.block(); }
+            m_not_empty.leave();
+        }
+
+        /// wake up and do not block any more in wait(), pop(), and push()
+        void shutdown() { m_shutdown = true; m_not_empty.notify(); m_not_full.notify(); }
+
+        /// number of values, approximately, if producers are pushing
+        std::size_t size() const
+        {
+            std::size_t head = m_head.load( boost::memory_order_acquire );
+            std::size_t tail = m_tail.load( boost::memory_order_acquire );
+            return tail > head ? tail - head : 0;
+        }
+
+        bool empty() const { return !ready_(); }
+
+        std::size_t capacity() const { return m_capacity; }
+
+    private:
+        struct cell
+        {
+            boost::atomic< std::size_t > sequence;
+            T value;
+        };
+        const std::size_t m_capacity;
+        const std::size_t m_size;
+        boost::scoped_array< cell > m_cells;
+        boost::atomic< std::size_t > m_head;
+        boost::atomic< std::size_t > m_tail;
+        boost::atomic< bool > m_shutdown;
+        detail::event m_not_empty;
+        detail::event m_not_full;
+
+        bool ready_() const
+        {
+            std::size_t head = m_head.load( boost::memory_order_acquire );
+            return m_cells[ head & ( m_size - 1 ) ].sequence.load( boost::memory_order_acquire ) == head + 1;
+        }
+
+        cell* claim_( std::size_t& tail ) // claim a cell to write or return NULL, if full
+        {
+            tail = m_tail.load( boost::memory_order_relaxed );
+            while( true )
+            {
+                if( std::ptrdiff_t( tail - m_head.load( boost::memory_order_acquire ) ) >= std::ptrdiff_t( m_capacity ) ) { return NULL; } // full at given capacity, although the ring may have free cells; signed, since tail may be stale
+                cell& c = m_cells[ tail & ( m_size - 1 ) ];
+                std::ptrdiff_t d = std::ptrdiff_t( c.sequence.load( boost::memory_order_acquire ) ) - std::ptrdiff_t( tail );
+                if( d == 0 ) { if( m_tail.compare_exchange_weak( tail, tail + 1, boost::memory_order_relaxed ) ) { return &c; } }
+                else if( d < 0 ) { return NULL; }
+                else { tail = m_tail.load( boost::memory_order_relaxed ); }
+            }
+        }
+};
+
+} } // namespace snark { namespace tbb {
+
+#endif // SNARK_TBB_RING_QUEUE_H_
@@ -0,0 +1,151 @@
+// This file is part of snark, a generic and flexible library for robotics research
+// Copyright (c) 2011 The University of Sydney
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the University of Sydney nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+// GRANTED BY THIS LICENSE.  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+// HOLDERS AND CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED
+// WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+// OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <gtest/gtest.h>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include <snark/tbb/ring_queue.h>
+
+namespace snark { namespace tbb {
+
+static const boost::posix_time::time_duration timeout = boost::posix_time::seconds( 5 ); // to fail rather than hang, if a thread does not wake up
+static const boost::posix_time::time_duration pause = boost::posix_time::milliseconds( 100 ); // to let a thread reach a blocking call
+
+template < typename Queue >
+static void produce( Queue& queue, unsigned int id, unsigned int size )
+{
+    for( unsigned int i = 0; i < size; ++i ) { queue.push( std::make_pair( id, i ) ); }
+}
+
+template < typename Queue >
+static void expect_fifo( unsigned int producers, std::size_t capacity )
+{
+    const unsigned int size = 20000;
+    Queue queue( capacity );
+    boost::thread_group threads;
+    for( unsigned int i = 0; i < producers; ++i ) { threads.create_thread( boost::bind( &produce< Queue >, boost::ref( queue ), i, size ) ); }
+    std::vector< unsigned int > next( producers, 0 );
+    for( unsigned int i = 0; i < producers * size; ++i )
+    {
+        std::pair< unsigned int, unsigned int > p;
+        ASSERT_TRUE( queue.pop( p ) );
+        ASSERT_LT( p.first, producers );
+        ASSERT_EQ( next[ p.first ], p.second ); // in order of pushing for each producer
+        ++next[ p.first ];
+    }
+    threads.join_all();
+    EXPECT_TRUE( queue.empty() );
+}
+
+template < typename Queue >
+static void push_counted( Queue& queue, unsigned int size, boost::atomic< unsigned int >& pushed )
+{
+    for( unsigned int i = 0; i < size; ++i ) { if( queue.push( std::make_pair( 0u, i ) ) ) { ++pushed; } }
+}
+
+template < typename Queue >
+static void expect_blocking_at_capacity()
+{
+    Queue queue( 5 ); // not a power of 2, unlike ring size
+    EXPECT_EQ( 5u, queue.capacity() );
+    boost::atomic< unsigned int > pushed( 0 );
+    boost::thread producer( boost::bind( &push_counted< Queue >, boost::ref( queue ), 7, boost::ref( pushed ) ) );
+    boost::this_thread::sleep( pause );
+    EXPECT_EQ( 5u, pushed.load() );
+    EXPECT_EQ( 5u, queue.size() );
+    std::pair< unsigned int, unsigned int > p;
+    ASSERT_TRUE( queue.pop( p ) );
+    EXPECT_EQ( 0u, p.second );
+    boost::this_thread::sleep( pause );
+    EXPECT_EQ( 6u, pushed.load() );
+    EXPECT_EQ( 5u, queue.size() );
+    ASSERT_TRUE( queue.pop( p ) );
+    EXPECT_TRUE( producer.timed_join( timeout ) );
+    EXPECT_EQ( 7u, pushed.load() );
+    for( unsigned int i = 2; i < 7; ++i ) { ASSERT_TRUE( queue.try_pop( p ) ); EXPECT_EQ( i, p.second ); }
+    EXPECT_FALSE( queue.try_pop( p ) );
+}
+
+template < typename Queue >
+static void pop_once( Queue& queue, bool& result )
+{
+    std::pair< unsigned int, unsigned int > p;
+    result = queue.pop( p );
+}
+
+template < typename Queue >
+static void push_once( Queue& queue, bool& result ) { result = queue.push( std::make_pair( 0u, 0u ) ); }
+
+template < typename Queue >
+static void expect_shutdown_wakes_up()
+{
+    Queue empty( 3 );
+    bool popped = true;
+    boost::thread consumer( boost::bind( &pop_once< Queue >, boost::ref( empty ), boost::ref( popped ) ) );
+    boost::thread waiter( boost::bind( &Queue::wait, boost::ref( empty ) ) );
+    Queue full( 3 );
+    for( unsigned int i = 0; i < 3; ++i ) { ASSERT_TRUE( full.push( std::make_pair( 0u, i ) ) ); }
+    bool pushed = true;
+    boost::thread producer( boost::bind( &push_once< Queue >, boost::ref( full ), boost::ref( pushed ) ) );
+    boost::this_thread::sleep( pause );
+    empty.shutdown();
+    full.shutdown();
+    EXPECT_TRUE( consumer.timed_join( timeout ) );
+    EXPECT_TRUE( waiter.timed_join( timeout ) );
+    EXPECT_TRUE( producer.timed_join( timeout ) );
+    EXPECT_FALSE( popped );
+    EXPECT_FALSE( pushed );
+    EXPECT_EQ( 3u, full.size() );
+}
+
+typedef std::pair< unsigned int, unsigned int > value_type;
+
+TEST( spsc_queue, fifo )
+{
+    expect_fifo< spsc_queue< value_type > >( 1, 1024 );
+    expect_fifo< spsc_queue< value_type > >( 1, 3 );
+}
+
+TEST( spsc_queue, blocking_at_capacity ) { expect_blocking_at_capacity< spsc_queue< value_type > >(); }
+
+TEST( spsc_queue, shutdown ) { expect_shutdown_wakes_up< spsc_queue< value_type > >(); }
+
+TEST( mpsc_queue, fifo )
+{
+    expect_fifo< mpsc_queue< value_type > >( 1, 1024 );
+    expect_fifo< mpsc_queue< value_type > >( 4, 1024 );
+    expect_fifo< mpsc_queue< value_type > >( 4, 3 );
+}
+
+TEST( mpsc_queue, blocking_at_capacity ) { expect_blocking_at_capacity< mpsc_queue< value_type > >(); }
+
+TEST( mpsc_queue, shutdown ) { expect_shutdown_wakes_up< mpsc_queue< value_type > >(); }
+
+} } // namespace snark { namespace tbb {